@@ -51,11 +51,28 @@
 /* Function prototypes for the command table */
 void cmd_help(cli_select_t t, uint8_t argc, char **argv);         /* handled by cli/cli.c */
 void cmd_sysinfo(cli_select_t t, uint8_t argc, char **argv);
+void cmd_cpu_stat(cli_select_t t, uint8_t argc, char **argv);
+void cmd_loop_stat(cli_select_t t, uint8_t argc, char **argv);
+#ifdef CFG_PERF
+void cmd_perf(cli_select_t t, uint8_t argc, char **argv);
+#endif
+#ifdef CFG_TRACE
+void cmd_trace(cli_select_t t, uint8_t argc, char **argv);
+#endif
 
 void cmd_rtc_read(cli_select_t t, uint8_t argc, char **argv);
 void cmd_rtc_write(cli_select_t t, uint8_t argc, char **argv);
+void cmd_rtc_stat(cli_select_t t, uint8_t argc, char **argv);
+void cmd_dcf_stat(cli_select_t t, uint8_t argc, char **argv);
+#ifdef CFG_GPS
+void cmd_gps_stat(cli_select_t t, uint8_t argc, char **argv);
+void cmd_gps_ubx(cli_select_t t, uint8_t argc, char **argv);
+#endif
 void cmd_tz_read(cli_select_t t, uint8_t argc, char **argv);
 void cmd_tz_write(cli_select_t t, uint8_t argc, char **argv);
+void cmd_tz_zone_read(cli_select_t t, uint8_t argc, char **argv);
+void cmd_tz_zone_write(cli_select_t t, uint8_t argc, char **argv);
+void cmd_tz_zone_time(cli_select_t t, uint8_t argc, char **argv);
 
 void cmd_clock_set_source(cli_select_t t, uint8_t argc, char **argv);
 void cmd_clock_get_source(cli_select_t t, uint8_t argc, char **argv);
@@ -93,10 +110,27 @@ cli_t cli_tbl[] =
     // command name, min args, max args, hidden, function name, command description, syntax
     { "?",                 0,  0,  0, cmd_help                                   , "Help"                              , CMD_NOPARAMS },
     { "V",                 0,  0,  0, cmd_sysinfo                                , "System Info"                       , CMD_NOPARAMS },
+    { "cpu_stat",          0,  0,  0, cmd_cpu_stat                               , "CPU duty cycle and wakeups"        , CMD_NOPARAMS },
+    { "loop_stat",         0,  1,  0, cmd_loop_stat                              , "Main loop latency and stalls"      , "'loop_stat [reset]'" },
+#ifdef CFG_PERF
+    { "perf",              0,  1,  0, cmd_perf                                   , "Profiler probes"                   , "'perf [reset]'" },
+#endif
+#ifdef CFG_TRACE
+    { "trace",             0,  1,  0, cmd_trace                                  , "Event trace ring"                  , "'trace [dump|clear]'" },
+#endif
     { "rtc_read",          0,  0,  0, cmd_rtc_read                               , "RTC read"                          , CMD_NOPARAMS },
     { "rtc_write",         6,  7,  0, cmd_rtc_write                              , "RTC write"                         , "'rtc_write <yr> <mon> <day> <hr> <min> <sec>'" },
+    { "rtc_stat",          0,  0,  0, cmd_rtc_stat                               , "RTC interrupt statistics"          , CMD_NOPARAMS },
+    { "dcf_stat",          0,  1,  0, cmd_dcf_stat                               , "DCF edge and sync statistics"      , "'dcf_stat [reset]'" },
+#ifdef CFG_GPS
+    { "gps_stat",          0,  1,  0, cmd_gps_stat                               , "GPS receive and sync statistics"   , "'gps_stat [reset]'" },
+    { "gps_ubx",           1,  1,  0, cmd_gps_ubx                                , "GPS receiver output UBX or NMEA"   , "'gps_ubx (on|off)'" },
+#endif
     { "tz_read",           0,  1,  0, cmd_tz_read                                , "TZ read"                           , "'tz_read [std|dst]'" },
     { "tz_write",          6,  6,  0, cmd_tz_write                               , "TZ write"                          , "'tz_write (std|dst) <offset> <hour> <dow> <week> <month>'" },
+    { "tzz_read",          0,  1,  0, cmd_tz_zone_read                           , "TZ zone read"                      , "'tzz_read [zone]'" },
+    { "tzz_write",         7,  7,  0, cmd_tz_zone_write                          , "TZ zone write"                     , "'tzz_write <zone> (std|dst) <offset> <hour> <dow> <week> <month>'" },
+    { "tzz_time",          0,  0,  0, cmd_tz_zone_time                           , "TZ zone local times"               , CMD_NOPARAMS },
     { "clk_setsrc",        1,  1,  0, cmd_clock_set_source                       , "Clock set source"                  , "'clk_setsrc <source(0=NONE|1=DCF77|2=GPS)>'" },
     { "clk_getsrc",        0,  0,  0, cmd_clock_get_source                       , "Clock get source"                  , CMD_NOPARAMS },
     { "clk_setnm",         5,  5,  0, cmd_clock_set_nightmode                    , "Clock set night mode"              , "'clk_setnm <dayMask> <startHour> <startMinute> <endHour> <endMinute>'" },
@@ -0,0 +1,38 @@
+#ifndef __EVENT_H__
+#define __EVENT_H__
+
+#include "platform_config.h"
+
+/* Events posted by the interrupts, handled by the main loop */
+typedef enum
+{
+    EVENT_NONE       = 0,
+    EVENT_RTC_SECOND = (1 << 0),
+    EVENT_USART1     = (1 << 1),
+    EVENT_USART2     = (1 << 2),
+    EVENT_USB        = (1 << 3),
+    EVENT_DCF_EDGE   = (1 << 4),
+    EVENT_TIMER      = (1 << 5),
+    EVENT_CAPTURE    = (1 << 6)
+} event_t;
+
+typedef struct
+{
+    uint32_t busyCycles;        /**< Cycles awake during the last RTC second */
+    uint32_t busyCyclesMax;
+    uint32_t wakeups;           /**< Wakeups from WFI during the last RTC second */
+    uint32_t wakeupsMax;
+    uint32_t dispatches;        /**< Loop passes with pending events during the last RTC second */
+    uint32_t timerIsrs;         /**< Timer interrupts during the last RTC second */
+    uint32_t timerIsrsMax;
+    uint32_t seconds;           /**< RTC seconds the statistics were taken over */
+} eventStat_t;
+
+void eventInit(void);
+void eventPost(uint32_t events);
+uint32_t eventTake(void);
+void eventWait(void);
+void eventSecond(void);
+void eventGetStat(eventStat_t *stat);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef __LOOP_H__
+#define __LOOP_H__
+
+#include "platform_config.h"
+#include <stdbool.h>
+
+/* Work of the main loop, the tag of a stall */
+typedef enum
+{
+    LOOP_MODULE_IDLE = 0,
+    LOOP_MODULE_CLI,
+    LOOP_MODULE_CLOCK,
+    LOOP_MODULE_TIMER,
+    LOOP_MODULE_PROTOCOL,
+    LOOP_MODULE_COUNT
+} loopModule_t;
+
+/* Bucket n counts passes of 2^(n-1) up to 2^n cycles, the last one all longer */
+#define LOOP_BUCKETS    (28)
+
+typedef struct
+{
+    uint32_t passes;                    /**< Passes that handled events */
+    uint32_t buckets[LOOP_BUCKETS];     /**< Passes by log2 of their cycles */
+    uint32_t worstCycles;               /**< Longest module section */
+    uint8_t worstModule;
+    uint32_t stalls;                    /**< Sections longer than CFG_LOOP_STALL_MS */
+    uint8_t lastStallModule;
+    uint16_t watchdogResets;            /**< Resets by the watchdog, kept in the backup domain */
+    uint8_t watchdogModule;             /**< Module active at the last watchdog reset */
+    bool watchdogReset;                 /**< The last reset was by the watchdog */
+} loopStat_t;
+
+void loopInit(void);
+void loopEnter(loopModule_t m);
+void loopIdle(void);
+void loopReset(void);
+void loopGetStat(loopStat_t *stat);
+const char *loopGetModuleName(uint8_t m);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "platform_config.h"
 #include "rtc/rtc_functions.h"
+#include "timer.h"
 
 typedef enum
 {
@@ -22,6 +23,8 @@ extern nixieclockMode_t nixieclockMode;
 void nixieclockInit(void);
 void nixieclockShowTime(rtcTime_t t);
 void nixieclockSaveTubes();
+void nixieclockCycleDigits(timer_ticks_t step, uint8_t steps);
+bool nixieclockIsCycling(void);
 
 void nixieclockTurnOn();
 void nixieclockTurnOff();
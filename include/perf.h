@@ -0,0 +1,74 @@
+#ifndef __PERF_H__
+#define __PERF_H__
+
+#include "platform_config.h"
+
+#ifdef CFG_PERF
+
+/* Probe points, keep perfNames in perf.c in the same order */
+typedef enum
+{
+    PERF_CLI_POLL = 0,
+    PERF_CLOCK_POLL,
+    PERF_TIMER_POLL,
+    PERF_TZ_TO_LOCAL,
+    PERF_FLIPDOT_SET,
+    PERF_NIXIE_DISPLAY,
+    PERF_ISR_RTC,
+    PERF_ISR_USART1,
+    PERF_ISR_USART2,
+    PERF_ISR_DMA1_CH6,
+    PERF_ISR_USB,
+    PERF_ISR_TIMER,
+    PERF_ISR_DCF,
+    PERF_PROBE_COUNT
+} perfProbe_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} perfStat_t;
+
+#ifdef CFG_PERF_HOST
+/* Host builds measure nanoseconds */
+#include <time.h>
+
+#define PERF_UNIT   "ns"
+
+static inline uint32_t perfCycles(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+#else
+#include "timer.h"
+
+#define PERF_UNIT   "cycles"
+
+static inline uint32_t perfCycles(void)
+{
+    return timer_cycles();
+}
+#endif
+
+/* Brackets a measured section, both in the same scope */
+#define PERF_BEGIN(probe)   uint32_t perfStart_##probe = perfCycles()
+#define PERF_END(probe)     perfRecord((probe), perfCycles() - perfStart_##probe)
+
+void perfRecord(perfProbe_t probe, uint32_t cycles);
+void perfReset(void);
+void perfGetStat(perfProbe_t probe, perfStat_t *stat);
+const char *perfGetName(perfProbe_t probe);
+
+#else
+
+#define PERF_BEGIN(probe)
+#define PERF_END(probe)
+
+#endif // CFG_PERF
+
+#endif
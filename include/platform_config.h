@@ -22,11 +22,11 @@
     000x  . . . . . . . . . . . . . . . .
     001x  x x x x x x . . . . . . . . . .   Timezone STD
     002x  x x x x x x . . . . . . . . . .   Timezone DST
-    003x  x . x . . . . . . . . . . . . .   Clock Source / Nightmode
+    003x  x . x x x . . . . . . . . . . .   Clock Source / Nightmode
     004x  x x x x . . . . . . . . . . . .   Nixie Type/Mode
-    005x  . . . . . . . . . . . . . . . .
-    006x  . . . . . . . . . . . . . . . .
-    007x  . . . . . . . . . . . . . . . .
+    005x  x x x x x x . . x x x x x x . .   Timezone zone 1 STD/DST
+    006x  x x x x x x . . x x x x x x . .   Timezone zone 2 STD/DST
+    007x  x x x x x x . . x x x x x x . .   Timezone zone 3 STD/DST
     008x  . . . . . . . . . . . . . . . .
     009x  . . . . . . . . . . . . . . . .
     00Ax  . . . . . . . . . . . . . . . .
@@ -44,6 +44,8 @@
 #define CFG_EEPROM_CLOCK_NM     (uint16_t)0x0032
 #define CFG_EEPROM_NIXIE_TYPE   (uint16_t)0x0040
 #define CFG_EEPROM_NIXIE_MODE   (uint16_t)0x0042
+#define CFG_EEPROM_TZ_ZONES     (uint16_t)0x0050
+#define CFG_EEPROM_TZ_ZONE(n)   (uint16_t)(CFG_EEPROM_TZ_ZONES + ((n) - 1) * 0x10)
 /*=========================================================================*/
 
 
@@ -57,6 +59,171 @@
 #define CFG_NIXIE
 /*=========================================================================*/
 
+/*=========================================================================
+    TIMEZONE
+    -----------------------------------------------------------------------
+
+    CFG_TZ_ZONES              Number of time zones (1..4). Zone 0 is the
+                              zone of the display, further zones can be
+                              converted for world clock displays.
+    CFG_TZ_TABLE              If this field is defined the DST rules are
+                              expanded into a table of UTC transition
+                              instants for the whole epoch range after
+                              they change. A year change is then a table
+                              lookup instead of a rule evaluation, which
+                              only pays off when epochs far apart are
+                              converted. Costs 552 bytes RAM per zone,
+                              2208 bytes with 4 zones.
+    -----------------------------------------------------------------------*/
+#define CFG_TZ_ZONES                (4)
+//#define CFG_TZ_TABLE
+/*=========================================================================*/
+
+/*=========================================================================
+    TIMER
+    -----------------------------------------------------------------------
+
+    CFG_TIMER_TICKLESS        If this field is defined the time base is
+                              TIM2 running freely at TIMER_FREQUENCY_HZ.
+                              Its overflow (every 655 ms) and a compare
+                              for the next software timer deadline are
+                              the only timer interrupts. Otherwise
+                              SysTick interrupts at TIMER_FREQUENCY_HZ.
+    -----------------------------------------------------------------------*/
+#define CFG_TIMER_TICKLESS
+/*=========================================================================*/
+
+/*=========================================================================
+    PERF
+    -----------------------------------------------------------------------
+
+    CFG_PERF                  If this field is defined the hot paths and
+                              interrupts are measured with the DWT cycle
+                              counter (count, min, avg, max per probe),
+                              readable with the 'perf' command. Without it
+                              the probes compile to nothing.
+    CFG_PERF_HOST             Defined by host builds only, the probes then
+                              measure nanoseconds with clock_gettime
+    -----------------------------------------------------------------------*/
+#define CFG_PERF
+/*=========================================================================*/
+
+/*=========================================================================
+    LOOP
+    -----------------------------------------------------------------------
+
+    CFG_LOOP_STALL_MS         A main loop section longer than this counts
+                              as a stall. The USART RX buffers fill in
+                              ~22 ms at 115200 baud.
+    CFG_LOOP_WATCHDOG_MS      Timeout of the independent watchdog, fed
+                              once per main loop pass (max. 26000)
+    CFG_LOOP_BKP_TAG          Backup register with the module the main
+                              loop is in, read after a watchdog reset
+    CFG_LOOP_BKP_RESETS       Backup register counting watchdog resets
+    CFG_LOOP_BKP_MODULE       Backup register with the module of the
+                              last watchdog reset
+    -----------------------------------------------------------------------*/
+#define CFG_LOOP_STALL_MS           (20)
+#define CFG_LOOP_WATCHDOG_MS        (8000)
+#define CFG_LOOP_BKP_TAG            BKP_DR2
+#define CFG_LOOP_BKP_RESETS         BKP_DR3
+#define CFG_LOOP_BKP_MODULE         BKP_DR5
+/*=========================================================================*/
+
+/*=========================================================================
+    TRACE
+    -----------------------------------------------------------------------
+
+    CFG_TRACE                 If this field is defined interrupts, DCF
+                              edges, protocol packets, display updates and
+                              config writes are logged into a RAM ring,
+                              dumped in binary with 'trace dump' and
+                              decoded by tools/trace_decode.py. Without it
+                              the trace points compile to nothing.
+    CFG_TRACE_RECORDS         Records in the ring, 8 bytes each (power
+                              of 2)
+    -----------------------------------------------------------------------*/
+#define CFG_TRACE
+#define CFG_TRACE_RECORDS           (256)
+/*=========================================================================*/
+
+/*=========================================================================
+    DCF
+    -----------------------------------------------------------------------
+
+    CFG_DCF_EDGE_FIFO         Receiver edges the pin interrupt can queue
+                              with their timestamps before the main loop
+                              decodes them (power of 2, max. 128)
+    CFG_DCF_SYNC_FRAMES       Valid frames in a row, a minute apart, before
+                              the RTC is corrected, then every minute
+    CFG_DCF_SYNC_MIN_MS       Smaller corrections are not written to the
+                              RTC, only shown by 'dcf_stat'
+    CFG_DCF_SAMPLER           If this field is defined TIM3 samples the
+                              receiver output at 1 kHz instead of the pin
+                              interrupt taking every edge. Spikes and
+                              dropouts shorter than the integrator are
+                              filtered, at the cost of 1000 interrupts a
+                              second.
+    CFG_DCF_SAMPLER_INTEGRATOR  Samples (ms) a level must outweigh the
+                              other to pass the filter, 1..50
+    -----------------------------------------------------------------------*/
+#define CFG_DCF_EDGE_FIFO           (16)
+#define CFG_DCF_SYNC_FRAMES         (3)
+#define CFG_DCF_SYNC_MIN_MS         (10)
+//#define CFG_DCF_SAMPLER
+#define CFG_DCF_SAMPLER_INTEGRATOR  (20)
+/*=========================================================================*/
+
+/*=========================================================================
+    GPS
+    -----------------------------------------------------------------------
+
+    CFG_GPS                   If this field is defined the GPS clock source
+                              reads the NMEA receiver on USART2. The DMA
+                              fills CFG_USART2_BUFSIZE as a ring, the main
+                              loop parses it on the half, full and idle
+                              line interrupts instead of one interrupt per
+                              character. Replay logs with tools/gps_replay.c
+                              to size the ring for the baud rate.
+    CFG_GPS_BAUDRATE          Of the receiver, 9600 for most modules
+    CFG_GPS_SENTENCE_DELAY_MS Time from the UTC second to the start of its
+                              RMC sentence, depends on the receiver
+    CFG_GPS_SYNC_SENTENCES    Valid RMC sentences in a row, a second apart,
+                              before the RTC is corrected
+    CFG_GPS_SYNC_MIN_MS       Smaller corrections are not written to the
+                              RTC, only shown by 'gps_stat'
+    CFG_GPS_PPS               If this field is defined the PPS output of
+                              the receiver on PA1 is captured by TIM2
+                              channel 2 (needs CFG_TIMER_TICKLESS). The
+                              RMC sentence after an edge names its second,
+                              which the RTC is aligned to. Without edges
+                              the idle line dates the second. PA1 is
+                              pulled down for boards without the line.
+    CFG_GPS_PPS_TOLERANCE_US  An edge is only taken as PPS this close to
+                              a second after the one before, otherwise
+                              the idle line dates the second
+    CFG_GPS_PPS_SYNC_MIN_US   Smaller corrections by PPS are not written
+                              to the RTC. The LSE drifts about 20 us a
+                              second, so the RTC is set every few ten
+                              seconds to stay below this.
+    CFG_GPS_UBX               If this field is defined the receiver is
+                              switched to UBX NAV-TIMEUTC and TIM-TP at
+                              start, 'gps_ubx' switches it at run time.
+                              The time then comes from NAV-TIMEUTC instead
+                              of the RMC sentence, without PPS the sentence
+                              delay is taken as its delay.
+    -----------------------------------------------------------------------*/
+#define CFG_GPS
+#define CFG_GPS_BAUDRATE            (9600)
+#define CFG_GPS_SENTENCE_DELAY_MS   (0)
+#define CFG_GPS_SYNC_SENTENCES      (3)
+#define CFG_GPS_SYNC_MIN_MS         (10)
+#define CFG_GPS_PPS
+#define CFG_GPS_PPS_SYNC_MIN_US     (500)
+#define CFG_GPS_PPS_TOLERANCE_US    (1000)
+//#define CFG_GPS_UBX
+/*=========================================================================*/
+
 /*=========================================================================
     FLIP_BUS
     -----------------------------------------------------------------------
@@ -103,10 +270,13 @@
     CFG_USART2_BUFSIZE        The length in bytes of the USART2 RX FIFO.
                               This will determine the maximum number of
                               received characters to store in memory.
+                              With CFG_GPS the DMA ring, a power of 2
+                              that holds what arrives while the main
+                              loop is busy.
 
     -----------------------------------------------------------------------*/
 #define CFG_USART2_BAUDRATE           (115200)
-#define CFG_USART2_BUFSIZE            (256)
+#define CFG_USART2_BUFSIZE            (1024)
 /*=========================================================================*/
 
 /*=========================================================================
@@ -166,9 +336,13 @@
 
     CFG_PROTOCOL              If this field is defined a binary protocol
                               will be used
+    CFG_PROTOCOL_USBCDC       If this field is defined the protocol shares
+                              the USB port with the CLI. Its frames start
+                              with 0xB5, which the CLI never takes, the
+                              bytes outside a frame go on to the CLI.
     -----------------------------------------------------------------------*/
 #define CFG_PROTOCOL
-//#define CFG_PROTOCOL_USBCDC
+#define CFG_PROTOCOL_USBCDC
 //#define CFG_PROTOCOL_USART1
 //#define CFG_PROTOCOL_UART2
 /*=========================================================================*/
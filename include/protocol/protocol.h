@@ -4,8 +4,13 @@
 #include "platform_config.h"
 #include <stdbool.h>
 
-#define PROTOCOL_SYNC_0 0xB5
-#define PROTOCOL_SYNC_1 0x62
+#include "loop.h"
+#include "protocol/ubx.h"
+#include "rtc/dcf_decoder.h"
+
+/* UBX framing, see protocol/ubx.h */
+#define PROTOCOL_SYNC_0 UBX_SYNC_0
+#define PROTOCOL_SYNC_1 UBX_SYNC_1
 #define PROTOCOL_HEADER_SIZE 0x06
 #define PROTOCOL_PAYLOAD_SIZE 0x5FF
 
@@ -38,6 +43,10 @@ uint16_t protocolCalculateChecksum(const protocolPacket_t *packet);
 #define PROTOCOL_MSG_ID_TIM_STD 0x0202
 #define PROTOCOL_MSG_ID_TIM_DST 0x0203
 #define PROTOCOL_MSG_ID_TIM_SRC 0x0204
+#define PROTOCOL_MSG_ID_TIM_ZON 0x0205
+#define PROTOCOL_MSG_ID_TIM_DCF 0x0206
+
+#define PROTOCOL_MSG_ID_SYS_LOP 0x0301
 
 #define PROTOCOL_MSG_ID_NIX_TYP 0x0801
 #define PROTOCOL_MSG_ID_NIX_MOD 0x0802
@@ -92,6 +101,53 @@ typedef struct
     uint8_t src;
 } protocolMsgTimSrc_t;
 
+typedef struct
+{
+    uint8_t zone;
+    int16_t stdOffset;
+    uint8_t stdHour;
+    uint8_t stdDow;
+    uint8_t stdWeek;
+    uint8_t stdMonth;
+    int16_t dstOffset;
+    uint8_t dstHour;
+    uint8_t dstDow;
+    uint8_t dstWeek;
+    uint8_t dstMonth;
+} protocolMsgTimZon_t;
+
+typedef struct
+{
+    uint32_t edges;
+    uint32_t glitches;
+    uint32_t missing;
+    uint32_t uncertain;
+    uint32_t tooLong;
+    uint32_t minuteEdges;
+    uint32_t minuteGlitches;
+    uint32_t minuteMissing;
+    uint32_t minuteUncertain;
+    uint32_t minuteTooLong;
+    uint32_t marks;
+    uint32_t decoded;
+    uint32_t failed[DCF_FIELD_COUNT];
+    uint32_t sinceValid;
+    uint32_t width[DCF_WIDTH_BINS];
+} protocolMsgTimDcf_t;
+
+typedef struct
+{
+    uint32_t passes;
+    uint32_t worstCycles;
+    uint32_t stalls;
+    uint16_t watchdogResets;
+    uint8_t worstModule;
+    uint8_t lastStallModule;
+    uint8_t watchdogModule;
+    uint8_t watchdogReset;
+    uint32_t buckets[LOOP_BUCKETS];
+} protocolMsgSysLop_t;
+
 
 typedef struct
 {
@@ -150,6 +206,8 @@ void protocolMsgSendTimUtc(protocolMsgTimUtc_t *msg);
 void protocolMsgSendTimStd(protocolMsgTimStd_t *msg);
 void protocolMsgSendTimDst(protocolMsgTimDst_t *msg);
 void protocolMsgSendTimSrc(protocolMsgTimSrc_t *msg);
+void protocolMsgSendTimZon(protocolMsgTimZon_t *msg);
+void protocolMsgSendTimDcf(protocolMsgTimDcf_t *msg);
 
 void protocolMsgPollCallbackTimUtc(void);
 void protocolMsgCallbackTimUtc(protocolMsgTimUtc_t *utc);
@@ -159,6 +217,14 @@ void protocolMsgPollCallbackTimDst(void);
 void protocolMsgCallbackTimDst(protocolMsgTimDst_t *dst);
 void protocolMsgPollCallbackTimSrc(void);
 void protocolMsgCallbackTimSrc(protocolMsgTimSrc_t *src);
+void protocolMsgPollCallbackTimZon(uint8_t zone);
+void protocolMsgCallbackTimZon(protocolMsgTimZon_t *zon);
+void protocolMsgPollCallbackTimDcf(bool reset);
+
+
+void protocolMsgSendSysLop(protocolMsgSysLop_t *msg);
+
+void protocolMsgPollCallbackSysLop(bool reset);
 
 
 void protocolMsgSendNixTyp(protocolMsgNixTyp_t *msg);
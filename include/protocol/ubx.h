@@ -0,0 +1,76 @@
+#ifndef __UBX_H__
+#define __UBX_H__
+
+/* The UBX framer takes frames of the host protocol and of a u-blox
+   receiver one byte at a time. It uses no hardware, so it also builds on
+   the host, see tools/gps_replay.c */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UBX_SYNC_0          (0xB5)
+#define UBX_SYNC_1          (0x62)
+/* Sync, class, id, length and checksum around the payload */
+#define UBX_OVERHEAD        (8)
+/* Longest frame skipped when it is not taken, a longer length is an error */
+#define UBX_SKIP_MAX        (1024)
+
+/* Class in the low byte, in the order on the wire */
+#define UBX_MSG_ID(cls, id) ((uint16_t)((cls) | ((id) << 8)))
+
+/* Any payload up to the buffer */
+#define UBX_LENGTH_ANY      (0xFFFF)
+
+/* What a byte completed */
+typedef enum
+{
+    UBX_RX_NONE = 0,
+    UBX_RX_FRAME,               /**< Taken, checksum correct */
+    UBX_RX_CHECKSUM             /**< Taken, checksum wrong */
+} ubxRx_t;
+
+/* A message taken, the others are skipped without storing the payload */
+typedef struct
+{
+    uint16_t msgId;
+    uint16_t length;            /**< Payload, or UBX_LENGTH_ANY */
+} ubxMsg_t;
+
+typedef struct
+{
+    uint32_t frames;            /**< Taken, checksum correct */
+    uint32_t ignored;           /**< Not in the table or another length, checksum correct */
+    uint32_t checksum;          /**< Checksum wrong */
+    uint32_t overflows;         /**< Too long to take or skip, dropped at the header */
+} ubxStat_t;
+
+typedef struct
+{
+    /* Set by ubxFramerInit */
+    const ubxMsg_t *msgs;       /**< Messages taken, NULL for all */
+    uint8_t msgCount;
+    uint8_t *payload;
+    uint16_t size;
+
+    /* Frame being received */
+    uint8_t state;
+    bool take;
+    uint16_t index;
+    uint8_t a;
+    uint8_t b;
+
+    /* Last frame taken */
+    uint16_t msgId;
+    uint16_t length;
+    uint16_t checksum;          /**< As received, CK_B in the high byte */
+
+    ubxStat_t stat;
+} ubxFramer_t;
+
+void ubxFramerInit(ubxFramer_t *f, uint8_t *payload, uint16_t size, const ubxMsg_t *msgs, uint8_t msgCount);
+void ubxFramerReset(ubxFramer_t *f);
+bool ubxFramerIdle(const ubxFramer_t *f);
+ubxRx_t ubxFramerRx(ubxFramer_t *f, uint8_t c);
+uint16_t ubxChecksum(uint16_t msgId, const uint8_t *payload, uint16_t length);
+uint16_t ubxFrame(uint8_t *frame, uint16_t msgId, const uint8_t *payload, uint16_t length);
+
+#endif
@@ -41,10 +41,31 @@
 
 #include "platform_config.h"
 #include "rtc/rtc_functions.h"
+#include "rtc/rtc.h"
+#include "rtc/dcf_decoder.h"
+
+typedef struct
+{
+    dcfDecoderStat_t decoder;   /**< Edges, pulses and minutes */
+    uint32_t overflows;         /**< Edges lost, the queue was full */
+    uint8_t fifoMax;            /**< Most edges queued at one poll */
+    uint32_t latencyMaxMs;      /**< Longest time from capture to decoding */
+    uint32_t sinceValidS;       /**< Since the last valid frame, UINT32_MAX never */
+    uint32_t frames;            /**< Valid frames */
+    uint8_t agree;              /**< Of them in a row a minute apart */
+    uint32_t syncs;             /**< Corrections written to the RTC */
+    uint32_t skipped;           /**< Corrections below CFG_DCF_SYNC_MIN_MS */
+    uint32_t lastSync;          /**< UTC of the last agreeing minute mark, 0 never */
+    int32_t offsetUs;           /**< DCF - RTC at that mark */
+    uint32_t offsetMaxAbsUs;
+} dcfStat_t;
 
 void dcfInit(void);
+void dcfDeinit(void);
 void dcfSetCallback(void(*pFunc)(void));
 uint8_t dcfTime(rtcTime_t *local);
 void dcfPoll(void);
+void dcfGetStat(dcfStat_t *stat);
+void dcfResetStat(void);
 
 #endif
@@ -0,0 +1,127 @@
+#ifndef __DCF_DECODER_H__
+#define __DCF_DECODER_H__
+
+/* The DCF77 decoder only sees timestamped edges and uses no hardware, so
+   it also builds on the host, see tools/dcf_replay.c */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Edge time in us, from any start */
+typedef uint64_t dcfDecoderUs_t;
+
+/* What an edge did, a bitmask */
+typedef enum
+{
+    DCF_DECODER_NONE   = 0,
+    DCF_DECODER_SECOND = (1 << 0),  /**< Started a second */
+    DCF_DECODER_MINUTE = (1 << 1),  /**< Was a minute mark, the frame before decoded or not */
+    DCF_DECODER_VALID  = (1 << 2)   /**< The frame of the minute mark decoded */
+} dcfDecoderEvent_t;
+
+/* Bits of dcfDecoderTime_t flags */
+#define DCF_FLAG_CALL       (1 << 0)    /**< Bit 15, call bit of the transmitter */
+#define DCF_FLAG_CHANGE     (1 << 1)    /**< Bit 16, CET / CEST changes at the next hour */
+#define DCF_FLAG_CEST       (1 << 2)    /**< Bit 17, the time is CEST, UTC + 2 h */
+#define DCF_FLAG_CET        (1 << 3)    /**< Bit 18, the time is CET, UTC + 1 h */
+#define DCF_FLAG_LEAP       (1 << 4)    /**< Bit 19, leap second at the next hour */
+
+/* Received local time, the minute starting at the last minute mark */
+typedef struct
+{
+    uint8_t second;
+    uint8_t minute;
+    uint8_t hour;
+    uint8_t day;
+    uint8_t dow;                /**< 1 Monday .. 7 Sunday */
+    uint8_t month;
+    uint8_t year;               /**< 0..99 */
+    uint8_t flags;              /**< Bits 15..19 of the frame */
+} dcfDecoderTime_t;
+
+typedef struct
+{
+    uint32_t count;
+    int32_t lastUs;             /**< Deviation from the nominal length */
+    uint32_t maxAbsUs;
+    uint64_t sumAbsUs;
+} dcfError_t;
+
+/* Pulse lengths in the histogram, the last bin holds the longer ones */
+#define DCF_WIDTH_BIN_MS    (20)
+#define DCF_WIDTH_BINS      (14)
+
+/* Part of a frame that failed to decode */
+typedef enum
+{
+    DCF_FIELD_START = 0,        /**< Start bit 20 not 1 */
+    DCF_FIELD_MINUTE,           /**< No minute clearly best */
+    DCF_FIELD_HOUR,             /**< No hour clearly best */
+    DCF_FIELD_DATE,             /**< Date parity or uncertain bits */
+    DCF_FIELD_CHECK,            /**< Date out of range, weekday or CET / CEST wrong */
+    DCF_FIELD_COUNT
+} dcfField_t;
+
+typedef struct
+{
+    uint32_t edges;             /**< Edges decoded */
+    uint32_t glitches;          /**< Second starts off the phase */
+    uint32_t missing;           /**< Seconds without a pulse of 40 ms */
+    uint32_t uncertain;         /**< Pulses of 130..170 ms, between 0 and 1 */
+    uint32_t tooLong;           /**< Pulses ending after 260 ms */
+} dcfDecoderCount_t;
+
+typedef struct
+{
+    dcfDecoderCount_t total;
+    dcfDecoderCount_t minute;   /**< Of the last minute, mark to mark */
+    uint32_t marks;             /**< Minute marks */
+    uint32_t decoded;           /**< Of them with a valid frame */
+    uint32_t failed[DCF_FIELD_COUNT];   /**< Of them failed, by the first field that did */
+    uint32_t width[DCF_WIDTH_BINS];     /**< Pulse lengths, DCF_WIDTH_BIN_MS per bin */
+    dcfError_t pulse;           /**< Pulse length against 100 / 200 ms */
+    dcfError_t period;          /**< Second start against 1000 / 2000 ms */
+} dcfDecoderStat_t;
+
+/* Integrator of a sampled receiver output. A level change passes after
+   length samples, shorter spikes and dropouts do not. Both edges are
+   delayed by length samples, so the pulse lengths stay. */
+typedef struct
+{
+    uint8_t count;
+    uint8_t level;
+} dcfFilter_t;
+
+static inline uint8_t dcfFilterSample(dcfFilter_t *f, uint8_t sample, uint8_t length)
+{
+    if (sample != 0)
+    {
+        if (f->count < length)
+        {
+            f->count++;
+        }
+        if (f->count == length)
+        {
+            f->level = 1;
+        }
+    }
+    else
+    {
+        if (f->count > 0)
+        {
+            f->count--;
+        }
+        if (f->count == 0)
+        {
+            f->level = 0;
+        }
+    }
+    return f->level;
+}
+
+void dcfDecoderInit(void);
+uint8_t dcfDecoderEdge(dcfDecoderUs_t time, uint8_t level);
+bool dcfDecoderTime(dcfDecoderTime_t *time);
+void dcfDecoderGetStat(dcfDecoderStat_t *stat);
+void dcfDecoderResetStat(void);
+
+#endif
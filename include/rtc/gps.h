@@ -40,21 +40,49 @@
 
 #include "platform_config.h"
 #include "rtc/rtc.h"
+#include "rtc/rtc_functions.h"
+#include "rtc/gps_feed.h"
+#include "rtc/nmea.h"
+#include "rtc/ubx_time.h"
 
 typedef struct
 {
-    float time;
-    uint32_t date;
-    float latitude;
-    float longitude;
-    uint8_t valid;
-} gprmc_t;
+    gpsFeedStat_t feed;         /**< Characters and idle lines */
+    nmeaStat_t nmea;            /**< Sentences */
+    ubxStat_t ubx;              /**< UBX frames */
+    uint32_t rmc;               /**< RMC sentences */
+    uint32_t rmcValid;          /**< Of them with a fix */
+    uint32_t timeUtc;           /**< NAV-TIMEUTC messages */
+    uint32_t timeUtcValid;      /**< Of them with valid UTC */
+    uint32_t tAcc;              /**< Time accuracy of the last NAV-TIMEUTC, ns */
+    int32_t nano;               /**< Its fraction of the second, ns */
+    uint32_t tp;                /**< TIM-TP messages */
+    int32_t qErr;               /**< Quantization error of the last pulse, ps */
+    uint32_t acks;              /**< Configuration acknowledged */
+    uint32_t naks;              /**< Configuration refused */
+    uint32_t dated;             /**< Time messages with a start time from the idle line */
+    uint32_t pps;               /**< PPS edges captured */
+    uint32_t ppsPaired;         /**< Time messages dated after the edge of their second */
+    uint32_t ppsUnpaired;       /**< Time messages dated without that edge while PPS runs */
+    uint32_t ppsAperiodic;      /**< Edges not a second after the one before, not paired */
+    int32_t ppsPeriodUs;        /**< Last PPS interval - 1 s by the timer clock */
+    uint32_t ppsPeriodMaxAbsUs;
+    uint8_t agree;              /**< Valid in a row a second apart */
+    uint32_t syncs;             /**< Corrections written to the RTC */
+    uint32_t skipped;           /**< Corrections below the minimum */
+    uint32_t lastSync;          /**< UTC of the last agreeing message, 0 never */
+    bool lastSyncPps;           /**< Its second was a PPS edge, not the idle line */
+    int32_t offsetUs;           /**< GPS - RTC at its second */
+    uint32_t offsetMaxAbsUs;
+} gpsStat_t;
 
 void gpsInit(void);
+void gpsDeinit(void);
 void gpsSetCallback(void(*pFunc)(void));
 error_t gpsTime(rtcTime_t *utc);
 void gpsPoll(void);
-void gpsRx(uint8_t c);
-bool nmeaParse(char *cmd);
+void gpsGetStat(gpsStat_t *stat);
+void gpsResetStat(void);
+void gpsSetUbx(bool ubx);
 
 #endif
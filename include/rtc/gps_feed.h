@@ -0,0 +1,36 @@
+#ifndef __GPS_FEED_H__
+#define __GPS_FEED_H__
+
+/* The GPS feed reads the circular receive buffer the DMA writes and
+   passes the characters to the NMEA parser and the UBX time decoder. It
+   uses no hardware, so it also builds on the host, see
+   tools/gps_replay.c */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rtc/nmea.h"
+#include "rtc/ubx_time.h"
+
+/* Time in us, from any start */
+typedef uint64_t gpsFeedUs_t;
+
+/* Bit of a sentence type or UBX message in the mask gpsFeedData returns */
+#define GPS_FEED_SENTENCE(s)    (1 << (s))
+#define GPS_FEED_UBX(m)         (1 << (8 + (m)))
+
+typedef struct
+{
+    uint32_t bytes;             /**< Characters parsed */
+    uint32_t lost;              /**< Characters overwritten before they were read */
+    uint32_t idles;             /**< Idle lines, the ends of the bursts */
+    uint32_t idlesMissed;       /**< Idle lines not seen, more than one between two polls */
+} gpsFeedStat_t;
+
+void gpsFeedInit(uint32_t baudrate);
+void gpsFeedIdle(uint32_t count, uint32_t written, gpsFeedUs_t time);
+uint16_t gpsFeedData(const uint8_t *ring, uint32_t size, uint32_t written);
+bool gpsFeedTimeStarted(gpsFeedUs_t *time);
+void gpsFeedGetStat(gpsFeedStat_t *stat);
+void gpsFeedResetStat(void);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __NMEA_H__
+#define __NMEA_H__
+
+/* The NMEA parser takes the receiver output one character at a time and
+   uses no hardware, so it also builds on the host, see tools/nmea_bench.c */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Longest sentence from '$' to the checksum, 82 with CR LF */
+#define NMEA_SENTENCE_MAX   (80)
+/* Longest field of the sentences decoded */
+#define NMEA_FIELD_MAX      (15)
+
+/* What a character completed */
+typedef enum
+{
+    NMEA_NONE = 0,
+    NMEA_RMC,
+    NMEA_ZDA,
+    NMEA_GGA
+} nmeaSentence_t;
+
+/* UTC time of day */
+typedef struct
+{
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint16_t millis;
+} nmeaTime_t;
+
+typedef struct
+{
+    nmeaTime_t time;
+    uint8_t day;
+    uint8_t month;
+    uint8_t year;               /**< 0..99 */
+    bool valid;                 /**< Status A, time and date present */
+    int32_t latitude;           /**< 1e-7 degrees, north positive */
+    int32_t longitude;          /**< 1e-7 degrees, east positive */
+} nmeaRmc_t;
+
+typedef struct
+{
+    nmeaTime_t time;
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+    bool valid;                 /**< Time and date present */
+} nmeaZda_t;
+
+typedef struct
+{
+    nmeaTime_t time;
+    uint8_t quality;            /**< 0 no fix, 1 GPS, 2 DGPS .. */
+    uint8_t satellites;
+    bool valid;                 /**< Time present and a fix */
+    int32_t latitude;           /**< 1e-7 degrees, north positive */
+    int32_t longitude;          /**< 1e-7 degrees, east positive */
+    int32_t altitudeCm;         /**< Above mean sea level */
+    uint16_t hdop;              /**< 1/100 */
+} nmeaGga_t;
+
+typedef struct
+{
+    uint32_t sentences;         /**< Decoded, checksum correct */
+    uint32_t ignored;           /**< Other sentences, checksum correct */
+    uint32_t checksum;          /**< Checksum wrong or missing */
+    uint32_t overflows;         /**< Longer than NMEA_SENTENCE_MAX */
+    uint32_t fields;            /**< Field not a number or out of range */
+} nmeaStat_t;
+
+void nmeaInit(void);
+nmeaSentence_t nmeaRx(uint8_t c);
+void nmeaGetRmc(nmeaRmc_t *rmc);
+void nmeaGetZda(nmeaZda_t *zda);
+void nmeaGetGga(nmeaGga_t *gga);
+void nmeaGetStat(nmeaStat_t *stat);
+void nmeaResetStat(void);
+
+#endif
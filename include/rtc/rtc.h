@@ -3,9 +3,43 @@
 
 #include "platform_config.h"
 #include <stddef.h>
+#include <stdbool.h>
+
+/* Ticks of the prescaler divider per second (LSE 32.768 kHz) */
+#define RTC_TICKS_PER_SECOND    (32768)
+
+typedef struct
+{
+    uint32_t seconds;   /**< Seconds since 1970 (UTC) */
+    uint16_t ticks;     /**< 1/RTC_TICKS_PER_SECOND seconds elapsed within the second */
+} rtcPrecise_t;
+
+typedef struct
+{
+    uint32_t isrCycles;         /**< Cycles spent in the last second interrupt */
+    uint32_t isrCyclesMax;
+    uint32_t latencyCycles;     /**< Cycles from the last second interrupt until it was handled */
+    uint32_t latencyCyclesMax;
+    uint32_t events;            /**< Second events handled */
+    uint32_t eventsMissed;      /**< Second events overwritten before they were handled */
+    uint32_t setCycles;         /**< Cycles of the last set that only wrote the counter */
+    uint32_t setCyclesMax;
+    uint32_t setFullCycles;     /**< Cycles of the last set with full configuration */
+    uint32_t setFullCyclesMax;
+} rtcStat_t;
 
 void rtcInit(void);
 uint32_t rtcGet(void);
 void rtcSet(uint32_t t);
+bool rtcTakeEvent(uint32_t *cycles);
+void rtcEventHandled(uint32_t cycles);
+void rtcGetStat(rtcStat_t *stat);
+void rtcGetPrecise(rtcPrecise_t *p);
+void rtcSetPrecise(const rtcPrecise_t *p);
+
+int32_t rtcPreciseDiff(const rtcPrecise_t *a, const rtcPrecise_t *b);
+uint16_t rtcTicksToMillis(uint16_t ticks);
+uint32_t rtcTicksToNanos(uint16_t ticks);
+uint16_t rtcNanosToTicks(uint32_t nanos);
 
 #endif
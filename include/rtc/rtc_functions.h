@@ -141,6 +141,7 @@ error_t   rtcCreateTime ( uint32_t year, rtcMonths_t month, uint8_t day, uint8_t
 error_t   rtcCreateTimeFromEpoch ( uint32_t epochTime, rtcTime_t *time );
 error_t   rtcCreateTimeFromSecondsSince1980 ( uint32_t seconds, rtcTime_t *time );
 error_t   rtcAssignWeekday ( rtcTime_t *t );
+error_t   rtcTickSecond ( rtcTime_t *t );
 error_t   rtcAddSeconds ( rtcTime_t *t, int32_t s );
 error_t   rtcAddMinutes ( rtcTime_t *t, int32_t m );
 error_t   rtcAddHours ( rtcTime_t *t, int32_t h );
@@ -151,6 +152,7 @@ error_t   rtcGetDifference ( rtcTime_t *t1, rtcTime_t *t2, int32_t *seconds );
 error_t   rtcGetWeekday ( uint32_t year, rtcMonths_t month, uint8_t day, rtcWeekdays_t *weekDay );
 error_t   rtcGetWeekNumber ( rtcTime_t *t, uint8_t *weekNumber );
 int32_t   rtcGetDaysInYear ( int32_t year );
+uint8_t   rtcGetDaysInMonth ( uint32_t year, rtcMonths_t month );
 uint32_t  rtcGetEpochDate ( uint32_t year, rtcMonths_t month, uint8_t day );
 uint32_t  rtcToEpochTime ( rtcTime_t *t );
 uint32_t  rtcToSecondsSince1980 ( rtcTime_t *t );
@@ -18,7 +18,7 @@ typedef struct tzRule_st
     uint8_t hour;
     uint8_t dow;
     uint8_t week;    /**< Zero-based, first day of week = Monday (use rtcWeekdays_t) */
-    uint8_t month;   /**< One-based (use rtcMonths_t) */
+    uint8_t month;   /**< One-based (use rtcMonths_t), 0 = zone without DST */
     int16_t offset;
 } tzRule_t;
 
@@ -41,4 +41,24 @@ void   tzLocalToUTC( rtcTime_t *local, rtcTime_t *utc );
 bool tzUTCIsDST( rtcTime_t *utc );
 bool tzLocalIsDST( rtcTime_t *local );
 
+uint32_t tzEpochUTCToLocal( uint32_t utc );
+uint32_t tzEpochLocalToUTC( uint32_t local );
+bool tzEpochUTCIsDST( uint32_t utc );
+bool tzEpochLocalIsDST( uint32_t local );
+
+void   tzZoneSetSTD( uint8_t zone, tzRule_t *std );
+void   tzZoneGetSTD( uint8_t zone, tzRule_t *std );
+void   tzZoneStoreSTD( uint8_t zone, tzRule_t *std );
+void   tzZoneLoadSTD( uint8_t zone, tzRule_t *std );
+void   tzZoneSetDST( uint8_t zone, tzRule_t *dst );
+void   tzZoneGetDST( uint8_t zone, tzRule_t *dst );
+void   tzZoneStoreDST( uint8_t zone, tzRule_t *dst );
+void   tzZoneLoadDST( uint8_t zone, tzRule_t *dst );
+
+uint32_t tzZoneEpochUTCToLocal( uint8_t zone, uint32_t utc );
+uint32_t tzZoneEpochLocalToUTC( uint8_t zone, uint32_t local );
+bool tzZoneEpochUTCIsDST( uint8_t zone, uint32_t utc );
+bool tzZoneEpochLocalIsDST( uint8_t zone, uint32_t local );
+void   tzZonesEpochUTCToLocal( uint32_t utc, uint32_t *local, uint8_t count );
+
 #endif
@@ -0,0 +1,86 @@
+#ifndef __UBX_TIME_H__
+#define __UBX_TIME_H__
+
+/* The UBX time decoder takes the receiver output one byte at a time
+   through the shared UBX framer and decodes the timing messages. It uses
+   no hardware, so it also builds on the host, see tools/gps_replay.c */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "protocol/ubx.h"
+
+#define UBX_NAV_TIMEUTC             UBX_MSG_ID(0x01, 0x21)
+#define UBX_TIM_TP                  UBX_MSG_ID(0x0D, 0x01)
+#define UBX_ACK_NAK                 UBX_MSG_ID(0x05, 0x00)
+#define UBX_ACK_ACK                 UBX_MSG_ID(0x05, 0x01)
+#define UBX_CFG_PRT                 UBX_MSG_ID(0x06, 0x00)
+#define UBX_CFG_MSG                 UBX_MSG_ID(0x06, 0x01)
+
+#define UBX_NAV_TIMEUTC_LENGTH      (20)
+#define UBX_TIM_TP_LENGTH           (16)
+#define UBX_ACK_LENGTH              (2)
+
+/* NAV-TIMEUTC valid */
+#define UBX_TIMEUTC_VALID_TOW       (1 << 0)
+#define UBX_TIMEUTC_VALID_WKN       (1 << 1)
+#define UBX_TIMEUTC_VALID_UTC       (1 << 2)
+
+/* TIM-TP flags */
+#define UBX_TIM_TP_UTC              (1 << 0)    /**< Pulse time in UTC, not GPS time */
+#define UBX_TIM_TP_UTC_AVAILABLE    (1 << 1)
+
+/* Room for the frames ubxTimeConfig writes */
+#define UBX_TIME_CONFIG_MAX         (2 * (3 + UBX_OVERHEAD) + 20 + UBX_OVERHEAD)
+
+/* What a byte completed */
+typedef enum
+{
+    UBX_TIME_NONE = 0,
+    UBX_TIME_TIMEUTC,
+    UBX_TIME_TP,
+    UBX_TIME_ACK,
+    UBX_TIME_NAK
+} ubxTimeMsg_t;
+
+typedef struct
+{
+    uint32_t iTow;              /**< GPS time of week of the epoch, ms */
+    uint32_t tAcc;              /**< Time accuracy estimate, ns */
+    int32_t nano;               /**< Fraction of the second, -1e9..1e9 ns */
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t valid;              /**< UBX_TIMEUTC_VALID_* */
+} ubxTimeUtc_t;
+
+typedef struct
+{
+    uint32_t towMs;             /**< Time of week of the next pulse */
+    uint32_t towSubMs;          /**< Fraction of the ms, 2^-32 */
+    int32_t qErr;               /**< Quantization error of the pulse, ps */
+    uint16_t week;
+    uint8_t flags;              /**< UBX_TIM_TP_* */
+    uint8_t refInfo;
+} ubxTimeTp_t;
+
+typedef struct
+{
+    uint16_t msgId;             /**< Acknowledged, or not */
+    bool ack;
+} ubxTimeAck_t;
+
+void ubxTimeInit(void);
+void ubxTimeReset(void);
+bool ubxTimeIdle(void);
+ubxTimeMsg_t ubxTimeRx(uint8_t c);
+void ubxTimeGetUtc(ubxTimeUtc_t *utc);
+void ubxTimeGetTp(ubxTimeTp_t *tp);
+void ubxTimeGetAck(ubxTimeAck_t *ack);
+uint16_t ubxTimeConfig(uint8_t *frames, uint32_t baudrate, bool ubx);
+void ubxTimeGetStat(ubxStat_t *stat);
+void ubxTimeResetStat(void);
+
+#endif
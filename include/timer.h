@@ -7,13 +7,30 @@
 #define TIMER_H_
 
 #include "cmsis_device.h"
+#include <stdbool.h>
 
 // ----------------------------------------------------------------------------
 
 #define TIMER_FREQUENCY_HZ (100000u)
 
 typedef uint32_t timer_ticks_t;
-extern volatile timer_ticks_t timer_delayCount;
+typedef uint64_t timer_uptime_t;
+
+// Software timer, kept in a list sorted by deadline. The storage belongs
+// to the caller and must stay valid while the timer is active.
+typedef struct timer_soft_s timer_soft_t;
+typedef void (*timer_callback_t) (timer_soft_t *timer);
+
+struct timer_soft_s
+{
+  timer_soft_t *next;
+  timer_ticks_t deadline;
+  timer_ticks_t period;         // 0 for a one-shot timer
+  timer_callback_t callback;    // called by timer_poll, may be NULL
+  bool active;
+  bool expired;                 // set on expiry, cleared by timer_expired
+  uint32_t overruns;            // periods skipped by a late poll
+};
 
 extern void
 timer_init (void);
@@ -21,8 +38,74 @@ timer_init (void);
 extern void
 timer_sleep (timer_ticks_t ticks);
 
+// Tick interrupt without CFG_TIMER_TICKLESS.
 void timer_tick (void);
 
+// Timer interrupts since timer_init.
+extern uint32_t
+timer_isr_count (void);
+
+// Ticks since timer_init, wraps after ~11.9 h at 100 kHz.
+extern timer_ticks_t
+timer_now (void);
+
+// Ticks since timer_init, never wraps. Lock-free, safe in interrupts.
+extern timer_uptime_t
+timer_uptime (void);
+
+// Ticks and milliseconds since an earlier timer_uptime, the milliseconds
+// saturate at UINT32_MAX (~49 days).
+extern timer_uptime_t
+timer_elapsed (timer_uptime_t since);
+
+extern uint32_t
+timer_elapsed_ms (timer_uptime_t since);
+
+extern uint32_t
+timer_to_ms (timer_uptime_t ticks);
+
+// Starts (or restarts) a timer expiring after delay ticks and then every
+// period ticks. Delays and periods must stay below 2^31 ticks. Only to be
+// called from the main loop, including timer callbacks.
+extern void
+timer_start (timer_soft_t *timer, timer_ticks_t delay, timer_ticks_t period,
+             timer_callback_t callback);
+
+extern void
+timer_stop (timer_soft_t *timer);
+
+extern bool
+timer_active (timer_soft_t *timer);
+
+// Returns and clears the expired flag, for timers without a callback.
+extern bool
+timer_expired (timer_soft_t *timer);
+
+// Expires due timers and runs their callbacks, called by the main loop
+// for EVENT_TIMER.
+extern void
+timer_poll (void);
+
+// Input capture of the rising edges on TIM2 channel 2 (PA1), exact to a
+// tick, each posts EVENT_CAPTURE. CFG_TIMER_TICKLESS only.
+extern void
+timer_capture_init (void);
+
+// Stops the interrupt of the capture, TIM2 keeps counting the uptime.
+extern void
+timer_capture_deinit (void);
+
+// Edges captured since timer_capture_init and the uptime of the last one.
+extern uint32_t
+timer_capture (timer_uptime_t *time);
+
+// Core clock cycles from the DWT cycle counter, wraps every ~59 s at 72 MHz.
+static inline uint32_t
+timer_cycles (void)
+{
+  return DWT->CYCCNT;
+}
+
 // ----------------------------------------------------------------------------
 
 #endif // TIMER_H_
@@ -0,0 +1,53 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "platform_config.h"
+
+/* Trace points, keep the names in tools/trace_decode.py in the same order */
+typedef enum
+{
+    TRACE_NONE = 0,
+    TRACE_ISR_RTC,              /**< arg8, arg16: RTC counter bits 16..23, 0..15 */
+    TRACE_ISR_USART1,           /**< arg8: received char */
+    TRACE_ISR_USART2,           /**< arg8: received char */
+    TRACE_ISR_USB,
+    TRACE_ISR_TIMER,            /**< arg8: bit 0 overflow, bit 1 compare, bit 2 capture, tickless only */
+    TRACE_DCF_EDGE,             /**< arg8: receiver output level */
+    TRACE_PROTOCOL_PACKET,      /**< arg8: 0 bad checksum, 1 handled, 2 unknown, arg16: message id */
+    TRACE_NIXIE_DISPLAY,        /**< arg8: tubes, arg16: first 4 digits, one per nibble */
+    TRACE_FLIPDOT_SET,          /**< arg8: columns, arg16: dots flipped */
+    TRACE_CONFIG_WRITE,         /**< arg8: variables, arg16: first EEPROM virtual address */
+    TRACE_DCF_SYNC,             /**< arg8: 1 RTC set, 0 below the minimum, arg16: |correction| in ms */
+    TRACE_GPS_SYNC,             /**< arg8: 1 RTC set, 0 below the minimum, arg16: |correction| in ms */
+    TRACE_ID_COUNT
+} traceId_t;
+
+/* One record, dumped as is (little endian) */
+typedef struct
+{
+    uint32_t cycles;            /**< DWT cycle counter */
+    uint8_t id;
+    uint8_t arg8;
+    uint16_t arg16;
+} traceRecord_t;
+
+#define TRACE_MAGIC         "TRC1"
+
+#ifdef CFG_TRACE
+
+#define TRACE(id, arg8, arg16)  traceWrite((id), (arg8), (arg16))
+
+void traceWrite(traceId_t id, uint8_t arg8, uint16_t arg16);
+void traceClear(void);
+uint32_t traceGetWritten(void);
+uint32_t traceGetDropped(void);
+void traceDump(void (*send)(uint8_t *, uint32_t));
+
+#else
+
+/* Not evaluated, only keeps the arguments from being reported unused */
+#define TRACE(id, arg8, arg16)  ((void)sizeof((id) + (arg8) + (arg16)))
+
+#endif // CFG_TRACE
+
+#endif
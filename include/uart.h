@@ -1,7 +1,13 @@
 #include "platform_config.h"
+#include "timer.h"
 
 void uart1Init(void);
 void uart2Init(void);
+void uart2InitDma(uint32_t baudrate);
+void uart2DeinitDma(void);
+uint32_t uart2DmaWritten(void);
+uint32_t uart2DmaIdle(uint32_t *written, timer_uptime_t *time);
+const uint8_t *uart2DmaBuffer(void);
 void uart1SendChar(uint8_t c);
 void uart2SendChar(uint8_t c);
 void uart1Send(uint8_t *buffer, uint32_t length);
@@ -0,0 +1,86 @@
+/**************************************************************************/
+/*!
+    @file     cmd_perf.c
+    @author   Janis (jan1s@github)
+
+    @ingroup  CLI
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2016, Janis
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "platform_config.h"
+
+#ifdef CFG_PERF
+
+#include "cli/cli.h"
+#include "print.h"
+#include "perf.h"
+
+/**************************************************************************/
+/*!
+    'perf' command handler, 'perf reset' clears the probes
+*/
+/**************************************************************************/
+void cmd_perf(cli_select_t t, uint8_t argc, char **argv)
+{
+    if(argc > 0)
+    {
+        if(strncmp(argv[0], "reset", 5) == 0)
+        {
+            perfReset();
+            print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
+        }
+        else
+        {
+            print(cli_send[t], "%s%s", "ERROR", CFG_PRINTF_NEWLINE);
+        }
+        return;
+    }
+
+    print(cli_send[t], "%-13s %10s %10s %10s %10s (%s)%s", "probe", "count", "min", "avg", "max", PERF_UNIT, CFG_PRINTF_NEWLINE);
+
+    for(uint8_t p = 0; p < PERF_PROBE_COUNT; p++)
+    {
+        perfStat_t stat;
+        perfGetStat((perfProbe_t)p, &stat);
+
+        uint32_t avg = (stat.count > 0) ? (uint32_t)(stat.total / stat.count) : 0;
+
+        print(cli_send[t], "%-13s %10lu %10lu %10lu %10lu%s", perfGetName((perfProbe_t)p),
+              (unsigned long)stat.count, (unsigned long)stat.min,
+              (unsigned long)avg, (unsigned long)stat.max, CFG_PRINTF_NEWLINE);
+    }
+}
+
+#endif // CFG_PERF
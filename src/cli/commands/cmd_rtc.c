@@ -41,11 +41,14 @@
 
 #include "rtc/rtc.h"
 #include "rtc/rtc_functions.h"
+#include "rtc/dcf.h"
+#include "rtc/gps.h"
 #include "cli/cli.h"
 #include "print.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 void cmd_rtc_write(cli_select_t t, uint8_t argc, char **argv)
 {
@@ -113,3 +116,193 @@ void cmd_rtc_read(cli_select_t t, uint8_t argc, char **argv)
 
     print(cli_send[t], "%s: %04d %02d %02d %02d %02d %02d%s", "UTC", rt.years + 1900, rt.months + 1, rt.days, rt.hours, rt.minutes, rt.seconds, CFG_PRINTF_NEWLINE);
 }
+
+void cmd_rtc_stat(cli_select_t t, uint8_t argc, char **argv)
+{
+    rtcStat_t stat;
+    rtcGetStat(&stat);
+
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+
+    print(cli_send[t], "%s: %lu / %lu cycles (%lu / %lu us)%s", "ISR last/max",
+          (unsigned long)stat.isrCycles, (unsigned long)stat.isrCyclesMax,
+          (unsigned long)(stat.isrCycles / cyclesPerUs), (unsigned long)(stat.isrCyclesMax / cyclesPerUs), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu / %lu cycles (%lu / %lu us)%s", "Latency last/max",
+          (unsigned long)stat.latencyCycles, (unsigned long)stat.latencyCyclesMax,
+          (unsigned long)(stat.latencyCycles / cyclesPerUs), (unsigned long)(stat.latencyCyclesMax / cyclesPerUs), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu handled, %lu missed%s", "Events",
+          (unsigned long)stat.events, (unsigned long)stat.eventsMissed, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu / %lu cycles (%lu / %lu us)%s", "Set counter last/max",
+          (unsigned long)stat.setCycles, (unsigned long)stat.setCyclesMax,
+          (unsigned long)(stat.setCycles / cyclesPerUs), (unsigned long)(stat.setCyclesMax / cyclesPerUs), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu / %lu cycles (%lu / %lu us)%s", "Set full last/max",
+          (unsigned long)stat.setFullCycles, (unsigned long)stat.setFullCyclesMax,
+          (unsigned long)(stat.setFullCycles / cyclesPerUs), (unsigned long)(stat.setFullCyclesMax / cyclesPerUs), CFG_PRINTF_NEWLINE);
+}
+
+static void cmd_dcf_stat_error(cli_select_t t, const char *name, const dcfError_t *e)
+{
+    uint32_t avg = (e->count > 0) ? (uint32_t)(e->sumAbsUs / e->count) : 0;
+
+    print(cli_send[t], "%s: %ld us, %s %lu / %lu us (%lu)%s", name, (long)e->lastUs, "avg/max",
+          (unsigned long)avg, (unsigned long)e->maxAbsUs, (unsigned long)e->count, CFG_PRINTF_NEWLINE);
+}
+
+void cmd_dcf_stat(cli_select_t t, uint8_t argc, char **argv)
+{
+    if(argc > 0)
+    {
+        if(strncmp(argv[0], "reset", 5) == 0)
+        {
+            dcfResetStat();
+            print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
+        }
+        else
+        {
+            print(cli_send[t], "%s%s", "ERROR", CFG_PRINTF_NEWLINE);
+        }
+        return;
+    }
+
+    dcfStat_t stat;
+    dcfGetStat(&stat);
+
+    const dcfDecoderStat_t *d = &stat.decoder;
+
+    print(cli_send[t], "%s: %lu decoded, %lu lost, %lu glitches%s", "Edges",
+          (unsigned long)d->total.edges, (unsigned long)stat.overflows, (unsigned long)d->total.glitches, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %u of %u, %s %lu ms%s", "Queue max", (unsigned int)stat.fifoMax, (unsigned int)CFG_DCF_EDGE_FIFO,
+          "decode latency max", (unsigned long)stat.latencyMaxMs, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu missing, %lu uncertain, %lu too long%s", "Pulses",
+          (unsigned long)d->total.missing, (unsigned long)d->total.uncertain, (unsigned long)d->total.tooLong, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu edges, %lu glitches, %lu missing, %lu uncertain, %lu too long%s", "Last minute",
+          (unsigned long)d->minute.edges, (unsigned long)d->minute.glitches, (unsigned long)d->minute.missing,
+          (unsigned long)d->minute.uncertain, (unsigned long)d->minute.tooLong, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu marks, %lu decoded, %s %lu start %lu minute %lu hour %lu date %lu check%s", "Minutes",
+          (unsigned long)d->marks, (unsigned long)d->decoded, "failed",
+          (unsigned long)d->failed[DCF_FIELD_START], (unsigned long)d->failed[DCF_FIELD_MINUTE],
+          (unsigned long)d->failed[DCF_FIELD_HOUR], (unsigned long)d->failed[DCF_FIELD_DATE],
+          (unsigned long)d->failed[DCF_FIELD_CHECK], CFG_PRINTF_NEWLINE);
+    if (stat.sinceValidS == UINT32_MAX)
+    {
+        print(cli_send[t], "%s: %s%s", "Last valid", "never", CFG_PRINTF_NEWLINE);
+    }
+    else
+    {
+        print(cli_send[t], "%s: %lu s ago%s", "Last valid", (unsigned long)stat.sinceValidS, CFG_PRINTF_NEWLINE);
+    }
+    for (uint8_t i = 0; i < DCF_WIDTH_BINS; i++)
+    {
+        if (i < DCF_WIDTH_BINS - 1)
+        {
+            print(cli_send[t], "%s %3u..%3u ms: %lu%s", "Width", (unsigned int)(i * DCF_WIDTH_BIN_MS),
+                  (unsigned int)((i + 1) * DCF_WIDTH_BIN_MS - 1), (unsigned long)d->width[i], CFG_PRINTF_NEWLINE);
+        }
+        else
+        {
+            print(cli_send[t], "%s %3u..    ms: %lu%s", "Width", (unsigned int)(i * DCF_WIDTH_BIN_MS),
+                  (unsigned long)d->width[i], CFG_PRINTF_NEWLINE);
+        }
+    }
+    cmd_dcf_stat_error(t, "Pulse error", &d->pulse);
+    cmd_dcf_stat_error(t, "Second error", &d->period);
+
+    print(cli_send[t], "%s: %lu frames, %u of %u in a row, %lu set, %lu below %u ms%s", "Sync",
+          (unsigned long)stat.frames, (unsigned int)stat.agree, (unsigned int)CFG_DCF_SYNC_FRAMES,
+          (unsigned long)stat.syncs, (unsigned long)stat.skipped, (unsigned int)CFG_DCF_SYNC_MIN_MS, CFG_PRINTF_NEWLINE);
+    if (stat.lastSync == 0)
+    {
+        print(cli_send[t], "%s: %s%s", "Last sync", "never", CFG_PRINTF_NEWLINE);
+    }
+    else
+    {
+        print(cli_send[t], "%s: %lu s ago, %s %ld us, %s %lu us%s", "Last sync", (unsigned long)(rtcGet() - stat.lastSync),
+              "offset", (long)stat.offsetUs, "max", (unsigned long)stat.offsetMaxAbsUs, CFG_PRINTF_NEWLINE);
+    }
+}
+
+#ifdef CFG_GPS
+void cmd_gps_stat(cli_select_t t, uint8_t argc, char **argv)
+{
+    if(argc > 0)
+    {
+        if(strncmp(argv[0], "reset", 5) == 0)
+        {
+            gpsResetStat();
+            print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
+        }
+        else
+        {
+            print(cli_send[t], "%s%s", "ERROR", CFG_PRINTF_NEWLINE);
+        }
+        return;
+    }
+
+    gpsStat_t stat;
+    gpsGetStat(&stat);
+
+    nmeaRmc_t rmc;
+    nmeaGetRmc(&rmc);
+
+    print(cli_send[t], "%s: %lu bytes, %lu overwritten, %s %lu baud ring %u%s", "Receive",
+          (unsigned long)stat.feed.bytes, (unsigned long)stat.feed.lost, "at",
+          (unsigned long)CFG_GPS_BAUDRATE, (unsigned int)CFG_USART2_BUFSIZE, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu seen, %lu missed%s", "Idle lines",
+          (unsigned long)stat.feed.idles, (unsigned long)stat.feed.idlesMissed, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu decoded, %lu other, %lu checksum, %lu too long, %lu bad field%s", "Sentences",
+          (unsigned long)stat.nmea.sentences, (unsigned long)stat.nmea.ignored, (unsigned long)stat.nmea.checksum,
+          (unsigned long)stat.nmea.overflows, (unsigned long)stat.nmea.fields, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu frames, %lu other, %lu checksum, %lu too long, %lu ack, %lu nak%s", "UBX",
+          (unsigned long)stat.ubx.frames, (unsigned long)stat.ubx.ignored, (unsigned long)stat.ubx.checksum,
+          (unsigned long)stat.ubx.overflows, (unsigned long)stat.acks, (unsigned long)stat.naks, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu RMC, %lu valid, %lu NAV-TIMEUTC, %lu valid, %lu dated%s", "Time",
+          (unsigned long)stat.rmc, (unsigned long)stat.rmcValid, (unsigned long)stat.timeUtc,
+          (unsigned long)stat.timeUtcValid, (unsigned long)stat.dated, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %02u:%02u:%02u.%03u %02u.%02u.%02u %s%s", "Last RMC",
+          (unsigned int)rmc.time.hour, (unsigned int)rmc.time.minute, (unsigned int)rmc.time.second,
+          (unsigned int)rmc.time.millis, (unsigned int)rmc.day, (unsigned int)rmc.month, (unsigned int)rmc.year,
+          rmc.valid ? "valid" : "no fix", CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %s %lu ns, %s %ld ns, %lu TIM-TP, %s %ld ps%s", "Last NAV-TIMEUTC",
+          "accuracy", (unsigned long)stat.tAcc, "fraction", (long)stat.nano, (unsigned long)stat.tp,
+          "pulse error", (long)stat.qErr, CFG_PRINTF_NEWLINE);
+
+#ifdef CFG_GPS_PPS
+    print(cli_send[t], "%s: %lu edges, %lu aperiodic, %lu paired, %lu unpaired, %s %ld us, %s %lu us%s", "PPS",
+          (unsigned long)stat.pps, (unsigned long)stat.ppsAperiodic, (unsigned long)stat.ppsPaired,
+          (unsigned long)stat.ppsUnpaired,
+          "period - 1 s", (long)stat.ppsPeriodUs, "max", (unsigned long)stat.ppsPeriodMaxAbsUs, CFG_PRINTF_NEWLINE);
+#endif
+
+    print(cli_send[t], "%s: %u of %u in a row, %lu set, %lu below the minimum%s", "Sync",
+          (unsigned int)stat.agree, (unsigned int)CFG_GPS_SYNC_SENTENCES,
+          (unsigned long)stat.syncs, (unsigned long)stat.skipped, CFG_PRINTF_NEWLINE);
+    if (stat.lastSync == 0)
+    {
+        print(cli_send[t], "%s: %s%s", "Last sync", "never", CFG_PRINTF_NEWLINE);
+    }
+    else
+    {
+        print(cli_send[t], "%s: %lu s ago %s, %s %ld us, %s %lu us%s", "Last sync", (unsigned long)(rtcGet() - stat.lastSync),
+              stat.lastSyncPps ? "by PPS" : "by idle line", "offset", (long)stat.offsetUs, "max",
+              (unsigned long)stat.offsetMaxAbsUs, CFG_PRINTF_NEWLINE);
+    }
+}
+
+void cmd_gps_ubx(cli_select_t t, uint8_t argc, char **argv)
+{
+    if(strncmp(argv[0], "on", 2) == 0)
+    {
+        gpsSetUbx(true);
+    }
+    else if(strncmp(argv[0], "off", 3) == 0)
+    {
+        gpsSetUbx(false);
+    }
+    else
+    {
+        print(cli_send[t], "%s%s", "ERROR", CFG_PRINTF_NEWLINE);
+        return;
+    }
+    print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
+}
+#endif
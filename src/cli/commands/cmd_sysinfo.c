@@ -44,6 +44,8 @@
 
 #include "cli/cli.h"
 #include "print.h"
+#include "event.h"
+#include "loop.h"
 
 #define STM32_UUID ((uint32_t *)0x1FFFF7E8)
 #define VERSION_STRING "v1.00"
@@ -61,3 +63,88 @@ void cmd_sysinfo(cli_select_t t, uint8_t argc, char **argv)
 
 	print(cli_send[t], "%s: %08x-%08x-%08x, %s: %s%s", "ID", idPart1, idPart2, idPart3, "VER", VERSION_STRING, CFG_PRINTF_NEWLINE);
 }
+
+/**************************************************************************/
+/*!
+    'cpu_stat' command handler
+*/
+/**************************************************************************/
+void cmd_cpu_stat(cli_select_t t, uint8_t argc, char **argv)
+{
+    eventStat_t stat;
+    eventGetStat(&stat);
+
+    /* The statistics cover one RTC second, i.e. SystemCoreClock cycles */
+    uint32_t cyclesPerMille = SystemCoreClock / 1000;
+    uint32_t duty = stat.busyCycles / cyclesPerMille;
+    uint32_t dutyMax = stat.busyCyclesMax / cyclesPerMille;
+
+    uint32_t idle = (duty < 1000) ? 1000 - duty : 0;
+
+    print(cli_send[t], "%s: %lu.%lu%% / %lu.%lu%% (%lu / %lu cycles)%s", "Duty last/max",
+          (unsigned long)(duty / 10), (unsigned long)(duty % 10),
+          (unsigned long)(dutyMax / 10), (unsigned long)(dutyMax % 10),
+          (unsigned long)stat.busyCycles, (unsigned long)stat.busyCyclesMax, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu.%lu%%%s", "Idle last",
+          (unsigned long)(idle / 10), (unsigned long)(idle % 10), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu / %lu%s", "Wakeups/s last/max",
+          (unsigned long)stat.wakeups, (unsigned long)stat.wakeupsMax, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu / %lu%s", "Timer ISRs/s last/max",
+          (unsigned long)stat.timerIsrs, (unsigned long)stat.timerIsrsMax, CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu, %s: %lu%s", "Dispatches/s", (unsigned long)stat.dispatches,
+          "Seconds", (unsigned long)stat.seconds, CFG_PRINTF_NEWLINE);
+}
+
+/**************************************************************************/
+/*!
+    'loop_stat' command handler, 'loop_stat reset' clears the histogram
+*/
+/**************************************************************************/
+void cmd_loop_stat(cli_select_t t, uint8_t argc, char **argv)
+{
+    if(argc > 0)
+    {
+        if(strncmp(argv[0], "reset", 5) == 0)
+        {
+            loopReset();
+            print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
+        }
+        else
+        {
+            print(cli_send[t], "%s%s", "ERROR", CFG_PRINTF_NEWLINE);
+        }
+        return;
+    }
+
+    loopStat_t stat;
+    loopGetStat(&stat);
+
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+
+    print(cli_send[t], "%s: %lu%s", "Passes", (unsigned long)stat.passes, CFG_PRINTF_NEWLINE);
+    for(uint8_t i = 0; i < LOOP_BUCKETS; i++)
+    {
+        if(stat.buckets[i] == 0)
+        {
+            continue;
+        }
+
+        if(i < LOOP_BUCKETS - 1)
+        {
+            print(cli_send[t], "  < %8lu us: %lu%s", (unsigned long)((1UL << i) / cyclesPerUs),
+                  (unsigned long)stat.buckets[i], CFG_PRINTF_NEWLINE);
+        }
+        else
+        {
+            print(cli_send[t], "  >= %7lu us: %lu%s", (unsigned long)((1UL << (i - 1)) / cyclesPerUs),
+                  (unsigned long)stat.buckets[i], CFG_PRINTF_NEWLINE);
+        }
+    }
+    print(cli_send[t], "%s: %lu us (%s)%s", "Worst section",
+          (unsigned long)(stat.worstCycles / cyclesPerUs), loopGetModuleName(stat.worstModule), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s > %u ms: %lu, %s: %s%s", "Stalls", (unsigned int)CFG_LOOP_STALL_MS,
+          (unsigned long)stat.stalls, "last", loopGetModuleName(stat.lastStallModule), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %u, %s: %s%s%s", "Watchdog resets", (unsigned int)stat.watchdogResets,
+          "last in", loopGetModuleName(stat.watchdogModule),
+          stat.watchdogReset ? " (this boot)" : "", CFG_PRINTF_NEWLINE);
+}
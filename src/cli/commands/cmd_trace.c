@@ -0,0 +1,81 @@
+/**************************************************************************/
+/*!
+    @file     cmd_trace.c
+    @author   Janis (jan1s@github)
+
+    @ingroup  CLI
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2016, Janis
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "platform_config.h"
+
+#ifdef CFG_TRACE
+
+#include "cli/cli.h"
+#include "print.h"
+#include "trace.h"
+
+/**************************************************************************/
+/*!
+    'trace' command handler, 'trace dump' sends the ring in binary for
+    tools/trace_decode.py, 'trace clear' empties it
+*/
+/**************************************************************************/
+void cmd_trace(cli_select_t t, uint8_t argc, char **argv)
+{
+    if(argc > 0)
+    {
+        if(strncmp(argv[0], "dump", 4) == 0)
+        {
+            traceDump(cli_send[t]);
+        }
+        else if(strncmp(argv[0], "clear", 5) == 0)
+        {
+            traceClear();
+            print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
+        }
+        else
+        {
+            print(cli_send[t], "%s%s", "ERROR", CFG_PRINTF_NEWLINE);
+        }
+        return;
+    }
+
+    print(cli_send[t], "%s: %lu%s", "Records written", (unsigned long)traceGetWritten(), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %lu%s", "Records dropped", (unsigned long)traceGetDropped(), CFG_PRINTF_NEWLINE);
+    print(cli_send[t], "%s: %u%s", "Ring size", (unsigned int)CFG_TRACE_RECORDS, CFG_PRINTF_NEWLINE);
+}
+
+#endif // CFG_TRACE
@@ -39,6 +39,7 @@
 
 #include "platform_config.h"
 
+#include "rtc/rtc.h"
 #include "rtc/tz.h"
 #include "cli/cli.h"
 #include "print.h"
@@ -48,22 +49,25 @@
 #include <string.h>
 
 
-void cmd_tz_write(cli_select_t t, uint8_t argc, char **argv)
+/**************************************************************************/
+/*!
+    Parses and validates '(std|dst) <offset> <hour> <dow> <week> <month>'
+*/
+/**************************************************************************/
+static bool cmd_tz_parse_rule(cli_select_t t, char **argv, bool *isDst, tzRule_t *r)
 {
-    bool isStd = false;
-    bool isDst = false;
     if(strncmp(argv[0], "std", 3) == 0)
     {
-        isStd = true;
+        *isDst = false;
     }
     else if(strncmp(argv[0], "dst", 3) == 0)
     {
-        isDst = true;
+        *isDst = true;
     }
     else
     {
         print(cli_send[t], "%s%s", "Must be either STD or DST", CFG_PRINTF_NEWLINE);
-        return;
+        return false;
     }
 
     char* end;
@@ -77,44 +81,78 @@ void cmd_tz_write(cli_select_t t, uint8_t argc, char **argv)
     if ((offset < -1440) || (offset > 1440))
     {
         print(cli_send[t], "%s%s", "Offset must be between -1440 and 1440 minutes", CFG_PRINTF_NEWLINE);
-        return;
+        return false;
     }
     if ((hour < 0) || (hour > 23))
     {
         print(cli_send[t], "%s%s", "Hour must be between 0 and 23", CFG_PRINTF_NEWLINE);
-        return;
+        return false;
     }
     if ((dow < 0) || (dow > 6))
     {
         print(cli_send[t], "%s%s", "Day of week must be between 0 and 6", CFG_PRINTF_NEWLINE);
-        return;
+        return false;
     }
     if ((week < 0) || (week > 4))
     {
         print(cli_send[t], "%s%s", "Week must be between 0 and 4", CFG_PRINTF_NEWLINE);
-        return;
+        return false;
     }
     if ((month < 0) || (month > 12))
     {
         print(cli_send[t], "%s%s", "Month must be between 0 and 12", CFG_PRINTF_NEWLINE);
-        return;
+        return false;
     }
 
     /* Try to create a rule */
-    tzRule_t r;
-    tzCreateRule(offset, hour, dow, week, month, &r);
+    tzCreateRule(offset, hour, dow, week, month, r);
+    return true;
+}
 
-    /* Set and store the rule */
-    if(isStd)
+/**************************************************************************/
+/*!
+    Parses a zone index
+*/
+/**************************************************************************/
+static bool cmd_tz_parse_zone(cli_select_t t, char *arg, uint8_t *zone)
+{
+    char* end;
+    int32_t z = strtol(arg, &end, 10);
+
+    if ((end == arg) || (*end != '\0') || (z < 0) || (z >= CFG_TZ_ZONES))
     {
-        tzStoreSTD(&r);
-        tzSetSTD(&r);
+        print(cli_send[t], "%s %d%s", "Zone must be between 0 and", CFG_TZ_ZONES - 1, CFG_PRINTF_NEWLINE);
+        return false;
     }
-    else if(isDst)
+    *zone = z;
+    return true;
+}
+
+static void cmd_tz_print_rule(cli_select_t t, const char *name, tzRule_t *r)
+{
+    print(cli_send[t], "%s: %04d %02d %01d %02d %02d%s", name, r->offset, r->hour, r->dow, r->week, r->month, CFG_PRINTF_NEWLINE);
+}
+
+void cmd_tz_write(cli_select_t t, uint8_t argc, char **argv)
+{
+    bool isDst;
+    tzRule_t r;
+    if(!cmd_tz_parse_rule(t, argv, &isDst, &r))
+    {
+        return;
+    }
+
+    /* Set and store the rule */
+    if(isDst)
     {
         tzStoreDST(&r);
         tzSetDST(&r);
     }
+    else
+    {
+        tzStoreSTD(&r);
+        tzSetSTD(&r);
+    }
     print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
 }
 
@@ -149,11 +187,78 @@ void cmd_tz_read(cli_select_t t, uint8_t argc, char **argv)
     if(isStd)
     {
         tzGetSTD(&r);
-        print(cli_send[t], "%s: %04d %02d %01d %02d %02d%s", "STD", r.offset, r.hour, r.dow, r.week, r.month, CFG_PRINTF_NEWLINE);
+        cmd_tz_print_rule(t, "STD", &r);
     }
     if(isDst)
     {
         tzGetDST(&r);
-        print(cli_send[t], "%s: %04d %02d %01d %02d %02d%s", "DST", r.offset, r.hour, r.dow, r.week, r.month, CFG_PRINTF_NEWLINE);
+        cmd_tz_print_rule(t, "DST", &r);
+    }
+}
+
+void cmd_tz_zone_write(cli_select_t t, uint8_t argc, char **argv)
+{
+    uint8_t zone;
+    if(!cmd_tz_parse_zone(t, argv[0], &zone))
+    {
+        return;
+    }
+
+    bool isDst;
+    tzRule_t r;
+    if(!cmd_tz_parse_rule(t, &argv[1], &isDst, &r))
+    {
+        return;
+    }
+
+    /* Set and store the rule */
+    if(isDst)
+    {
+        tzZoneStoreDST(zone, &r);
+        tzZoneSetDST(zone, &r);
+    }
+    else
+    {
+        tzZoneStoreSTD(zone, &r);
+        tzZoneSetSTD(zone, &r);
+    }
+    print(cli_send[t], "%s%s", "OK", CFG_PRINTF_NEWLINE);
+}
+
+void cmd_tz_zone_read(cli_select_t t, uint8_t argc, char **argv)
+{
+    uint8_t first = 0;
+    uint8_t last = CFG_TZ_ZONES - 1;
+
+    if(argc == 1)
+    {
+        if(!cmd_tz_parse_zone(t, argv[0], &first))
+        {
+            return;
+        }
+        last = first;
+    }
+
+    for(uint8_t zone = first; zone <= last; zone++)
+    {
+        tzRule_t r;
+        print(cli_send[t], "%s %d%s", "Zone", zone, CFG_PRINTF_NEWLINE);
+        tzZoneGetSTD(zone, &r);
+        cmd_tz_print_rule(t, "STD", &r);
+        tzZoneGetDST(zone, &r);
+        cmd_tz_print_rule(t, "DST", &r);
+    }
+}
+
+void cmd_tz_zone_time(cli_select_t t, uint8_t argc, char **argv)
+{
+    uint32_t local[CFG_TZ_ZONES];
+    tzZonesEpochUTCToLocal(rtcGet(), local, CFG_TZ_ZONES);
+
+    for(uint8_t zone = 0; zone < CFG_TZ_ZONES; zone++)
+    {
+        rtcTime_t rt;
+        rtcCreateTimeFromEpoch(local[zone], &rt);
+        print(cli_send[t], "%s %d: %04d %02d %02d %02d %02d %02d%s", "Zone", zone, rt.years + 1900, rt.months, rt.days, rt.hours, rt.minutes, rt.seconds, CFG_PRINTF_NEWLINE);
     }
 }
@@ -22,7 +22,10 @@
 #include "rtc/dcf.h"
 #include "rtc/gps.h"
 
-static uint32_t lastEpoch = 0;
+#include "trace.h"
+
+static uint32_t lastLocalEpoch = 0;
+static rtcTime_t clockLocal;
 
 clockSource_t clockSource;
 nightModeRule_t nightMode;
@@ -33,6 +36,7 @@ void clockStoreSource( const clockSource_t s )
     FLASH_Unlock();
 
     /* Write to the FLASH Domain */
+    TRACE(TRACE_CONFIG_WRITE, 1, CFG_EEPROM_CLOCK_SRC);
     EE_WriteVariable(CFG_EEPROM_CLOCK_SRC, (uint16_t)s);
 
     /* Deny access to FLASH Domain */
@@ -48,6 +52,17 @@ clockSource_t clockLoadSource()
 
 void clockSetSource( const clockSource_t s )
 {
+    if ((clockSource == CLOCK_SOURCE_DCF77) && (s != CLOCK_SOURCE_DCF77))
+    {
+        dcfDeinit();
+    }
+#ifdef CFG_GPS
+    if ((clockSource == CLOCK_SOURCE_GPS) && (s != CLOCK_SOURCE_GPS))
+    {
+        gpsDeinit();
+    }
+#endif
+
     clockSource = s;
 
     switch(clockSource)
@@ -66,7 +81,9 @@ void clockSetSource( const clockSource_t s )
 
         case CLOCK_SOURCE_GPS:
         {
-            //gpsInit();
+#ifdef CFG_GPS
+            gpsInit();
+#endif
         }
         break;
 
@@ -95,6 +112,7 @@ void clockStoreNightmode( const nightModeRule_t m )
     FLASH_Unlock();
 
     /* Write to the FLASH Domain */
+    TRACE(TRACE_CONFIG_WRITE, 3, CFG_EEPROM_CLOCK_NM);
     EE_WriteVariable(CFG_EEPROM_CLOCK_NM + 0, (uint16_t)m.dayMask);
     EE_WriteVariable(CFG_EEPROM_CLOCK_NM + 1, (uint16_t)((m.startHour << 8) + m.startMinute));
     EE_WriteVariable(CFG_EEPROM_CLOCK_NM + 2, (uint16_t)((m.endHour << 8) + m.endMinute));
@@ -166,8 +184,9 @@ void clockInit()
 {
     rtcInit();
     tzInit();
-    lastEpoch = rtcGet();
-    clockSource = clockLoadSource();
+    lastLocalEpoch = tzEpochUTCToLocal( rtcGet() );
+    rtcCreateTimeFromEpoch( lastLocalEpoch, &clockLocal );
+    clockSetSource( clockLoadSource() );
     nightMode = clockLoadNightmode();
 
 #ifdef CFG_FLIP_BUS
@@ -188,7 +207,7 @@ void clockInit()
 
 void clockPoll()
 {
-    uint32_t epoch = rtcGet();
+    uint32_t eventCycles;
 
     switch(clockSource)
     {
@@ -206,7 +225,9 @@ void clockPoll()
 
         case CLOCK_SOURCE_GPS:
         {
-            //gpsPoll();
+#ifdef CFG_GPS
+            gpsPoll();
+#endif
         }
         break;
 
@@ -223,27 +244,35 @@ void clockPoll()
         break;
     }
 
-    if(epoch != lastEpoch)
+    /* Edge triggered by the second interrupt */
+    if(rtcTakeEvent( &eventCycles ))
     {
-        lastEpoch = epoch;
-
-        rtcTime_t utc;
-        rtcTime_t local;
+        uint32_t localEpoch = tzEpochUTCToLocal( rtcGet() );
 
-        rtcCreateTimeFromEpoch( epoch, &utc );
-        tzUTCToLocal( &utc, &local );
+        if(localEpoch == lastLocalEpoch + 1)
+        {
+            /* Regular tick: only carry the fields that roll over */
+            rtcTickSecond( &clockLocal );
+        }
+        else
+        {
+            /* The epoch jumped (rtcSet, DCF/GPS correction) or the offset
+               changed (DST transition, new rules): resync */
+            rtcCreateTimeFromEpoch( localEpoch, &clockLocal );
+        }
+        lastLocalEpoch = localEpoch;
 
 #ifdef CFG_FLIP_BUS
-        flipdotClockShowTime(local);
+        flipdotClockShowTime(clockLocal);
 #endif
 
 #ifdef CFG_FLIP_BROSE
-        flipdotClockShowTime(local);
+        flipdotClockShowTime(clockLocal);
 #endif
 
 #ifdef CFG_NIXIE
-        nixieclockShowTime(local);
-        if (clockIsNightmode(local))
+        nixieclockShowTime(clockLocal);
+        if (clockIsNightmode(clockLocal))
         {
         	nixieclockTurnOff();
         }
@@ -252,5 +281,7 @@ void clockPoll()
         	nixieclockTurnOn();
         }
 #endif
+
+        rtcEventHandled( eventCycles );
     }
 }
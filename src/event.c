@@ -0,0 +1,163 @@
+#include "platform_config.h"
+
+#include "event.h"
+#include "timer.h"
+
+
+/* Pending events, set by the interrupts and taken by the main loop */
+static volatile uint32_t eventPending = EVENT_NONE;
+
+/* Accounting of the current RTC second, only touched by the main loop */
+static uint32_t eventWakeCycles;
+static uint32_t eventBusyCycles;
+static uint32_t eventWakeups;
+static uint32_t eventDispatches;
+static uint32_t eventTimerIsrs;
+
+static eventStat_t eventStat;
+
+
+/**************************************************************************/
+/*!
+    @brief Clears pending events and starts the accounting
+*/
+/**************************************************************************/
+void eventInit()
+{
+    eventPending = EVENT_NONE;
+
+    eventWakeCycles = timer_cycles();
+    eventBusyCycles = 0;
+    eventWakeups = 0;
+    eventDispatches = 0;
+    eventTimerIsrs = timer_isr_count();
+
+    eventStat = (eventStat_t){ 0 };
+}
+
+/**************************************************************************/
+/*!
+    @brief Posts events, safe to call from any interrupt priority
+
+    @param[in]  events
+                Bitmask of event_t
+*/
+/**************************************************************************/
+void eventPost(uint32_t events)
+{
+    uint32_t pending;
+
+    /* An exception between load and store clears the exclusive monitor,
+       so a preempting post is never lost */
+    do
+    {
+        pending = __LDREXW(&eventPending);
+    }
+    while (__STREXW(pending | events, &eventPending));
+}
+
+/**************************************************************************/
+/*!
+    @brief Takes all pending events
+
+    @return Bitmask of event_t, EVENT_NONE if nothing is pending
+*/
+/**************************************************************************/
+uint32_t eventTake()
+{
+    uint32_t pending;
+
+    do
+    {
+        pending = __LDREXW(&eventPending);
+    }
+    while (__STREXW(EVENT_NONE, &eventPending));
+
+    if (pending != EVENT_NONE)
+    {
+        eventDispatches++;
+    }
+
+    return pending;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sleeps until an interrupt, unless an event is already pending
+
+    The check and WFI run with interrupts masked. A pending interrupt still
+    ends WFI, its handler runs once they are unmasked again. Without the
+    mask an event posted between the check and WFI would only be handled
+    at the next wakeup.
+*/
+/**************************************************************************/
+void eventWait()
+{
+    __disable_irq();
+
+    if (eventPending == EVENT_NONE)
+    {
+        /* The cycle counter is not reliable while the core sleeps, so
+           only the time awake is measured */
+        eventBusyCycles += timer_cycles() - eventWakeCycles;
+
+        __WFI();
+
+        eventWakeCycles = timer_cycles();
+        eventWakeups++;
+    }
+
+    __enable_irq();
+}
+
+/**************************************************************************/
+/*!
+    @brief Closes the accounting of one RTC second, called by the main
+           loop for EVENT_RTC_SECOND
+*/
+/**************************************************************************/
+void eventSecond()
+{
+    uint32_t now = timer_cycles();
+    uint32_t timerIsrs = timer_isr_count();
+
+    eventBusyCycles += now - eventWakeCycles;
+    eventWakeCycles = now;
+
+    eventStat.busyCycles = eventBusyCycles;
+    eventStat.wakeups = eventWakeups;
+    eventStat.dispatches = eventDispatches;
+    eventStat.timerIsrs = timerIsrs - eventTimerIsrs;
+    eventStat.seconds++;
+
+    if (eventBusyCycles > eventStat.busyCyclesMax)
+    {
+        eventStat.busyCyclesMax = eventBusyCycles;
+    }
+    if (eventWakeups > eventStat.wakeupsMax)
+    {
+        eventStat.wakeupsMax = eventWakeups;
+    }
+    if (eventStat.timerIsrs > eventStat.timerIsrsMax)
+    {
+        eventStat.timerIsrsMax = eventStat.timerIsrs;
+    }
+
+    eventBusyCycles = 0;
+    eventWakeups = 0;
+    eventDispatches = 0;
+    eventTimerIsrs = timerIsrs;
+}
+
+/**************************************************************************/
+/*!
+    @brief Returns the statistics of the last RTC second
+
+    @param[out] stat
+                Copy of the statistics
+*/
+/**************************************************************************/
+void eventGetStat(eventStat_t *stat)
+{
+    *stat = eventStat;
+}
@@ -4,6 +4,8 @@
 
 #include "flip_brose/flip_brose.h"
 #include "timer.h"
+#include "perf.h"
+#include "trace.h"
 #include <string.h>
 
 #define CFG_FLIPPER_SREN_PIN                 (1)
@@ -109,6 +111,8 @@ void flipdot_wipe_21x13(uint8_t dir)
 
 void flipdot_set_21x13(const fdisp_21x13_t *d)
 {
+    PERF_BEGIN(PERF_FLIPDOT_SET);
+    uint16_t flips = 0;
     for(uint8_t col = 0; col < 21; ++col)
     {
         for(uint8_t row = 0; row < 13; ++row)
@@ -118,10 +122,13 @@ void flipdot_set_21x13(const fdisp_21x13_t *d)
             if(dir != dir_state)
             {
                 flipdot_flip(row+6, col+7, dir);
+                flips++;
             }
         }
     }
     flipdotState21x13 = *d;
+    TRACE(TRACE_FLIPDOT_SET, 21, flips);
+    PERF_END(PERF_FLIPDOT_SET);
 }
 
 
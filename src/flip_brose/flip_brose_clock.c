@@ -10,25 +10,27 @@
 #include <time.h>
 
 #include "timer.h"
+#include "trace.h"
 
 flipdotclockMode_t flipdotclockMode;
 
 const char *wdays[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
 const char *month[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
 
+/* Splash screen, one step per timer expiry */
+static timer_soft_t flipdotclockSplashTimer;
+static uint8_t flipdotclockSplashStep;
+
+static void flipdotclockSplashNext(timer_soft_t *timer);
+
 // ----------------------------------------------------------------------------
 
 void flipdotClockInit()
 {
     flipdotclockMode = flipdotclockLoadMode();
 
-    for(int i = 0; i < 3; ++i)
-    {
-    	flipdot_wipe_21x13(0);
-		timer_sleep(80000);
-		flipdot_wipe_21x13(1);
-		timer_sleep(80000);
-    }
+    flipdotclockSplashStep = 0;
+    flipdotclockSplashNext(&flipdotclockSplashTimer);
 
     //fdisp_21x13_t d;
 	//const uint8_t shallo[] = "Flip!";
@@ -37,12 +39,27 @@ void flipdotClockInit()
 	//timer_sleep(200000);
 }
 
+static void flipdotclockSplashNext(timer_soft_t *timer)
+{
+    uint8_t step = flipdotclockSplashStep++;
+
+    /* Three times black and white */
+    if(step < 6)
+    {
+        flipdot_wipe_21x13(step % 2);
+        timer_start(timer, 80000, 0, flipdotclockSplashNext);
+    }
+
+    /* Done, the time is shown from the next second */
+}
+
 void flipdotclockStoreMode( const flipdotclockMode_t m )
 {
 	/* Allow access to FLASH Domain */
     FLASH_Unlock();
 
     /* Write to the FLASH Domain */
+	TRACE(TRACE_CONFIG_WRITE, 1, CFG_EEPROM_NIXIE_MODE);
 	EE_WriteVariable(CFG_EEPROM_NIXIE_MODE, (uint16_t)m);
 
 	/* Deny access to FLASH Domain */
@@ -68,6 +85,11 @@ flipdotclockMode_t flipdotclockGetMode( void )
 
 void flipdotClockShowTime(rtcTime_t t)
 {
+    if(timer_active(&flipdotclockSplashTimer))
+    {
+        return;
+    }
+
     switch(flipdotclockMode)
     {
     case FLIPDOTCLOCK_MODE_HHMM:
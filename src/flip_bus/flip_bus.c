@@ -4,6 +4,8 @@
 
 #include "flip_bus/flip_bus.h"
 #include "timer.h"
+#include "perf.h"
+#include "trace.h"
 #include <string.h>
 
 #define CFG_FLIPPER_SREN_PIN                 (1)
@@ -84,6 +86,8 @@ void flipdot_wipe_84x7(uint8_t dir)
 
 void flipdot_set_84x7(const fdisp_84x7_t *d)
 {
+    PERF_BEGIN(PERF_FLIPDOT_SET);
+    uint16_t flips = 0;
     for(uint8_t col = 0; col < 84; ++col)
     {
         for(uint8_t row = 0; row < 7; ++row)
@@ -93,10 +97,13 @@ void flipdot_set_84x7(const fdisp_84x7_t *d)
             if(dir != dir_state)
             {
                 flipdot_flip(row, col, dir);
+                flips++;
             }
         }
     }
     flipdotState84x7 = *d;
+    TRACE(TRACE_FLIPDOT_SET, 84, flips);
+    PERF_END(PERF_FLIPDOT_SET);
 }
 
 #ifdef CFG_TYPE_FLIPDOT_112X16
@@ -10,41 +10,60 @@
 #include <time.h>
 
 #include "timer.h"
+#include "trace.h"
 
 flipdotclockMode_t flipdotclockMode;
 
 const char *wdays[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
 const char *month[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
 
+/* Splash screen, one step per timer expiry */
+static timer_soft_t flipdotclockSplashTimer;
+static uint8_t flipdotclockSplashStep;
+
+static void flipdotclockSplashNext(timer_soft_t *timer);
+
 // ----------------------------------------------------------------------------
 
 void flipdotClockInit()
 {
     flipdotclockMode = flipdotclockLoadMode();
 
-    fdisp_84x7_t d;
-    const uint8_t shallo[] = " Flipdot 84x7";
-    flipdot_setstring_84x7(&d, shallo, sizeof(shallo));
-    flipdot_set_84x7(&d);
-    timer_sleep(200000);
+    flipdotclockSplashStep = 0;
+    flipdotclockSplashNext(&flipdotclockSplashTimer);
+}
 
-    for(int i = 0; i < 4; ++i)
+static void flipdotclockSplashNext(timer_soft_t *timer)
+{
+    uint8_t step = flipdotclockSplashStep++;
+
+    if(step == 0)
+    {
+        fdisp_84x7_t d;
+        const uint8_t shallo[] = " Flipdot 84x7";
+        flipdot_setstring_84x7(&d, shallo, sizeof(shallo));
+        flipdot_set_84x7(&d);
+        timer_start(timer, 200000, 0, flipdotclockSplashNext);
+    }
+    else if(step <= 8)
     {
-    	flipdot_wipe_84x7(0);
-		timer_sleep(100000);
-		flipdot_wipe_84x7(1);
-		timer_sleep(100000);
+        /* Four times black and white */
+        flipdot_wipe_84x7((step + 1) % 2);
+        timer_start(timer, 100000, 0, flipdotclockSplashNext);
     }
-
+    else if(step == 9)
+    {
 #ifdef CFG_TYPE_FLIPDOT_112X16
-    flipdot_wipe_112x16(0);
-    fdisp_112x16_t d = {0};
-    const uint8_t shallo[] = "Flipdot 112x16";
-    flipdot_setstring_112x16(&d, shallo, sizeof(shallo));
-    flipdot_set_112x16(&d);
+        flipdot_wipe_112x16(0);
+        fdisp_112x16_t d = {0};
+        const uint8_t shallo[] = "Flipdot 112x16";
+        flipdot_setstring_112x16(&d, shallo, sizeof(shallo));
+        flipdot_set_112x16(&d);
 #endif
+        timer_start(timer, 400000, 0, flipdotclockSplashNext);
+    }
 
-    timer_sleep(400000);
+    /* Done, the time is shown from the next second */
 }
 
 void flipdotclockStoreMode( const flipdotclockMode_t m )
@@ -53,6 +72,7 @@ void flipdotclockStoreMode( const flipdotclockMode_t m )
     FLASH_Unlock();
 
     /* Write to the FLASH Domain */
+	TRACE(TRACE_CONFIG_WRITE, 1, CFG_EEPROM_NIXIE_MODE);
 	EE_WriteVariable(CFG_EEPROM_NIXIE_MODE, (uint16_t)m);
 
 	/* Deny access to FLASH Domain */
@@ -78,6 +98,10 @@ flipdotclockMode_t flipdotclockGetMode( void )
 
 void flipdotClockShowTime(rtcTime_t t)
 {
+    if(timer_active(&flipdotclockSplashTimer))
+    {
+        return;
+    }
 
     char buffer[14] = {0};
 
@@ -0,0 +1,178 @@
+#include "platform_config.h"
+
+#include "loop.h"
+#include "timer.h"
+
+
+static const char * const loopModuleNames[LOOP_MODULE_COUNT] =
+{
+    "idle",
+    "cli",
+    "clock",
+    "timer",
+    "protocol",
+};
+
+static loopModule_t loopModule = LOOP_MODULE_IDLE;
+static uint32_t loopPassStart;
+static uint32_t loopSectionStart;
+static uint32_t loopStallCycles;
+
+static loopStat_t loopStat;
+
+static void loopTag(loopModule_t m);
+static void loopSectionEnd(uint32_t now);
+
+
+/**************************************************************************/
+/*!
+    @brief Reads the cause of the last reset and starts the watchdog.
+           Call right before entering the main loop, after rtcInit.
+*/
+/**************************************************************************/
+void loopInit()
+{
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+
+    loopStat = (loopStat_t){ 0 };
+    loopStat.watchdogResets = BKP_ReadBackupRegister(CFG_LOOP_BKP_RESETS);
+    loopStat.watchdogModule = BKP_ReadBackupRegister(CFG_LOOP_BKP_MODULE);
+
+    if (RCC_GetFlagStatus(RCC_FLAG_IWDGRST) != RESET)
+    {
+        /* The tag still names the module that stalled */
+        loopStat.watchdogReset = true;
+        loopStat.watchdogResets++;
+        loopStat.watchdogModule = BKP_ReadBackupRegister(CFG_LOOP_BKP_TAG);
+
+        PWR_BackupAccessCmd(ENABLE);
+        BKP_WriteBackupRegister(CFG_LOOP_BKP_RESETS, loopStat.watchdogResets);
+        BKP_WriteBackupRegister(CFG_LOOP_BKP_MODULE, loopStat.watchdogModule);
+        PWR_BackupAccessCmd(DISABLE);
+    }
+    RCC_ClearFlag();
+
+    loopStallCycles = (SystemCoreClock / 1000) * CFG_LOOP_STALL_MS;
+    loopModule = LOOP_MODULE_IDLE;
+    loopTag(LOOP_MODULE_IDLE);
+
+    /* LSI 40 kHz / 256 */
+    IWDG_WriteAccessCmd(IWDG_WriteAccess_Enable);
+    IWDG_SetPrescaler(IWDG_Prescaler_256);
+    IWDG_SetReload((CFG_LOOP_WATCHDOG_MS * 40) / 256);
+    IWDG_ReloadCounter();
+    IWDG_Enable();
+
+    /* Do not reset while halted by the debugger */
+    DBGMCU_Config(DBGMCU_IWDG_STOP, ENABLE);
+}
+
+/**************************************************************************/
+/*!
+    @brief Ends the current section of the main loop and starts one of
+           module m. The tag survives a watchdog reset.
+*/
+/**************************************************************************/
+void loopEnter(loopModule_t m)
+{
+    uint32_t now = timer_cycles();
+
+    if (loopModule == LOOP_MODULE_IDLE)
+    {
+        loopPassStart = now;
+    }
+    else
+    {
+        loopSectionEnd(now);
+    }
+
+    loopModule = m;
+    loopSectionStart = now;
+    loopTag(m);
+}
+
+/**************************************************************************/
+/*!
+    @brief Ends the pass before the main loop sleeps and feeds the
+           watchdog. A stalled loop never gets here.
+*/
+/**************************************************************************/
+void loopIdle()
+{
+    IWDG_ReloadCounter();
+
+    if (loopModule == LOOP_MODULE_IDLE)
+    {
+        return;
+    }
+
+    uint32_t now = timer_cycles();
+    loopSectionEnd(now);
+
+    uint32_t cycles = now - loopPassStart;
+    uint32_t bucket = 32 - __CLZ(cycles);
+    if (bucket >= LOOP_BUCKETS)
+    {
+        bucket = LOOP_BUCKETS - 1;
+    }
+    loopStat.buckets[bucket]++;
+    loopStat.passes++;
+
+    loopModule = LOOP_MODULE_IDLE;
+    loopTag(LOOP_MODULE_IDLE);
+}
+
+/**************************************************************************/
+/*!
+    @brief Clears the histogram and the stalls, the watchdog information
+           is kept
+*/
+/**************************************************************************/
+void loopReset()
+{
+    loopStat.passes = 0;
+    for (uint8_t i = 0; i < LOOP_BUCKETS; i++)
+    {
+        loopStat.buckets[i] = 0;
+    }
+    loopStat.worstCycles = 0;
+    loopStat.worstModule = LOOP_MODULE_IDLE;
+    loopStat.stalls = 0;
+    loopStat.lastStallModule = LOOP_MODULE_IDLE;
+}
+
+void loopGetStat(loopStat_t *stat)
+{
+    *stat = loopStat;
+}
+
+const char *loopGetModuleName(uint8_t m)
+{
+    return (m < LOOP_MODULE_COUNT) ? loopModuleNames[m] : "?";
+}
+
+static void loopSectionEnd(uint32_t now)
+{
+    uint32_t cycles = now - loopSectionStart;
+
+    if (cycles > loopStat.worstCycles)
+    {
+        loopStat.worstCycles = cycles;
+        loopStat.worstModule = loopModule;
+    }
+    if (cycles > loopStallCycles)
+    {
+        loopStat.stalls++;
+        loopStat.lastStallModule = loopModule;
+    }
+}
+
+static void loopTag(loopModule_t m)
+{
+    /* The RTC interrupt switches the backup access as well */
+    __disable_irq();
+    PWR_BackupAccessCmd(ENABLE);
+    BKP_WriteBackupRegister(CFG_LOOP_BKP_TAG, m);
+    PWR_BackupAccessCmd(DISABLE);
+    __enable_irq();
+}
@@ -4,6 +4,9 @@
 
 #include "led.h"
 #include "timer.h"
+#include "event.h"
+#include "perf.h"
+#include "loop.h"
 #include "cli/cli.h"
 #include "clock.h"
 #include "protocol/protocol.h"
@@ -17,16 +20,27 @@
 
 /* Virtual address of EEPROM emulated variables */
 /* Check platform_config.h for the actual definitions */
-uint8_t NumbOfVar = 0x06;
-uint16_t VirtAddVarTab[0x06] =
+/* Every variable must be listed, otherwise it is lost on a page transfer */
+#define EEPROM_TZ_RULE(a)   (a)+0, (a)+1, (a)+2
+uint16_t VirtAddVarTab[] =
 {
-    CFG_EEPROM_TZ_STD,
-    CFG_EEPROM_TZ_DST,
+    EEPROM_TZ_RULE(CFG_EEPROM_TZ_STD),
+    EEPROM_TZ_RULE(CFG_EEPROM_TZ_DST),
     CFG_EEPROM_CLOCK_SRC,
-	CFG_EEPROM_CLOCK_NM,
+    CFG_EEPROM_CLOCK_NM, CFG_EEPROM_CLOCK_NM + 1, CFG_EEPROM_CLOCK_NM + 2,
     CFG_EEPROM_NIXIE_TYPE,
-    CFG_EEPROM_NIXIE_MODE
+    CFG_EEPROM_NIXIE_MODE,
+#if CFG_TZ_ZONES > 1
+    EEPROM_TZ_RULE(CFG_EEPROM_TZ_ZONE(1)), EEPROM_TZ_RULE(CFG_EEPROM_TZ_ZONE(1) + 8),
+#endif
+#if CFG_TZ_ZONES > 2
+    EEPROM_TZ_RULE(CFG_EEPROM_TZ_ZONE(2)), EEPROM_TZ_RULE(CFG_EEPROM_TZ_ZONE(2) + 8),
+#endif
+#if CFG_TZ_ZONES > 3
+    EEPROM_TZ_RULE(CFG_EEPROM_TZ_ZONE(3)), EEPROM_TZ_RULE(CFG_EEPROM_TZ_ZONE(3) + 8),
+#endif
 };
+uint8_t NumbOfVar = sizeof(VirtAddVarTab) / sizeof(VirtAddVarTab[0]);
 
 /* Extern variables ----------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
@@ -50,22 +64,82 @@ int main(void)
     timer_sleep(50000);
     led_sys_off();
 
+    eventInit();
+
     cliInit(CLI_USBCDC);
     cliInit(CLI_USART1);
     //cliInit(CLI_USART2);
 
-    //protocolInit();
+#ifdef CFG_PROTOCOL_USBCDC
+    protocolInit();
+#endif
     clockInit();
 
+    loopInit();
+
     while(1)
     {
-    	led_sys_on();
-    	cliPoll(CLI_USBCDC);
-    	cliPoll(CLI_USART1);
-    	//cliPoll(CLI_USART2);
-        //protocolPoll();
-        led_sys_off();
-        
-        clockPoll();
+        uint32_t events = eventTake();
+
+#ifdef CFG_PROTOCOL_USBCDC
+        /* The USB port is polled by the protocol below */
+        if(events & EVENT_USART1)
+#else
+        if(events & (EVENT_USB | EVENT_USART1))
+#endif
+        {
+            loopEnter(LOOP_MODULE_CLI);
+            led_sys_on();
+            PERF_BEGIN(PERF_CLI_POLL);
+#ifndef CFG_PROTOCOL_USBCDC
+            if(events & EVENT_USB)
+            {
+                cliPoll(CLI_USBCDC);
+            }
+#endif
+            if(events & EVENT_USART1)
+            {
+                cliPoll(CLI_USART1);
+            }
+            //cliPoll(CLI_USART2);
+            PERF_END(PERF_CLI_POLL);
+            led_sys_off();
+        }
+
+#ifdef CFG_PROTOCOL_USBCDC
+        /* The protocol takes its frames from the USB port and passes the
+           rest on to the CLI */
+        if(events & EVENT_USB)
+        {
+            loopEnter(LOOP_MODULE_PROTOCOL);
+            protocolPoll();
+        }
+#endif
+
+        /* USART2 and the capture are the GPS receiver and its PPS */
+        if(events & (EVENT_RTC_SECOND | EVENT_DCF_EDGE | EVENT_USART2 | EVENT_CAPTURE))
+        {
+            loopEnter(LOOP_MODULE_CLOCK);
+            PERF_BEGIN(PERF_CLOCK_POLL);
+            clockPoll();
+            PERF_END(PERF_CLOCK_POLL);
+        }
+
+        if(events & EVENT_RTC_SECOND)
+        {
+            eventSecond();
+        }
+
+        if(events & EVENT_TIMER)
+        {
+            loopEnter(LOOP_MODULE_TIMER);
+            PERF_BEGIN(PERF_TIMER_POLL);
+            timer_poll();
+            PERF_END(PERF_TIMER_POLL);
+        }
+
+        /* Sleep until the next interrupt */
+        loopIdle();
+        eventWait();
     }
 }
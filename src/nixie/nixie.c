@@ -5,6 +5,8 @@
 #include <string.h>
 #include "nixie/nixie.h"
 #include "nixie/nixie_mapping.h"
+#include "perf.h"
+#include "trace.h"
 
 
 #define CFG_NIXIE_RCK_PIN       (6)
@@ -73,6 +75,7 @@ void nixieStoreMapping( const nixieMapping_t m )
     FLASH_Unlock();
 
     /* Write to the FLASH Domain */
+    TRACE(TRACE_CONFIG_WRITE, 1, CFG_EEPROM_NIXIE_TYPE);
     EE_WriteVariable(CFG_EEPROM_NIXIE_TYPE, (uint16_t)m);
 
     /* Deny access to FLASH Domain */
@@ -98,6 +101,8 @@ nixieMapping_t nixieGetMapping( void )
 
 void nixieDisplay4t( nixieDisplay4t_t *d )
 {
+    PERF_BEGIN(PERF_NIXIE_DISPLAY);
+
     // output buffer -> gets written into shift registers in the end
     uint8_t outBuf[] = {0, 0, 0, 0, 0, 0};
     uint8_t outBufCount = 0;
@@ -148,10 +153,15 @@ void nixieDisplay4t( nixieDisplay4t_t *d )
     }
 
     nixieRegisterWrite(outBuf, sizeof(outBuf));
+
+    TRACE(TRACE_NIXIE_DISPLAY, 4, (d->digits[0] << 12) | (d->digits[1] << 8) | (d->digits[2] << 4) | d->digits[3]);
+    PERF_END(PERF_NIXIE_DISPLAY);
 }
 
 void nixieDisplay6t( nixieDisplay6t_t *d )
 {
+    PERF_BEGIN(PERF_NIXIE_DISPLAY);
+
     // output buffer -> gets written into shift registers in the end
     uint8_t outBuf[] = {0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t outBufCount = 0;
@@ -217,6 +227,9 @@ void nixieDisplay6t( nixieDisplay6t_t *d )
 	}
 
     nixieRegisterWrite(outBuf, sizeof(outBuf));
+
+    TRACE(TRACE_NIXIE_DISPLAY, 6, (d->digits[0] << 12) | (d->digits[1] << 8) | (d->digits[2] << 4) | d->digits[3]);
+    PERF_END(PERF_NIXIE_DISPLAY);
 }
 
 void nixieRegisterWrite(uint8_t *buf, size_t length)
@@ -7,12 +7,21 @@
 #include "rtc/rtc.h"
 #include "rtc/rtc_functions.h"
 #include "timer.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <string.h>
 
 nixieclockMode_t nixieclockMode;
 
+/* Digit cycle for tests and against cathode poisoning, runs on a timer */
+static timer_soft_t nixieclockCycleTimer;
+static uint8_t nixieclockCycleStep;
+static uint8_t nixieclockCycleSteps;
+
+static void nixieclockCycleShow(uint8_t digit);
+static void nixieclockCycleNext(timer_soft_t *timer);
+
 
 void nixieclockInit()
 {
@@ -38,6 +47,7 @@ void nixieclockStoreMode( const nixieclockMode_t m )
     FLASH_Unlock();
 
     /* Write to the FLASH Domain */
+	TRACE(TRACE_CONFIG_WRITE, 1, CFG_EEPROM_NIXIE_MODE);
 	EE_WriteVariable(CFG_EEPROM_NIXIE_MODE, (uint16_t)m);
 
 	/* Deny access to FLASH Domain */
@@ -63,6 +73,12 @@ nixieclockMode_t nixieclockGetMode( void )
 
 void nixieclockShowTime(rtcTime_t t)
 {
+    /* The time is shown again from the first second after the cycle */
+    if(nixieclockIsCycling())
+    {
+        return;
+    }
+
     switch(nixieclockMode)
     {
     case NIXIECLOCK_MODE_NONE:
@@ -158,7 +174,50 @@ void nixieclockShowTime(rtcTime_t t)
 }
 
 
+/**************************************************************************/
+/*!
+    @brief  Starts cycling all tubes through the digits 0-9 without
+            blocking, the clock display is paused meanwhile
+
+    @param[in]  step
+                Ticks each digit is shown
+    @param[in]  steps
+                Number of digits shown in total
+*/
+/**************************************************************************/
+void nixieclockCycleDigits(timer_ticks_t step, uint8_t steps)
+{
+    nixieclockCycleStep = 0;
+    nixieclockCycleSteps = steps;
+
+    nixieclockCycleShow(0);
+    timer_start(&nixieclockCycleTimer, step, step, nixieclockCycleNext);
+}
+
+bool nixieclockIsCycling(void)
+{
+    return timer_active(&nixieclockCycleTimer);
+}
+
 void nixieclockSaveTubes()
+{
+    /* Ten rounds of all digits */
+    nixieclockCycleDigits(10000, 100);
+}
+
+static void nixieclockCycleNext(timer_soft_t *timer)
+{
+    nixieclockCycleStep++;
+    if(nixieclockCycleStep >= nixieclockCycleSteps)
+    {
+        timer_stop(timer);
+        return;
+    }
+
+    nixieclockCycleShow(nixieclockCycleStep % 10);
+}
+
+static void nixieclockCycleShow(uint8_t digit)
 {
     switch(nixieclockMode)
     {
@@ -167,42 +226,34 @@ void nixieclockSaveTubes()
     case NIXIECLOCK_MODE_MMSS:
     case NIXIECLOCK_MODE_YYYY:
     {
-    	nixieDisplay4t_t display;
-    	for(uint8_t j = 0; j < 10; j++)
-    	{
-			for(uint8_t i = 0; i < 10; i++)
-			{
-			  display.digits[0] = i;
-			  display.digits[1] = i;
-			  display.digits[2] = i;
-			  display.digits[3] = i;
-			  nixieDisplay4t( &display );
-			  timer_sleep(10000);
-			}
-		}
+        nixieDisplay4t_t d;
+        d.digits[3] = digit;
+        d.digits[2] = digit;
+        d.digits[1] = digit;
+        d.digits[0] = digit;
+        d.dots[1] = (digit + 1) % 2;
+        d.dots[0] = digit % 2;
+        nixieDisplay4t(&d);
     }
     break;
 
     case NIXIECLOCK_MODE_HHMMSS:
     case NIXIECLOCK_MODE_HHMMSS_R:
-        {
-        	nixieDisplay6t_t display;
-        	for(uint8_t j = 0; j < 10; j++)
-        	{
-				for(uint8_t i = 0; i < 10; i++)
-				{
-				  display.digits[0] = i;
-				  display.digits[1] = i;
-				  display.digits[2] = i;
-				  display.digits[3] = i;
-				  display.digits[4] = i;
-				  display.digits[5] = i;
-				  nixieDisplay6t( &display );
-				  timer_sleep(10000);
-				}
-        	}
-        }
-        break;
+    {
+        nixieDisplay6t_t d;
+        d.digits[5] = digit;
+        d.digits[4] = digit;
+        d.digits[3] = digit;
+        d.digits[2] = digit;
+        d.digits[1] = digit;
+        d.digits[0] = digit;
+        d.dots[3] = (digit + 1) % 2;
+        d.dots[2] = digit % 2;
+        d.dots[1] = (digit + 1) % 2;
+        d.dots[0] = digit % 2;
+        nixieDisplay6t(&d);
+    }
+    break;
 
     default:
         break;
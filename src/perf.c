@@ -0,0 +1,89 @@
+#include "platform_config.h"
+
+#include "perf.h"
+
+#ifdef CFG_PERF
+
+#include <string.h>
+
+static perfStat_t perfStats[PERF_PROBE_COUNT];
+
+static const char * const perfNames[PERF_PROBE_COUNT] =
+{
+    "cliPoll",
+    "clockPoll",
+    "timer_poll",
+    "tzToLocal",
+    "flipdotSet",
+    "nixieDisplay",
+    "isrRTC",
+    "isrUSART1",
+    "isrUSART2",
+    "isrDMA1Ch6",
+    "isrUSB",
+    "isrTimer",
+    "isrDCF",
+};
+
+#ifdef CFG_PERF_HOST
+#define PERF_LOCK()
+#define PERF_UNLOCK()
+#else
+/* Probes in interrupts must not change a statistic while it is copied */
+#define PERF_LOCK()         uint32_t perfPrimask = __get_PRIMASK(); __disable_irq()
+#define PERF_UNLOCK()       __set_PRIMASK(perfPrimask)
+#endif
+
+
+/**************************************************************************/
+/*!
+    @brief Adds one measurement to a probe. Each probe is only recorded
+           from one context, so this needs no locking.
+*/
+/**************************************************************************/
+void perfRecord(perfProbe_t probe, uint32_t cycles)
+{
+    perfStat_t *s = &perfStats[probe];
+
+    if (s->count == 0 || cycles < s->min)
+    {
+        s->min = cycles;
+    }
+    if (cycles > s->max)
+    {
+        s->max = cycles;
+    }
+    s->total += cycles;
+    s->count++;
+}
+
+/**************************************************************************/
+/*!
+    @brief Clears all probes
+*/
+/**************************************************************************/
+void perfReset()
+{
+    PERF_LOCK();
+    memset(perfStats, 0, sizeof(perfStats));
+    PERF_UNLOCK();
+}
+
+/**************************************************************************/
+/*!
+    @brief Returns a consistent copy of a probe
+*/
+/**************************************************************************/
+void perfGetStat(perfProbe_t probe, perfStat_t *stat)
+{
+    PERF_LOCK();
+    *stat = perfStats[probe];
+    PERF_UNLOCK();
+}
+
+const char *perfGetName(perfProbe_t probe)
+{
+    return perfNames[probe];
+}
+
+#endif // CFG_PERF
@@ -6,25 +6,30 @@
 
 #ifdef CFG_PROTOCOL_USBCDC
 #include "usb_cdc.h"
+#include "cli/cli.h"
 #endif // CFG_PROTOCOL_USBCDC
 
 #include "protocol/protocol.h"
 #include "timer.h"
 #include "led.h"
+#include "trace.h"
 #include <string.h>
 
-typedef enum
+/* Activity and error flashes, switched off by timers */
+static timer_soft_t protocolLedSysTimer;
+static timer_soft_t protocolLedUsrTimer;
+
+static void protocolLedSysOff(timer_soft_t *timer)
 {
-    PROTOCOL_DECODER_STATE_SYNC_0 = 0,
-    PROTOCOL_DECODER_STATE_SYNC_1,
-    PROTOCOL_DECODER_STATE_CLASS_ID,
-    PROTOCOL_DECODER_STATE_MSG_ID,
-    PROTOCOL_DECODER_STATE_LENGTH_0,
-    PROTOCOL_DECODER_STATE_LENGTH_1,
-    PROTOCOL_DECODER_STATE_PAYLOAD,
-    PROTOCOL_DECODER_STATE_CHECKSUM_0,
-    PROTOCOL_DECODER_STATE_CHECKSUM_1
-} protocolDecoderState_t;
+    led_sys_off();
+}
+
+static void protocolLedUsrOff(timer_soft_t *timer)
+{
+    led_usr_off();
+}
+
+static void protocolPassChar(uint8_t c);
 
 
 #ifdef CFG_PROTOCOL_USART1
@@ -43,12 +48,18 @@ uint32_t protocolReadChar(uint8_t *c)
 {
     return 0;
 }
+
+static void protocolPassChar(uint8_t c)
+{
+
+}
 #endif // CFG_PROTOCOL_USART1
 
 #ifdef CFG_PROTOCOL_USBCDC
+/* The port is shared with the CLI, which sets it up */
 void protocolInit(void)
 {
-    USB_CDC_Init();
+
 }
 
 void protocolSendChar(uint8_t c)
@@ -58,8 +69,18 @@ void protocolSendChar(uint8_t c)
 
 uint32_t protocolReadChar(uint8_t *c)
 {
+    if (!USB_CDC_Configured())
+    {
+        return 0;
+    }
     return USB_CDC_Read(c);
 }
+
+/* A frame starts with 0xB5, which the CLI never takes */
+static void protocolPassChar(uint8_t c)
+{
+    cliRx(CLI_USBCDC, c);
+}
 #endif // CFG_PROTOCOL_USBCDC
 
 
@@ -67,115 +88,81 @@ void protocolPoll(void)
 {
     static protocolPacket_t packet;
 
-    if(protocolGetPacket(&packet))
+    /* Everything received, the main loop only comes back on new data */
+    while(protocolGetPacket(&packet))
     {
         if(protocolCheckPacket(&packet))
         {
             if(protocolEvaluatePacket(&packet))
             {
-                // finish
+                TRACE(TRACE_PROTOCOL_PACKET, 1, packet.msgId);
             }
             else
             {
+                TRACE(TRACE_PROTOCOL_PACKET, 2, packet.msgId);
                 // received not implemented packet
                 // spit out some error
                 led_usr_on();
-                timer_sleep(40000);
-                led_usr_off();
+                timer_start(&protocolLedUsrTimer, 40000, 0, protocolLedUsrOff);
             }
         }
         else
         {
+            TRACE(TRACE_PROTOCOL_PACKET, 0, packet.msgId);
             // spit out some error
             led_usr_on();
-            timer_sleep(10000);
-            led_usr_off();
+            timer_start(&protocolLedUsrTimer, 10000, 0, protocolLedUsrOff);
         }
     }
 }
 
 bool protocolGetPacket(protocolPacket_t *packet)
 {
-    static protocolDecoderState_t state;
-    static uint16_t length;
-    static timer_ticks_t t;
-    bool isWholePacket = false;
+    static ubxFramer_t framer;
+    static timer_uptime_t t;
 
-    if (timer_delayCount - t > 10000)
+    /* The framer stores the payload right into the packet */
+    if (framer.payload != packet->payload)
     {
-        length = 0;
-        state = PROTOCOL_DECODER_STATE_SYNC_0;
+        ubxFramerInit(&framer, packet->payload, PROTOCOL_PAYLOAD_SIZE, NULL, 0);
+    }
+
+    /* Drop a packet not completed within 100 ms */
+    if (!ubxFramerIdle(&framer) && timer_elapsed_ms(t) > 100)
+    {
+        ubxFramerReset(&framer);
     }
 
     uint8_t c;
     while(protocolReadChar(&c) > 0)
     {
         led_sys_on();
-        timer_sleep(200);
-        led_sys_off();
+        timer_start(&protocolLedSysTimer, 200, 0, protocolLedSysOff);
 
-        switch(state)
+        bool idle = ubxFramerIdle(&framer);
+        if (idle)
         {
-        case PROTOCOL_DECODER_STATE_SYNC_0:
-            state = (c == PROTOCOL_SYNC_0) ? PROTOCOL_DECODER_STATE_SYNC_1 : PROTOCOL_DECODER_STATE_SYNC_0;
-            t = timer_delayCount;
-            break;
-
-        case PROTOCOL_DECODER_STATE_SYNC_1:
-            state = (c == PROTOCOL_SYNC_1) ? PROTOCOL_DECODER_STATE_CLASS_ID : PROTOCOL_DECODER_STATE_SYNC_0;
-            break;
-
-        case PROTOCOL_DECODER_STATE_CLASS_ID:
-            packet->msgId = c;
-            state = PROTOCOL_DECODER_STATE_MSG_ID;
-            break;
-
-        case PROTOCOL_DECODER_STATE_MSG_ID:
-            packet->msgId += (c << 8);
-            state = PROTOCOL_DECODER_STATE_LENGTH_0;
-            break;
-
-        case PROTOCOL_DECODER_STATE_LENGTH_0:
-            length = c;
-            state = PROTOCOL_DECODER_STATE_LENGTH_1;
-            break;
-
-        case PROTOCOL_DECODER_STATE_LENGTH_1:
-            length += (c << 8);
-            packet->payloadLength = length;
-            if(length > 0)
-            {
-                state = PROTOCOL_DECODER_STATE_PAYLOAD;
-            }
-            else
-            {
-                state = PROTOCOL_DECODER_STATE_CHECKSUM_0;
-            }
-            break;
+            t = timer_uptime();
+        }
 
-        case PROTOCOL_DECODER_STATE_PAYLOAD:
-            packet->payload[packet->payloadLength - length--] = c;
-            if(length == 0)
-            {
-                state = PROTOCOL_DECODER_STATE_CHECKSUM_0;
-            }
-            break;
-
-        case PROTOCOL_DECODER_STATE_CHECKSUM_0:
-            packet->checksum = c;
-            state = PROTOCOL_DECODER_STATE_CHECKSUM_1;
-            break;
-
-        case PROTOCOL_DECODER_STATE_CHECKSUM_1:
-            packet->checksum += (c << 8);
-            state = PROTOCOL_DECODER_STATE_SYNC_0;
-            isWholePacket = true;
-            break;
+        /* A wrong checksum is passed on for protocolCheckPacket */
+        if (ubxFramerRx(&framer, c) != UBX_RX_NONE)
+        {
+            packet->sync[0] = PROTOCOL_SYNC_0;
+            packet->sync[1] = PROTOCOL_SYNC_1;
+            packet->msgId = framer.msgId;
+            packet->payloadLength = framer.length;
+            packet->checksum = framer.checksum;
+            return true;
         }
 
-        return isWholePacket;
+        /* Neither in a frame nor a sync byte, it belongs to the port */
+        if (idle && ubxFramerIdle(&framer) && c != PROTOCOL_SYNC_0)
+        {
+            protocolPassChar(c);
+        }
     }
-    return isWholePacket;
+    return false;
 }
 
 void protocolReplyPacket(uint16_t msgId)
@@ -215,26 +202,5 @@ bool protocolCheckPacket(const protocolPacket_t *packet)
 
 uint16_t protocolCalculateChecksum(const protocolPacket_t *packet)
 {
-    uint8_t a = 0;
-    uint8_t b = 0;
-
-    a = a + (packet->msgId & 0xFF);
-    b = b + a;
-
-    a = a + (packet->msgId >> 8);
-    b = b + a;
-
-    a = a + (packet->payloadLength & 0xFF);
-    b = b + a;
-
-    a = a + (packet->payloadLength >> 8);
-    b = b + a;
-
-    for(uint16_t i = 0; i < packet->payloadLength; ++i)
-    {
-        a = a + packet->payload[i];
-        b = b + a;
-    }
-
-    return (b << 8) + a;
+    return ubxChecksum(packet->msgId, packet->payload, packet->payloadLength);
 }
@@ -43,22 +43,8 @@ void protocolMsgCallbackNixTst(protocolMsgNixTst_t *tst)
 {
     protocolReplyPacket(PROTOCOL_MSG_ID_NIX_TST);
 
-    for(uint8_t i = 0; i < 10; ++i)
-    {
-        nixieDisplay4t_t d;
-        d.digits[5] = i;
-        d.digits[4] = i;
-        d.digits[3] = i;
-        d.digits[2] = i;
-        d.digits[1] = i;
-        d.digits[0] = i;
-        d.dots[0] = i % 2;
-        d.dots[1] = (i + 1) % 2;
-        d.dots[2] = i % 2;
-        d.dots[3] = (i + 1) % 2;
-        nixieDisplay4t(&d);
-        timer_sleep(100000);
-    }
+    /* Each digit for one second, runs in the background */
+    nixieclockCycleDigits(100000, 10);
 }
 
 /*
@@ -7,17 +7,19 @@
 #include "flip_brose/flip_brose.h"
 #include "rtc/rtc.h"
 #include "rtc/tz.h"
+#include "rtc/dcf.h"
 
 
 void protocolMsgPollCallbackTimUtc(void)
 {
-    uint32_t epoch = rtcGet();
+    rtcPrecise_t now;
+    rtcGetPrecise(&now);
 
     rtcTime_t t;
-    rtcCreateTimeFromEpoch(epoch, &t);
+    rtcCreateTimeFromEpoch(now.seconds, &t);
 
     protocolMsgTimUtc_t utc;
-    utc.nano = 0;
+    utc.nano = rtcTicksToNanos(now.ticks);
     utc.year = t.years + 1900;
     utc.month = t.months;
     utc.day = t.days;
@@ -34,8 +36,10 @@ void protocolMsgCallbackTimUtc(protocolMsgTimUtc_t *utc)
     rtcTime_t t;
     rtcCreateTime ( utc->year, utc->month, utc->day, utc->hour, utc->min, utc->sec, 0, &t );
 
-    uint32_t epoch = rtcToEpochTime ( &t );
-    rtcSet(epoch);
+    rtcPrecise_t p;
+    p.seconds = rtcToEpochTime ( &t );
+    p.ticks = (utc->nano > 0) ? rtcNanosToTicks(utc->nano) : 0;
+    rtcSetPrecise(&p);
 
     protocolReplyPacket(PROTOCOL_MSG_ID_TIM_UTC);
 }
@@ -131,3 +135,89 @@ void protocolMsgCallbackTimDst(protocolMsgTimDst_t *dst)
     tzSetDST(&r);
     protocolReplyPacket(PROTOCOL_MSG_ID_TIM_DST);
 }
+
+void protocolMsgPollCallbackTimZon(uint8_t zone)
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        // answer with error
+        return;
+    }
+
+    tzRule_t std;
+    tzRule_t dst;
+    tzZoneGetSTD(zone, &std);
+    tzZoneGetDST(zone, &dst);
+
+    protocolMsgTimZon_t zon;
+    zon.zone = zone;
+    zon.stdOffset = std.offset;
+    zon.stdHour = std.hour;
+    zon.stdDow = std.dow;
+    zon.stdWeek = std.week;
+    zon.stdMonth = std.month;
+    zon.dstOffset = dst.offset;
+    zon.dstHour = dst.hour;
+    zon.dstDow = dst.dow;
+    zon.dstWeek = dst.week;
+    zon.dstMonth = dst.month;
+
+    protocolMsgSendTimZon(&zon);
+}
+
+void protocolMsgCallbackTimZon(protocolMsgTimZon_t *zon)
+{
+    if (zon->zone >= CFG_TZ_ZONES)
+    {
+        // answer with error
+        return;
+    }
+
+    tzRule_t r;
+    tzCreateRule(zon->stdOffset, zon->stdHour, zon->stdDow, zon->stdWeek, zon->stdMonth, &r);
+    tzZoneStoreSTD(zon->zone, &r);
+    tzZoneSetSTD(zon->zone, &r);
+
+    tzCreateRule(zon->dstOffset, zon->dstHour, zon->dstDow, zon->dstWeek, zon->dstMonth, &r);
+    tzZoneStoreDST(zon->zone, &r);
+    tzZoneSetDST(zon->zone, &r);
+
+    protocolReplyPacket(PROTOCOL_MSG_ID_TIM_ZON);
+}
+
+void protocolMsgPollCallbackTimDcf(bool reset)
+{
+    dcfStat_t stat;
+    dcfGetStat(&stat);
+
+    protocolMsgTimDcf_t dcf;
+    dcf.edges = stat.decoder.total.edges;
+    dcf.glitches = stat.decoder.total.glitches;
+    dcf.missing = stat.decoder.total.missing;
+    dcf.uncertain = stat.decoder.total.uncertain;
+    dcf.tooLong = stat.decoder.total.tooLong;
+    dcf.minuteEdges = stat.decoder.minute.edges;
+    dcf.minuteGlitches = stat.decoder.minute.glitches;
+    dcf.minuteMissing = stat.decoder.minute.missing;
+    dcf.minuteUncertain = stat.decoder.minute.uncertain;
+    dcf.minuteTooLong = stat.decoder.minute.tooLong;
+    dcf.marks = stat.decoder.marks;
+    dcf.decoded = stat.decoder.decoded;
+    for (uint8_t i = 0; i < DCF_FIELD_COUNT; i++)
+    {
+        dcf.failed[i] = stat.decoder.failed[i];
+    }
+    dcf.sinceValid = stat.sinceValidS;
+    for (uint8_t i = 0; i < DCF_WIDTH_BINS; i++)
+    {
+        dcf.width[i] = stat.decoder.width[i];
+    }
+
+    protocolMsgSendTimDcf(&dcf);
+
+    /* The statistics sent are the ones cleared */
+    if (reset)
+    {
+        dcfResetStat();
+    }
+}
@@ -0,0 +1,34 @@
+#include "platform_config.h"
+
+#include "protocol/protocol.h"
+
+#include "loop.h"
+
+
+void protocolMsgPollCallbackSysLop(bool reset)
+{
+    loopStat_t stat;
+    loopGetStat(&stat);
+
+    protocolMsgSysLop_t lop;
+    lop.passes = stat.passes;
+    lop.worstCycles = stat.worstCycles;
+    lop.stalls = stat.stalls;
+    lop.watchdogResets = stat.watchdogResets;
+    lop.worstModule = stat.worstModule;
+    lop.lastStallModule = stat.lastStallModule;
+    lop.watchdogModule = stat.watchdogModule;
+    lop.watchdogReset = stat.watchdogReset;
+    for (uint8_t i = 0; i < LOOP_BUCKETS; i++)
+    {
+        lop.buckets[i] = stat.buckets[i];
+    }
+
+    protocolMsgSendSysLop(&lop);
+
+    /* The statistics sent are the ones cleared */
+    if (reset)
+    {
+        loopReset();
+    }
+}
@@ -61,6 +61,45 @@ bool protocolEvaluatePacket(protocolPacket_t *packet)
         }
         break;
 
+    case PROTOCOL_MSG_ID_TIM_ZON:
+        if(packet->payloadLength == 0)
+        {
+            protocolMsgPollCallbackTimZon(0);
+        }
+        else if(packet->payloadLength == 1)
+        {
+            protocolMsgPollCallbackTimZon(packet->payload[0]);
+        }
+        else
+        {
+            protocolMsgTimZon_t msg;
+            memcpy(&msg, packet->payload, sizeof(protocolMsgTimZon_t));
+            protocolMsgCallbackTimZon(&msg);
+        }
+        break;
+
+    case PROTOCOL_MSG_ID_TIM_DCF:
+        if(packet->payloadLength == 0)
+        {
+            protocolMsgPollCallbackTimDcf(false);
+        }
+        else
+        {
+            protocolMsgPollCallbackTimDcf(packet->payload[0] != 0);
+        }
+        break;
+
+    case PROTOCOL_MSG_ID_SYS_LOP:
+        if(packet->payloadLength == 0)
+        {
+            protocolMsgPollCallbackSysLop(false);
+        }
+        else
+        {
+            protocolMsgPollCallbackSysLop(packet->payload[0] != 0);
+        }
+        break;
+
 #ifdef CFG_NIXIE
     case PROTOCOL_MSG_ID_NIX_TYP:
         if(packet->payloadLength == 0)
@@ -213,6 +252,42 @@ void protocolMsgSendTimSrc(protocolMsgTimSrc_t *msg)
     protocolSendPacket(&packet);
 }
 
+void protocolMsgSendTimZon(protocolMsgTimZon_t *msg)
+{
+    protocolPacket_t packet;
+    packet.sync[0] = PROTOCOL_SYNC_0;
+    packet.sync[1] = PROTOCOL_SYNC_1;
+    packet.msgId = PROTOCOL_MSG_ID_TIM_ZON;
+    packet.payloadLength = sizeof(protocolMsgTimZon_t);
+    memcpy(packet.payload, msg, sizeof(protocolMsgTimZon_t));
+    packet.checksum = protocolCalculateChecksum(&packet);
+    protocolSendPacket(&packet);
+}
+
+void protocolMsgSendTimDcf(protocolMsgTimDcf_t *msg)
+{
+    protocolPacket_t packet;
+    packet.sync[0] = PROTOCOL_SYNC_0;
+    packet.sync[1] = PROTOCOL_SYNC_1;
+    packet.msgId = PROTOCOL_MSG_ID_TIM_DCF;
+    packet.payloadLength = sizeof(protocolMsgTimDcf_t);
+    memcpy(packet.payload, msg, sizeof(protocolMsgTimDcf_t));
+    packet.checksum = protocolCalculateChecksum(&packet);
+    protocolSendPacket(&packet);
+}
+
+void protocolMsgSendSysLop(protocolMsgSysLop_t *msg)
+{
+    protocolPacket_t packet;
+    packet.sync[0] = PROTOCOL_SYNC_0;
+    packet.sync[1] = PROTOCOL_SYNC_1;
+    packet.msgId = PROTOCOL_MSG_ID_SYS_LOP;
+    packet.payloadLength = sizeof(protocolMsgSysLop_t);
+    memcpy(packet.payload, msg, sizeof(protocolMsgSysLop_t));
+    packet.checksum = protocolCalculateChecksum(&packet);
+    protocolSendPacket(&packet);
+}
+
 
 void protocolMsgSendNixTyp(protocolMsgNixTyp_t *msg)
 {
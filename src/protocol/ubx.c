@@ -0,0 +1,284 @@
+/**************************************************************************/
+/*!
+    @file     ubx.c
+
+    @brief    UBX framer for the host protocol and the GPS receiver. The
+              Fletcher checksum is kept while the frame comes in. A table
+              of the messages taken is checked at the header, so only
+              their payload is stored, the others are skipped and length
+              errors are caught before the payload.
+*/
+/**************************************************************************/
+
+#include "protocol/ubx.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef enum
+{
+    UBX_STATE_SYNC_0 = 0,
+    UBX_STATE_SYNC_1,
+    UBX_STATE_CLASS,
+    UBX_STATE_ID,
+    UBX_STATE_LENGTH_0,
+    UBX_STATE_LENGTH_1,
+    UBX_STATE_PAYLOAD,
+    UBX_STATE_CHECKSUM_A,
+    UBX_STATE_CHECKSUM_B
+} ubxState_t;
+
+static bool ubxTake(const ubxFramer_t *f);
+
+
+/**************************************************************************/
+/*!
+    @brief  Sets up a framer
+
+    @param[in]  payload
+                Buffer for the payload of the frames taken
+    @param[in]  size
+                Of the buffer
+    @param[in]  msgs
+                Messages taken, NULL for all that fit into the buffer
+    @param[in]  msgCount
+                Entries in msgs
+*/
+/**************************************************************************/
+void ubxFramerInit(ubxFramer_t *f, uint8_t *payload, uint16_t size, const ubxMsg_t *msgs, uint8_t msgCount)
+{
+    f->msgs = msgs;
+    f->msgCount = msgCount;
+    f->payload = payload;
+    f->size = size;
+    f->msgId = 0;
+    f->length = 0;
+    f->checksum = 0;
+    f->stat = (ubxStat_t){ 0 };
+
+    ubxFramerReset(f);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Drops a frame being received
+*/
+/**************************************************************************/
+void ubxFramerReset(ubxFramer_t *f)
+{
+    f->state = UBX_STATE_SYNC_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  No frame being received past the sync bytes, so the last byte
+            was not inside one
+*/
+/**************************************************************************/
+bool ubxFramerIdle(const ubxFramer_t *f)
+{
+    return (f->state <= UBX_STATE_SYNC_1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Handles a single incoming byte
+
+    @return What the byte completed. The frame is in msgId, length,
+            checksum and the payload buffer until the next one.
+*/
+/**************************************************************************/
+ubxRx_t ubxFramerRx(ubxFramer_t *f, uint8_t c)
+{
+    switch (f->state)
+    {
+    case UBX_STATE_SYNC_0:
+        if (c == UBX_SYNC_0)
+        {
+            f->state = UBX_STATE_SYNC_1;
+        }
+        break;
+
+    case UBX_STATE_SYNC_1:
+        if (c == UBX_SYNC_1)
+        {
+            f->a = 0;
+            f->b = 0;
+            f->state = UBX_STATE_CLASS;
+        }
+        else if (c != UBX_SYNC_0)
+        {
+            f->state = UBX_STATE_SYNC_0;
+        }
+        break;
+
+    case UBX_STATE_PAYLOAD:
+        if (f->take)
+        {
+            f->payload[f->index] = c;
+        }
+        f->a += c;
+        f->b += f->a;
+        if (++f->index == f->length)
+        {
+            f->state = UBX_STATE_CHECKSUM_A;
+        }
+        break;
+
+    case UBX_STATE_CLASS:
+        f->a += c;
+        f->b += f->a;
+        f->msgId = c;
+        f->state = UBX_STATE_ID;
+        break;
+
+    case UBX_STATE_ID:
+        f->a += c;
+        f->b += f->a;
+        f->msgId |= (uint16_t)c << 8;
+        f->state = UBX_STATE_LENGTH_0;
+        break;
+
+    case UBX_STATE_LENGTH_0:
+        f->a += c;
+        f->b += f->a;
+        f->length = c;
+        f->state = UBX_STATE_LENGTH_1;
+        break;
+
+    case UBX_STATE_LENGTH_1:
+        f->a += c;
+        f->b += f->a;
+        f->length |= (uint16_t)c << 8;
+        f->index = 0;
+
+        f->take = ubxTake(f);
+        if (!f->take && (f->msgs == NULL || f->length > UBX_SKIP_MAX))
+        {
+            /* Too long for the buffer or a corrupted length, resync
+               rather than skip */
+            f->stat.overflows++;
+            f->state = UBX_STATE_SYNC_0;
+            break;
+        }
+        f->state = (f->length > 0) ? UBX_STATE_PAYLOAD : UBX_STATE_CHECKSUM_A;
+        break;
+
+    case UBX_STATE_CHECKSUM_A:
+        f->checksum = c;
+        f->state = UBX_STATE_CHECKSUM_B;
+        break;
+
+    case UBX_STATE_CHECKSUM_B:
+        f->checksum |= (uint16_t)c << 8;
+        f->state = UBX_STATE_SYNC_0;
+
+        if (f->checksum != (((uint16_t)f->b << 8) | f->a))
+        {
+            f->stat.checksum++;
+            return f->take ? UBX_RX_CHECKSUM : UBX_RX_NONE;
+        }
+        if (!f->take)
+        {
+            f->stat.ignored++;
+            return UBX_RX_NONE;
+        }
+        f->stat.frames++;
+        return UBX_RX_FRAME;
+
+    default:
+        f->state = UBX_STATE_SYNC_0;
+        break;
+    }
+
+    return UBX_RX_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Looks the frame up in the table, by the header only
+*/
+/**************************************************************************/
+static bool ubxTake(const ubxFramer_t *f)
+{
+    if (f->length > f->size)
+    {
+        return false;
+    }
+    if (f->msgs == NULL)
+    {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < f->msgCount; i++)
+    {
+        if (f->msgs[i].msgId == f->msgId)
+        {
+            return (f->msgs[i].length == UBX_LENGTH_ANY || f->msgs[i].length == f->length);
+        }
+    }
+    return false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  8 bit Fletcher checksum over class, id, length and payload
+
+    @return CK_A in the low byte, CK_B in the high byte
+*/
+/**************************************************************************/
+uint16_t ubxChecksum(uint16_t msgId, const uint8_t *payload, uint16_t length)
+{
+    uint8_t a = 0;
+    uint8_t b = 0;
+
+    a = a + (msgId & 0xFF);
+    b = b + a;
+
+    a = a + (msgId >> 8);
+    b = b + a;
+
+    a = a + (length & 0xFF);
+    b = b + a;
+
+    a = a + (length >> 8);
+    b = b + a;
+
+    for (uint16_t i = 0; i < length; ++i)
+    {
+        a = a + payload[i];
+        b = b + a;
+    }
+
+    return (b << 8) + a;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a frame
+
+    @param[out] frame
+                Room for length + UBX_OVERHEAD bytes
+
+    @return Bytes written
+*/
+/**************************************************************************/
+uint16_t ubxFrame(uint8_t *frame, uint16_t msgId, const uint8_t *payload, uint16_t length)
+{
+    uint16_t checksum = ubxChecksum(msgId, payload, length);
+
+    frame[0] = UBX_SYNC_0;
+    frame[1] = UBX_SYNC_1;
+    frame[2] = msgId & 0xFF;
+    frame[3] = msgId >> 8;
+    frame[4] = length & 0xFF;
+    frame[5] = length >> 8;
+    if (length > 0)
+    {
+        memcpy(&frame[6], payload, length);
+    }
+    frame[6 + length] = checksum & 0xFF;
+    frame[7 + length] = checksum >> 8;
+
+    return length + UBX_OVERHEAD;
+}
@@ -36,42 +36,75 @@
 */
 /**************************************************************************/
 
+
 #include "platform_config.h"
 
 #include <stdio.h>
 #include <stdbool.h>
 
 #include "rtc/dcf.h"
+#include "rtc/dcf_decoder.h"
+#include "rtc/rtc.h"
 #include "led.h"
 #include "timer.h"
+#include "event.h"
+#include "perf.h"
+#include "trace.h"
 
+/* Receiver edge, timestamped by the pin interrupt or the sampler */
 typedef struct
 {
-    uint8_t second;
-    uint8_t minute;
-    uint8_t hour;
-    uint8_t day;
-    uint8_t dow;
-    uint8_t week;
-    uint8_t month;
-    uint8_t year;
-    bool valid;
-} dcf_t;
+    timer_uptime_t time;
+    uint8_t level;
+} dcfEdge_t;
+
+#if (CFG_DCF_EDGE_FIFO & (CFG_DCF_EDGE_FIFO - 1)) != 0 || CFG_DCF_EDGE_FIFO > 128
+#error "CFG_DCF_EDGE_FIFO must be a power of 2, max. 128"
+#endif
+
+#if (1000000 % TIMER_FREQUENCY_HZ) != 0
+#error "The decoder takes the edge times in us"
+#endif
+
+#ifdef CFG_DCF_SAMPLER
+#if CFG_DCF_SAMPLER_INTEGRATOR < 1 || CFG_DCF_SAMPLER_INTEGRATOR > 50
+#error "CFG_DCF_SAMPLER_INTEGRATOR must be 1..50 ms"
+#endif
+
+/* Sampler interrupt only */
+static dcfFilter_t dcfFilter;
+#endif
 
 static void (*_dcfCallback)(void) = NULL;
 
-static bool dcfInSync;
-static uint64_t dcfBitwurst;
-static uint8_t dcfBitwurstIndex;
+/* Written by the interrupt only, read by dcfPoll only */
+static dcfEdge_t dcfEdgeFifo[CFG_DCF_EDGE_FIFO];
+static volatile uint8_t dcfEdgeIn;
+static volatile uint8_t dcfEdgeOut;
+static volatile uint32_t dcfEdgeOverflows;
+
+static dcfStat_t dcfStat;
+
+/* RTC time at the rising edge of the last minute mark */
+static rtcPrecise_t dcfMark;
 
-static uint8_t pinState;
-static uint32_t edgeTime;
+/* Last valid frame in UTC and the capture time of its minute mark */
+static uint32_t dcfSyncUtc;
+static timer_uptime_t dcfSyncTime;
+static uint8_t dcfSyncAgree;
 
-static dcf_t dcf;
+/* Capture time of the last valid minute mark */
+static timer_uptime_t dcfValidTime;
+static bool dcfValidSeen;
 
-bool dcfParse(uint64_t bitwurst);
-bool dcfParity(uint32_t bits, uint8_t len);
-uint8_t dcfBCDToDec(uint8_t val);
+#ifdef CFG_DCF_SAMPLER
+void TIM3_IRQHandler(void);
+#else
+void EXTI15_10_IRQHandler(void);
+#endif
+static void dcfEdgeQueue(timer_uptime_t time, uint8_t level);
+static void dcfEdgeRtc(timer_uptime_t time, rtcPrecise_t *p);
+static void dcfDiscipline(timer_uptime_t time);
 
 
 /**************************************************************************/
@@ -90,134 +123,195 @@ void dcfInit()
     GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
     GPIO_Init(GPIOA, &GPIO_InitStructure);
 
-    dcfInSync = false;
-    dcfBitwurst = 0;
-    dcfBitwurstIndex = 0;
+#ifdef CFG_DCF_SAMPLER
+    /* TIM3 samples the pin at 1 kHz, the filtered edges are queued */
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
 
-    pinState = 0;
-    edgeTime = 0;
+    /* The timer clock is doubled when APB1 is divided */
+    RCC_ClocksTypeDef clocks;
+    RCC_GetClocksFreq(&clocks);
+    uint32_t timerClock = clocks.PCLK1_Frequency;
+    if (clocks.PCLK1_Frequency != clocks.HCLK_Frequency)
+    {
+        timerClock *= 2;
+    }
 
-    dcf.valid = false;
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+    TIM_TimeBaseStructure.TIM_Prescaler = (uint16_t)(timerClock / 100000 - 1);
+    TIM_TimeBaseStructure.TIM_Period = 100 - 1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseInit(TIM3, &TIM_TimeBaseStructure);
+    TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
+    TIM_ITConfig(TIM3, TIM_IT_Update, ENABLE);
+
+    dcfFilter = (dcfFilter_t){ 0 };
+
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = TIM3_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    TIM_Cmd(TIM3, ENABLE);
+#else
+    /* Both edges are timestamped by the interrupt and queued */
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+    GPIO_EXTILineConfig(GPIO_PortSourceGPIOA, GPIO_PinSource10);
+
+    EXTI_InitTypeDef EXTI_InitStructure;
+    EXTI_InitStructure.EXTI_Line = EXTI_Line10;
+    EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+    EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising_Falling;
+    EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+    EXTI_Init(&EXTI_InitStructure);
+
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = EXTI15_10_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+#endif
+
+    dcfDecoderInit();
+    dcfSyncAgree = 0;
+    dcfValidSeen = false;
+
+    dcfEdgeIn = 0;
+    dcfEdgeOut = 0;
+    dcfEdgeOverflows = 0;
+    dcfStat = (dcfStat_t){ 0 };
 }
 
 /**************************************************************************/
 /*!
-    @brief  Polls the relevant incoming message queue to see if anything
-            is waiting to be processed. This needs to be called with
-            relatively high frequency, to ensure proper decoding. (>100Hz)
+    @brief  Stops the dcf reception when another clock source is selected.
+            PA10 is shared with the USART1 RX, its edges must not go on
+            filling the queue, and the 1 kHz sampler must not go on
+            waking the core.
+*/
+/**************************************************************************/
+void dcfDeinit()
+{
+#ifdef CFG_DCF_SAMPLER
+    TIM_Cmd(TIM3, DISABLE);
+    TIM_ITConfig(TIM3, TIM_IT_Update, DISABLE);
+    TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
+
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = TIM3_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = DISABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    NVIC_ClearPendingIRQ(TIM3_IRQn);
+
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, DISABLE);
+#else
+    EXTI_InitTypeDef EXTI_InitStructure;
+    EXTI_InitStructure.EXTI_Line = EXTI_Line10;
+    EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+    EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising_Falling;
+    EXTI_InitStructure.EXTI_LineCmd = DISABLE;
+    EXTI_Init(&EXTI_InitStructure);
+    EXTI_ClearITPendingBit(EXTI_Line10);
+
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = EXTI15_10_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = DISABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    NVIC_ClearPendingIRQ(EXTI15_10_IRQn);
+#endif
+
+    /* The interrupt is off, the edges left in the queue are dropped */
+    dcfEdgeOut = dcfEdgeIn;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decodes the edges queued by the pin interrupt. The main loop
+            calls it for EVENT_DCF_EDGE, the timestamps are taken in the
+            interrupt, so the latency of the main loop does not matter as
+            long as the queue does not overflow.
 */
 /**************************************************************************/
 void dcfPoll()
 {
-    uint8_t pinStateNow = GPIO_ReadInputDataBit((GPIO_TypeDef *)GPIOA_BASE, GPIO_Pin_10);
+    uint8_t depth = dcfEdgeIn - dcfEdgeOut;
+    if (depth > dcfStat.fifoMax)
+    {
+        dcfStat.fifoMax = depth;
+    }
 
-    /* Edge detection */
-    if(pinStateNow != pinState)
+    while (dcfEdgeOut != dcfEdgeIn)
     {
-        uint32_t edgeTimeNow = timer_delayCount;
-        uint32_t edgeTimeDiff = edgeTimeNow - edgeTime;
-        /* Rising edge */
-        if(pinStateNow != 0)
+        dcfEdge_t e = dcfEdgeFifo[dcfEdgeOut & (CFG_DCF_EDGE_FIFO - 1)];
+        __DMB();
+        dcfEdgeOut++;
+
+        uint32_t latency = timer_to_ms(timer_uptime() - e.time);
+        if (latency > dcfStat.latencyMaxMs)
         {
-            led_usr_on();
+            dcfStat.latencyMaxMs = latency;
+        }
 
-            /* Detect minute sync */
-            if((edgeTimeDiff < 2000) && (edgeTimeDiff > 1700))
-            {
-                /* If already in sync: full minute detected */
-                if(dcfInSync)
-                {
-                    dcf.valid = dcfParse(dcfBitwurst);
-                }
-
-                /* Marks the beginning of a minute */
-                dcfInSync = true;
-                dcf.second = 0;
-                dcfBitwurstIndex = 0;
-            }
-            /* Detect begin of second */
-            else if((edgeTimeDiff < 1000) && (edgeTimeDiff > 700))
-            {
-                /* Call the callback function if present */
-                if (NULL != _dcfCallback )
-                {
-                    _dcfCallback();
-                }
-            }
-            /* Unexpected pulse */
-            else
-            {
-                dcfInSync = false;
-                dcf.valid = false;
-            }
+        if (e.level != 0)
+        {
+            led_usr_on();
         }
-        /* Falling edge */
         else
         {
             led_usr_off();
+        }
+
+        uint8_t events = dcfDecoderEdge(e.time * (1000000 / TIMER_FREQUENCY_HZ), e.level);
 
-            /* Only work on dcfBitwurst if sure where to work */
-            if(dcfInSync)
-            {
-                /* Detect 1 */
-                if((edgeTimeDiff < 250) && (edgeTimeDiff > 150))
-                {
-                    dcfBitwurst |= ((uint64_t)1 << dcfBitwurstIndex);
-                }
-                /* Detect 0 */
-                else if ((edgeTimeDiff < 150) && (edgeTimeDiff > 50))
-                {
-                    dcfBitwurst &= ~((uint64_t)1 << dcfBitwurstIndex);
-                }
-                /* Unexpected pulse */
-                else
-                {
-                    dcfInSync = false;
-                    dcf.valid = false;
-                }
-
-                dcf.second++;
-                dcfBitwurstIndex++;
-            }
+        if (events & DCF_DECODER_VALID)
+        {
+            dcfValidTime = e.time;
+            dcfValidSeen = true;
+            dcfEdgeRtc(e.time, &dcfMark);
+            dcfDiscipline(e.time);
         }
 
-        edgeTime = edgeTimeNow;
-        pinState = pinStateNow;
+        /* Call the callback function if present */
+        if ((events & DCF_DECODER_SECOND) && NULL != _dcfCallback)
+        {
+            _dcfCallback();
+        }
     }
-
 }
 
 /**************************************************************************/
 /*!
-    @brief  Parses bitwurst into static dcf structure. Returns false if
-    		parity checks failed.
+    @brief  Returns the edge, reception quality and sync statistics
 */
 /**************************************************************************/
-bool dcfParse(uint64_t bitwurst)
+void dcfGetStat(dcfStat_t *stat)
 {
-    uint8_t minutesBCD = (uint8_t)((bitwurst & (0xFF << 21)) >> 21);
-    if(!dcfParity(minutesBCD, 7)) return false;
-    dcf.minute = dcfBCDToDec((uint8_t)minutesBCD & 0x7F);
-
-    uint8_t hoursBCD = (uint8_t)((bitwurst & ((uint64_t)0x7F << 29)) >> 29);
-    if(!dcfParity(hoursBCD, 6)) return false;
-    dcf.hour = dcfBCDToDec((uint8_t)hoursBCD & 0x3F);
-
-    uint64_t calBCD = ((bitwurst & ((uint64_t)0x7FFFFF << 36)) >> 36);
-    if(!dcfParity(calBCD, 23)) return false;
-
-    dcf.day = dcfBCDToDec((uint8_t)calBCD & 0x3F);
-
-    calBCD = calBCD >> 6;
-    dcf.dow = calBCD & 0x07;
+    *stat = dcfStat;
+    dcfDecoderGetStat(&stat->decoder);
+    stat->overflows = dcfEdgeOverflows;
+    stat->sinceValidS = dcfValidSeen ? (uint32_t)((timer_uptime() - dcfValidTime) / TIMER_FREQUENCY_HZ) : UINT32_MAX;
+    stat->agree = dcfSyncAgree;
+}
 
-    calBCD = calBCD >> 3;
-    dcf.month = dcfBCDToDec((uint8_t)calBCD & 0x1F);
+void dcfResetStat()
+{
+    uint32_t lastSync = dcfStat.lastSync;
+    int32_t offsetUs = dcfStat.offsetUs;
 
-    calBCD = calBCD >> 5;
-    dcf.year = dcfBCDToDec((uint8_t)calBCD & 0xFF);
+    dcfDecoderResetStat();
+    dcfStat = (dcfStat_t){ 0 };
+    dcfEdgeOverflows = 0;
 
-    return true;
+    /* The last sync stays */
+    dcfStat.lastSync = lastSync;
+    dcfStat.offsetUs = offsetUs;
 }
 
 /**************************************************************************/
@@ -227,7 +321,8 @@ bool dcfParse(uint64_t bitwurst)
 /**************************************************************************/
 uint8_t dcfTime(rtcTime_t *local)
 {
-    if(!dcf.valid)
+    dcfDecoderTime_t dcf;
+    if(!dcfDecoderTime(&dcf))
     {
         return 1; /* ToDo: use proper error type */
     }
@@ -248,28 +343,102 @@ uint8_t dcfTime(rtcTime_t *local)
 
 /**************************************************************************/
 /*!
-    @brief  Checks the parity of a given set of bits. The last bit at len
-    		is the parity bit.
+    @brief  Returns the RTC time at an edge captured before
 */
 /**************************************************************************/
-bool dcfParity(uint32_t bits, uint8_t len)
+static void dcfEdgeRtc(timer_uptime_t time, rtcPrecise_t *p)
 {
-    uint8_t result = 0;
-    for(uint8_t i = 0; i < len; i++)
+    rtcGetPrecise(p);
+
+    /* Age of the edge in RTC ticks */
+    uint64_t age = ((timer_uptime() - time) * RTC_TICKS_PER_SECOND) / TIMER_FREQUENCY_HZ;
+
+    p->seconds -= age / RTC_TICKS_PER_SECOND;
+    uint16_t ticks = age % RTC_TICKS_PER_SECOND;
+    if (ticks > p->ticks)
     {
-        result ^= (bits >> i) & 0x01;
+        p->seconds--;
+        p->ticks += RTC_TICKS_PER_SECOND;
     }
-    return (result == ((bits >> len) & 0x01));
+    p->ticks -= ticks;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Converts BCD value received by DCF to decimal value
+    @brief  Disciplines the RTC with a valid frame. The frame is local
+            time, CET or CEST as its flags say. Once CFG_DCF_SYNC_FRAMES
+            frames in a row are a minute apart, in UTC as well as by
+            their minute marks, the RTC is corrected by the difference at the minute
+            mark. Corrections below CFG_DCF_SYNC_MIN_MS are only counted,
+            so the RTC is not written every minute.
 */
 /**************************************************************************/
-uint8_t dcfBCDToDec(uint8_t val)
+static void dcfDiscipline(timer_uptime_t time)
 {
-    return (val >> 4) * 10 + (val & 0x0F);
+    dcfDecoderTime_t dcf;
+    rtcTime_t t;
+
+    dcfDecoderTime(&dcf);
+    if (rtcCreateTime(dcf.year + 100, dcf.month, dcf.day, dcf.hour, dcf.minute, 0, 0, &t) != ERROR_NONE)
+    {
+        dcfSyncAgree = 0;
+        return;
+    }
+    uint32_t utc = rtcToEpochTime(&t) - ((dcf.flags & DCF_FLAG_CEST) ? 7200 : 3600);
+
+    int32_t apart = (int32_t)timer_to_ms(time - dcfSyncTime) - 60000;
+    if (dcfSyncAgree > 0 && utc == dcfSyncUtc + 60 && apart < 500 && apart > -500)
+    {
+        if (dcfSyncAgree < 255)
+        {
+            dcfSyncAgree++;
+        }
+    }
+    else
+    {
+        dcfSyncAgree = 1;
+    }
+    dcfSyncUtc = utc;
+    dcfSyncTime = time;
+    dcfStat.frames++;
+
+    if (dcfSyncAgree < CFG_DCF_SYNC_FRAMES)
+    {
+        return;
+    }
+
+    /* DCF - RTC at the minute mark */
+    int64_t offset = ((int64_t)utc - dcfMark.seconds) * RTC_TICKS_PER_SECOND - dcfMark.ticks;
+    int64_t offsetUs = (offset * 1000000) / RTC_TICKS_PER_SECOND;
+    uint64_t absUs = (offsetUs < 0) ? -offsetUs : offsetUs;
+
+    dcfStat.lastSync = utc;
+    dcfStat.offsetUs = (absUs > INT32_MAX) ? ((offsetUs < 0) ? -INT32_MAX : INT32_MAX) : (int32_t)offsetUs;
+    if (absUs > dcfStat.offsetMaxAbsUs)
+    {
+        dcfStat.offsetMaxAbsUs = (absUs > UINT32_MAX) ? UINT32_MAX : (uint32_t)absUs;
+    }
+
+    bool set = (absUs >= (uint64_t)CFG_DCF_SYNC_MIN_MS * 1000);
+    TRACE(TRACE_DCF_SYNC, set, (absUs / 1000 > UINT16_MAX) ? UINT16_MAX : absUs / 1000);
+    if (!set)
+    {
+        dcfStat.skipped++;
+        return;
+    }
+
+    /* Fast set, the RTC is running already */
+    rtcPrecise_t now;
+    rtcGetPrecise(&now);
+    uint64_t ticks = (uint64_t)now.seconds * RTC_TICKS_PER_SECOND + now.ticks + offset;
+    now.seconds = ticks / RTC_TICKS_PER_SECOND;
+    now.ticks = ticks % RTC_TICKS_PER_SECOND;
+    rtcSetPrecise(&now);
+    dcfStat.syncs++;
+
+    /* The mark on the corrected RTC */
+    dcfMark.seconds = utc;
+    dcfMark.ticks = 0;
 }
 
 /**************************************************************************/
@@ -282,3 +451,84 @@ void dcfSetCallback (void (*pFunc)(void))
 {
     _dcfCallback = pFunc;
 }
+
+/**************************************************************************/
+/*!
+    @brief  Queues an edge with its timestamp for dcfPoll in the main
+            loop, called by the interrupt
+*/
+/**************************************************************************/
+static void dcfEdgeQueue(timer_uptime_t time, uint8_t level)
+{
+    TRACE(TRACE_DCF_EDGE, level, 0);
+
+    if ((uint8_t)(dcfEdgeIn - dcfEdgeOut) < CFG_DCF_EDGE_FIFO)
+    {
+        dcfEdge_t *e = &dcfEdgeFifo[dcfEdgeIn & (CFG_DCF_EDGE_FIFO - 1)];
+        e->time = time;
+        e->level = level;
+        /* The entry is complete before dcfPoll can see it */
+        __DMB();
+        dcfEdgeIn++;
+    }
+    else
+    {
+        dcfEdgeOverflows++;
+    }
+
+    eventPost(EVENT_DCF_EDGE);
+}
+
+#ifdef CFG_DCF_SAMPLER
+/**************************************************************************/
+/*!
+    @brief  Samples the receiver output every ms. The integrator only
+            passes levels that last CFG_DCF_SAMPLER_INTEGRATOR samples, an
+            edge is timestamped back to where the level changed. The main
+            loop is only woken for the edges.
+*/
+/**************************************************************************/
+void TIM3_IRQHandler(void)
+{
+    PERF_BEGIN(PERF_ISR_DCF);
+
+    if (TIM_GetITStatus(TIM3, TIM_IT_Update) != RESET)
+    {
+        TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
+
+        uint8_t last = dcfFilter.level;
+        uint8_t sample = GPIO_ReadInputDataBit((GPIO_TypeDef *)GPIOA_BASE, GPIO_Pin_10);
+        uint8_t level = dcfFilterSample(&dcfFilter, sample, CFG_DCF_SAMPLER_INTEGRATOR);
+
+        if (level != last)
+        {
+            timer_uptime_t delay = (CFG_DCF_SAMPLER_INTEGRATOR * TIMER_FREQUENCY_HZ) / 1000;
+            dcfEdgeQueue(timer_uptime() - delay, level);
+        }
+    }
+
+    PERF_END(PERF_ISR_DCF);
+}
+#else
+/**************************************************************************/
+/*!
+    @brief  Edge of the receiver output, queued with its timestamp for
+            dcfPoll in the main loop
+*/
+/**************************************************************************/
+void EXTI15_10_IRQHandler(void)
+{
+    PERF_BEGIN(PERF_ISR_DCF);
+
+    if(EXTI_GetITStatus(EXTI_Line10) != RESET)
+    {
+        timer_uptime_t now = timer_uptime();
+        EXTI_ClearITPendingBit(EXTI_Line10);
+        uint8_t level = GPIO_ReadInputDataBit((GPIO_TypeDef *)GPIOA_BASE, GPIO_Pin_10);
+
+        dcfEdgeQueue(now, level);
+    }
+
+    PERF_END(PERF_ISR_DCF);
+}
+#endif
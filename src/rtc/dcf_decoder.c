@@ -0,0 +1,666 @@
+/**************************************************************************/
+/*!
+    @file     dcf_decoder.c
+
+    @brief    DCF77 decoder working on timestamped edges of the receiver
+              output only. Each second is kept as a soft bit, the pulse
+              length - 150 ms, and up to three consecutive minutes are
+              combined to decode a frame.
+*/
+/**************************************************************************/
+
+#include "rtc/dcf_decoder.h"
+
+#include <stddef.h>
+
+#define DCF_FRAME_BITS      (59)
+#define DCF_FRAMES          (3)     /* Consecutive minutes combined */
+#define DCF_LLR_MAX         (60)
+#define DCF_LLR_CLEAN       (20)    /* A pulse outside 130..170 ms */
+#define DCF_LLR_NONE        (-128)  /* No pulse in the second */
+#define DCF_MARGIN          (140)   /* Score lead of the best minute / hour */
+#define DCF_PHASE_US        (40000) /* Second starts tolerated off the phase */
+#define DCF_PULSE_MIN_US    (40000)
+#define DCF_PULSE_MAX_US    (260000)
+#define DCF_PHASE_LOST_US   (10000000)
+
+/* One minute of bits */
+typedef struct
+{
+    int8_t llr[DCF_FRAME_BITS];
+} dcfFrame_t;
+
+static dcfDecoderStat_t dcfStat;
+static dcfDecoderCount_t dcfMinuteCount;
+static dcfField_t dcfDecodeFailed;
+
+static uint8_t pinState;
+
+/* Phase of the second starts */
+static bool dcfPhaseLocked;
+static dcfDecoderUs_t dcfPhaseTime;
+static dcfDecoderUs_t dcfCandidateTime;
+
+/* Pulse of the current second, the last falling edge in the window ends it */
+static dcfDecoderUs_t dcfPulseWidth;
+static bool dcfPulseOpen;
+
+/* The last 60 seconds, a minute mark closes a frame */
+static int8_t dcfSlots[60];
+static uint8_t dcfSlotIndex;
+static uint8_t dcfSlotCount;
+static uint8_t dcfSlotsSinceFrame;
+
+/* Consecutive frames, oldest first */
+static dcfFrame_t dcfFrames[DCF_FRAMES];
+static uint8_t dcfFrameCount;
+
+static dcfDecoderTime_t dcfDecoded;
+static bool dcfDecodedValid;
+
+static uint8_t dcfRise(dcfDecoderUs_t t);
+static void dcfSlotClose(void);
+static void dcfSlotPush(int8_t llr);
+static uint8_t dcfMinute(void);
+static bool dcfDecode(const dcfFrame_t *frames, uint8_t n);
+static int32_t dcfFieldScore(const int8_t *llr, uint8_t bits, uint8_t value);
+static bool dcfFieldDecode(const int16_t *llr, uint8_t bits, uint32_t *value);
+static uint8_t dcfBCDToDec(uint8_t val);
+static uint8_t dcfToBCD(uint8_t val);
+static uint8_t dcfWeekday(uint8_t year, uint8_t month, uint8_t day);
+static void dcfErrorAdd(dcfError_t *e, int32_t us);
+
+
+/**************************************************************************/
+/*!
+    @brief  Resets the decoder, the phase and the frames are lost
+*/
+/**************************************************************************/
+void dcfDecoderInit()
+{
+    pinState = 0;
+
+    dcfPhaseLocked = false;
+    dcfCandidateTime = 0;
+    dcfPulseWidth = 0;
+    dcfSlotIndex = 0;
+    dcfSlotCount = 0;
+    dcfSlotsSinceFrame = 0;
+    dcfFrameCount = 0;
+
+    dcfStat = (dcfDecoderStat_t){ 0 };
+    dcfMinuteCount = (dcfDecoderCount_t){ 0 };
+
+    dcfDecoded = (dcfDecoderTime_t){ 0 };
+    dcfDecodedValid = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decodes one edge at the time it was captured
+
+    The rising edges in phase with the seconds start them, others are
+    spikes and ignored instead of dropping the minute. The last falling
+    edge within DCF_PULSE_MAX_US of the start ends the pulse, so a dropout
+    inside the pulse does not shorten it.
+
+    @param[in]  time
+                Capture time, edges must come in order
+    @param[in]  level
+                Receiver output after the edge
+
+    @return Bitmask of dcfDecoderEvent_t
+*/
+/**************************************************************************/
+uint8_t dcfDecoderEdge(dcfDecoderUs_t time, uint8_t level)
+{
+    /* Edge detection, two edges merged into one read the same level */
+    if (level == pinState)
+    {
+        return DCF_DECODER_NONE;
+    }
+    pinState = level;
+    dcfStat.total.edges++;
+    dcfMinuteCount.edges++;
+
+    /* Rising edge */
+    if (level != 0)
+    {
+        return dcfRise(time);
+    }
+
+    /* Falling edge */
+    dcfDecoderUs_t width = time - dcfPhaseTime;
+    if (dcfPhaseLocked && width < DCF_PULSE_MAX_US)
+    {
+        dcfPulseWidth = width;
+    }
+    else if (dcfPhaseLocked && dcfPulseOpen)
+    {
+        /* Still the pulse of the second start */
+        dcfStat.total.tooLong++;
+        dcfMinuteCount.tooLong++;
+        dcfStat.width[DCF_WIDTH_BINS - 1]++;
+    }
+    dcfPulseOpen = false;
+    return DCF_DECODER_NONE;
+}
+
+static uint8_t dcfRise(dcfDecoderUs_t t)
+{
+    dcfDecoderUs_t d = t - dcfPhaseTime;
+
+    if (dcfPhaseLocked && d > DCF_PHASE_LOST_US)
+    {
+        dcfPhaseLocked = false;
+        dcfFrameCount = 0;
+    }
+
+    if (!dcfPhaseLocked)
+    {
+        /* Lock to two rising edges a whole number of seconds apart */
+        dcfDecoderUs_t c = t - dcfCandidateTime;
+        dcfDecoderUs_t k = (c + 500000) / 1000000;
+        int64_t err = (int64_t)c - (int64_t)(k * 1000000);
+
+        if (dcfCandidateTime != 0 && k >= 1 && k <= 2 && err <= DCF_PHASE_US && err >= -DCF_PHASE_US)
+        {
+            dcfPhaseLocked = true;
+            dcfPhaseTime = t;
+            dcfPulseWidth = 0;
+            dcfPulseOpen = true;
+            dcfSlotCount = 0;
+            dcfSlotsSinceFrame = 0;
+            for (uint8_t i = 0; i < 60; i++)
+            {
+                dcfSlots[i] = 0;
+            }
+        }
+        else
+        {
+            dcfCandidateTime = t;
+        }
+        return DCF_DECODER_NONE;
+    }
+
+    dcfDecoderUs_t k = (d + 500000) / 1000000;
+    int32_t err = (int32_t)(d - k * 1000000);
+    if (k == 0 || err > DCF_PHASE_US || err < -DCF_PHASE_US)
+    {
+        dcfStat.total.glitches++;
+        dcfMinuteCount.glitches++;
+        return DCF_DECODER_NONE;
+    }
+
+    dcfErrorAdd(&dcfStat.period, err);
+
+    /* Close the last second and the ones without a pulse */
+    dcfSlotClose();
+    for (dcfDecoderUs_t i = 1; i < k && i < 60; i++)
+    {
+        dcfSlotPush(DCF_LLR_NONE);
+    }
+    if (k > 2)
+    {
+        /* One of them may have been the minute mark */
+        dcfStat.total.missing += k - 2;
+        dcfMinuteCount.missing += k - 2;
+    }
+
+    dcfPhaseTime = t;
+    dcfPulseWidth = 0;
+    dcfPulseOpen = true;
+    dcfDecoded.second += k;
+
+    /* A single second without a pulse ends the minute */
+    if (k == 2)
+    {
+        uint8_t events = dcfMinute();
+        if (!(events & DCF_DECODER_MINUTE))
+        {
+            /* Not a minute mark but a dropout */
+            dcfStat.total.missing++;
+            dcfMinuteCount.missing++;
+        }
+        return DCF_DECODER_SECOND | events;
+    }
+    return DCF_DECODER_SECOND;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stores the pulse of the second that ends as a soft bit
+*/
+/**************************************************************************/
+static void dcfSlotClose()
+{
+    int32_t width = dcfPulseWidth / 1000;
+
+    if (dcfPulseWidth > 0)
+    {
+        dcfStat.width[(width / DCF_WIDTH_BIN_MS < DCF_WIDTH_BINS) ? width / DCF_WIDTH_BIN_MS : DCF_WIDTH_BINS - 1]++;
+    }
+
+    if (dcfPulseWidth < DCF_PULSE_MIN_US)
+    {
+        /* Start without a pulse, the bit is unknown */
+        dcfStat.total.missing++;
+        dcfMinuteCount.missing++;
+        dcfSlotPush(0);
+        return;
+    }
+
+    int32_t nominal = (width < 150) ? 100000 : 200000;
+    dcfErrorAdd(&dcfStat.pulse, (int32_t)dcfPulseWidth - nominal);
+
+    int32_t llr = width - 150;
+    if (llr < DCF_LLR_CLEAN && llr > -DCF_LLR_CLEAN)
+    {
+        dcfStat.total.uncertain++;
+        dcfMinuteCount.uncertain++;
+    }
+    if (llr > DCF_LLR_MAX)
+    {
+        llr = DCF_LLR_MAX;
+    }
+    else if (llr < -DCF_LLR_MAX)
+    {
+        llr = -DCF_LLR_MAX;
+    }
+    dcfSlotPush(llr);
+}
+
+static void dcfSlotPush(int8_t llr)
+{
+    dcfSlots[dcfSlotIndex] = llr;
+    dcfSlotIndex = (dcfSlotIndex + 1) % 60;
+
+    if (dcfSlotCount < 60)
+    {
+        dcfSlotCount++;
+    }
+    if (dcfSlotsSinceFrame < 255)
+    {
+        dcfSlotsSinceFrame++;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  A minute mark candidate, the last 59 seconds before the one
+            without a pulse are the frame. Frames a minute apart are
+            combined even if they do not decode alone. A dropout between
+            the marks of such a sequence is ignored unless its frame
+            decodes alone.
+
+    @return DCF_DECODER_MINUTE, with DCF_DECODER_VALID if it decoded
+*/
+/**************************************************************************/
+static uint8_t dcfMinute()
+{
+    /* Second 0 is always 0, it may be missing from the first frame */
+    if (dcfSlotCount < 59)
+    {
+        return DCF_DECODER_NONE;
+    }
+
+    dcfFrame_t frame;
+    for (uint8_t i = 0; i < DCF_FRAME_BITS; i++)
+    {
+        /* dcfSlotIndex is the oldest slot, second 0 of the frame */
+        int8_t llr = dcfSlots[(dcfSlotIndex + i) % 60];
+        frame.llr[i] = (llr == DCF_LLR_NONE) ? 0 : llr;
+    }
+
+    bool valid;
+    if (dcfFrameCount > 0 && dcfSlotsSinceFrame == 60)
+    {
+        if (dcfFrameCount == DCF_FRAMES)
+        {
+            for (uint8_t i = 1; i < DCF_FRAMES; i++)
+            {
+                dcfFrames[i - 1] = dcfFrames[i];
+            }
+            dcfFrameCount--;
+        }
+        dcfFrames[dcfFrameCount++] = frame;
+
+        valid = dcfDecode(dcfFrames, dcfFrameCount);
+
+        /* The frames before may not have been minutes */
+        if (!valid && dcfFrameCount > 1 && dcfDecode(&frame, 1))
+        {
+            dcfFrames[0] = frame;
+            dcfFrameCount = 1;
+            valid = true;
+        }
+    }
+    else if (dcfFrameCount > 0 && dcfSlotsSinceFrame < 60)
+    {
+        if (!dcfDecode(&frame, 1))
+        {
+            /* A dropout */
+            return DCF_DECODER_NONE;
+        }
+        dcfFrames[0] = frame;
+        dcfFrameCount = 1;
+        valid = true;
+    }
+    else
+    {
+        dcfFrames[0] = frame;
+        dcfFrameCount = 1;
+        valid = dcfDecode(dcfFrames, 1);
+    }
+
+    dcfSlotsSinceFrame = 0;
+    dcfDecoded.second = 0;
+    dcfDecodedValid = valid;
+
+    dcfStat.marks++;
+    dcfStat.minute = dcfMinuteCount;
+    dcfMinuteCount = (dcfDecoderCount_t){ 0 };
+    if (valid)
+    {
+        dcfStat.decoded++;
+    }
+    else
+    {
+        dcfStat.failed[dcfDecodeFailed]++;
+    }
+
+    return valid ? (DCF_DECODER_MINUTE | DCF_DECODER_VALID) : DCF_DECODER_MINUTE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decodes the consecutive frames, the newest is the one
+            returned. The minute and the hour are the values that fit
+            all frames best, counting up from frame to frame. The date
+            bits of the frames of the same day are added up.
+*/
+/**************************************************************************/
+static bool dcfDecode(const dcfFrame_t *frames, uint8_t n)
+{
+    /* Start of time information is always 1 */
+    int32_t start = 0;
+    for (uint8_t k = 0; k < n; k++)
+    {
+        start += frames[k].llr[20];
+    }
+    if (start <= 0)
+    {
+        dcfDecodeFailed = DCF_FIELD_START;
+        return false;
+    }
+
+    /* Minute, 7 bits and parity from bit 21 */
+    int32_t best = INT32_MIN;
+    int32_t second = INT32_MIN;
+    uint8_t minute = 0;
+    for (uint8_t m = 0; m < 60; m++)
+    {
+        int32_t s = 0;
+        for (uint8_t k = 0; k < n; k++)
+        {
+            uint8_t mk = (m + 60 - (n - 1 - k)) % 60;
+            s += dcfFieldScore(&frames[k].llr[21], 7, dcfToBCD(mk));
+        }
+        if (s > best)
+        {
+            second = best;
+            best = s;
+            minute = m;
+        }
+        else if (s > second)
+        {
+            second = s;
+        }
+    }
+    if (best - second < DCF_MARGIN)
+    {
+        dcfDecodeFailed = DCF_FIELD_MINUTE;
+        return false;
+    }
+
+    /* Hour, 6 bits and parity from bit 29, one less before a new hour */
+    best = INT32_MIN;
+    second = INT32_MIN;
+    uint8_t hour = 0;
+    for (uint8_t h = 0; h < 24; h++)
+    {
+        int32_t s = 0;
+        for (uint8_t k = 0; k < n; k++)
+        {
+            uint8_t hk = (minute < n - 1 - k) ? (h + 23) % 24 : h;
+            s += dcfFieldScore(&frames[k].llr[29], 6, dcfToBCD(hk));
+        }
+        if (s > best)
+        {
+            second = best;
+            best = s;
+            hour = h;
+        }
+        else if (s > second)
+        {
+            second = s;
+        }
+    }
+    if (best - second < DCF_MARGIN)
+    {
+        dcfDecodeFailed = DCF_FIELD_HOUR;
+        return false;
+    }
+
+    /* Date, 22 bits and parity from bit 36, and the flags */
+    int16_t date[23];
+    int16_t flags[5];
+    for (uint8_t i = 0; i < 23; i++)
+    {
+        date[i] = 0;
+    }
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        flags[i] = 0;
+    }
+    for (uint8_t k = 0; k < n; k++)
+    {
+        /* Not across midnight */
+        if (hour == 0 && minute < n - 1 - k)
+        {
+            continue;
+        }
+        for (uint8_t i = 0; i < 23; i++)
+        {
+            date[i] += frames[k].llr[36 + i];
+        }
+        for (uint8_t i = 0; i < 5; i++)
+        {
+            flags[i] += frames[k].llr[15 + i];
+        }
+    }
+
+    uint32_t cal;
+    if (!dcfFieldDecode(date, 22, &cal))
+    {
+        dcfDecodeFailed = DCF_FIELD_DATE;
+        return false;
+    }
+
+    uint8_t dayBCD = cal & 0x3F;
+    uint8_t dow = (cal >> 6) & 0x07;
+    uint8_t monthBCD = (cal >> 9) & 0x1F;
+    uint8_t yearBCD = (cal >> 14) & 0xFF;
+
+    /* Plausible BCD values */
+    if ((dayBCD & 0x0F) > 9 || (monthBCD & 0x0F) > 9 || (yearBCD & 0x0F) > 9 || (yearBCD >> 4) > 9)
+    {
+        dcfDecodeFailed = DCF_FIELD_CHECK;
+        return false;
+    }
+    uint8_t day = dcfBCDToDec(dayBCD);
+    uint8_t month = dcfBCDToDec(monthBCD);
+    uint8_t year = dcfBCDToDec(yearBCD);
+    if (day < 1 || day > 31 || month < 1 || month > 12 || dow != dcfWeekday(year, month, day))
+    {
+        dcfDecodeFailed = DCF_FIELD_CHECK;
+        return false;
+    }
+
+    /* Either CEST (bit 17) or CET (bit 18) */
+    if ((flags[2] > 0) == (flags[3] > 0))
+    {
+        dcfDecodeFailed = DCF_FIELD_CHECK;
+        return false;
+    }
+
+    dcfDecoded.minute = minute;
+    dcfDecoded.hour = hour;
+    dcfDecoded.day = day;
+    dcfDecoded.dow = dow;
+    dcfDecoded.month = month;
+    dcfDecoded.year = year;
+    dcfDecoded.flags = 0;
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        if (flags[i] > 0)
+        {
+            dcfDecoded.flags |= (1 << i);
+        }
+    }
+
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns how well the soft bits fit a value with even parity,
+            the sum of the bits agreeing minus the ones disagreeing
+*/
+/**************************************************************************/
+static int32_t dcfFieldScore(const int8_t *llr, uint8_t bits, uint8_t value)
+{
+    int32_t s = 0;
+    uint8_t parity = 0;
+
+    for (uint8_t i = 0; i <= bits; i++)
+    {
+        uint8_t bit = (i < bits) ? (value >> i) & 0x01 : parity;
+        parity ^= bit;
+        s += bit ? llr[i] : -llr[i];
+    }
+    return s;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decides a field with even parity. At most one bit may be
+            uncertain, a parity error then flips it.
+*/
+/**************************************************************************/
+static bool dcfFieldDecode(const int16_t *llr, uint8_t bits, uint32_t *value)
+{
+    uint32_t v = 0;
+    uint8_t parity = 0;
+    uint8_t weak = 0;
+    uint8_t weakest = 0;
+
+    for (uint8_t i = 0; i <= bits; i++)
+    {
+        if (llr[i] > 0)
+        {
+            v |= ((uint32_t)1 << i);
+            parity ^= 1;
+        }
+        if (llr[i] < DCF_LLR_CLEAN && llr[i] > -DCF_LLR_CLEAN)
+        {
+            weak++;
+            weakest = i;
+        }
+    }
+
+    if (weak > 1 || (parity != 0 && weak == 0))
+    {
+        return false;
+    }
+    if (parity != 0)
+    {
+        v ^= ((uint32_t)1 << weakest);
+    }
+
+    *value = v & (((uint32_t)1 << bits) - 1);
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the time of the last decoded frame, the second counts
+            on from its minute mark
+
+    @return false if the last minute mark did not decode
+*/
+/**************************************************************************/
+bool dcfDecoderTime(dcfDecoderTime_t *time)
+{
+    *time = dcfDecoded;
+    return dcfDecodedValid;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the edge and timing error statistics
+*/
+/**************************************************************************/
+void dcfDecoderGetStat(dcfDecoderStat_t *stat)
+{
+    *stat = dcfStat;
+}
+
+void dcfDecoderResetStat()
+{
+    dcfStat = (dcfDecoderStat_t){ 0 };
+    dcfMinuteCount = (dcfDecoderCount_t){ 0 };
+}
+
+/**************************************************************************/
+/*!
+    @brief  Converts BCD value received by DCF to decimal value
+*/
+/**************************************************************************/
+static uint8_t dcfBCDToDec(uint8_t val)
+{
+    return (val >> 4) * 10 + (val & 0x0F);
+}
+
+static uint8_t dcfToBCD(uint8_t val)
+{
+    return ((val / 10) << 4) | (val % 10);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the day of the week of a date in 2000..2099, 1 is
+            Monday as in the DCF frame
+*/
+/**************************************************************************/
+static uint8_t dcfWeekday(uint8_t year, uint8_t month, uint8_t day)
+{
+    static const uint8_t offset[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    uint16_t y = 2000 + year - (month < 3);
+    uint8_t w = (y + y / 4 - y / 100 + y / 400 + offset[month - 1] + day) % 7;
+
+    return (w == 0) ? 7 : w;
+}
+
+static void dcfErrorAdd(dcfError_t *e, int32_t us)
+{
+    uint32_t absUs = (us < 0) ? -us : us;
+
+    e->count++;
+    e->lastUs = us;
+    e->sumAbsUs += absUs;
+    if (absUs > e->maxAbsUs)
+    {
+        e->maxAbsUs = absUs;
+    }
+}
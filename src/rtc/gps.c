@@ -39,25 +39,51 @@
 
 #ifdef CFG_GPS
 
-#include <string.h>
-#include <stdio.h>
-#include <stdlib.h>
+#include "rtc/gps.h"
+#include "rtc/gps_feed.h"
+#include "rtc/nmea.h"
+#include "rtc/ubx_time.h"
+#include "rtc/rtc.h"
+#include "rtc/rtc_functions.h"
+#include "uart.h"
+#include "timer.h"
+#include "trace.h"
+
+#if (1000000 % TIMER_FREQUENCY_HZ) != 0
+#error "The feed takes the idle line times in us"
+#endif
 
-#include "gps.h"
+#if defined(CFG_GPS_PPS) && !defined(CFG_TIMER_TICKLESS)
+#error "CFG_GPS_PPS captures by TIM2, it needs CFG_TIMER_TICKLESS"
+#endif
 
+/* Ticks of a second */
+#define GPS_SECOND              ((timer_uptime_t)TIMER_FREQUENCY_HZ)
 
+static void (*_gpsCallback)(void) = NULL;
 
-#if CFG_GPS_INT_ENABLE == 1
-#include "core/gpio/gpio.h"
-#endif
+static gpsStat_t gpsStat;
 
-static uint8_t gps_buffer[CFG_GPS_MAXMSGSIZE];
-static uint8_t *gps_buffer_ptr;
+/* Last valid time message in UTC, and if it was NAV-TIMEUTC */
+static uint32_t gpsSyncUtc;
+static uint8_t gpsSyncAgree;
+static bool gpsUbx;
 
-static uint8_t pinState = 0;
+#ifdef CFG_GPS_PPS
+/* The last two PPS edges, the sentence naming a second comes after the
+   next edge at high loop latency */
+static uint32_t gpsPpsCount;
+static timer_uptime_t gpsPps[2];
+static bool gpsPpsPeriodic[2];
+static uint8_t gpsPpsKnown;
+#endif
 
-static gprmc_t rmc;
-static void (*_gpsCallback)(void) = NULL;
+static void gpsTimeMessage(bool ubx);
+#ifdef CFG_GPS_PPS
+static void gpsPpsTake(void);
+static bool gpsPpsPair(gpsFeedUs_t start);
+#endif
+static void gpsDiscipline(timer_uptime_t second, bool pps);
 
 
 /**************************************************************************/
@@ -67,232 +93,400 @@ static void (*_gpsCallback)(void) = NULL;
 /**************************************************************************/
 void gpsInit()
 {
+    gpsFeedInit(CFG_GPS_BAUDRATE);
+    gpsSyncAgree = 0;
+    gpsUbx = false;
+    gpsStat = (gpsStat_t){ 0 };
+
+    uart2InitDma(CFG_GPS_BAUDRATE);
+#ifdef CFG_GPS_UBX
+    gpsSetUbx(true);
+#endif
 
+#ifdef CFG_GPS_PPS
+    gpsPpsCount = 0;
+    gpsPpsKnown = 0;
+    timer_capture_init();
+#endif
+}
 
-    /* Init the gps_buffer ptr */
-    gps_buffer_ptr = gps_buffer;
+/**************************************************************************/
+/*!
+    @brief  Stops the gps reception when another clock source is selected,
+            the DMA and the PPS capture no longer wake the core
+*/
+/**************************************************************************/
+void gpsDeinit()
+{
+    uart2DeinitDma();
+
+#ifdef CFG_GPS_PPS
+    timer_capture_deinit();
+#endif
 }
 
 /**************************************************************************/
 /*!
-    @brief  Polls the relevant incoming message queue to see if anything
-            is waiting to be processed.
+    @brief  Parses what the DMA received since the last poll, called on
+            EVENT_USART2 and EVENT_CAPTURE
 */
 /**************************************************************************/
 void gpsPoll()
 {
-#ifdef CFG_GPS_UART
-    while (uartRxBufferDataPending())
+#ifdef CFG_GPS_PPS
+    gpsPpsTake();
+#endif
+
+    uint32_t written;
+    timer_uptime_t time;
+    uint32_t idles = uart2DmaIdle(&written, &time);
+
+    if (idles > 0)
+    {
+        gpsFeedIdle(idles, written, time * (1000000 / TIMER_FREQUENCY_HZ));
+    }
+
+    uint16_t sentences = gpsFeedData(uart2DmaBuffer(), CFG_USART2_BUFSIZE, uart2DmaWritten());
+    if (sentences & GPS_FEED_SENTENCE(NMEA_RMC))
+    {
+        gpsTimeMessage(false);
+    }
+    if (sentences & GPS_FEED_UBX(UBX_TIME_TIMEUTC))
+    {
+        gpsTimeMessage(true);
+    }
+    if (sentences & GPS_FEED_UBX(UBX_TIME_TP))
+    {
+        ubxTimeTp_t tp;
+        ubxTimeGetTp(&tp);
+        gpsStat.tp++;
+        gpsStat.qErr = tp.qErr;
+    }
+    if (sentences & GPS_FEED_UBX(UBX_TIME_ACK))
     {
-        uint8_t c = uartRxBufferRead();
-        gpsRx(c);
+        gpsStat.acks++;
+    }
+    if (sentences & GPS_FEED_UBX(UBX_TIME_NAK))
+    {
+        gpsStat.naks++;
+    }
+
+    /* Dated by the idle line after its burst, this or a later poll */
+    gpsFeedUs_t start;
+    if (!gpsFeedTimeStarted(&start))
+    {
+        return;
+    }
+    gpsStat.dated++;
+
+#ifdef CFG_GPS_PPS
+    if (gpsPpsPair(start))
+    {
+        return;
     }
 #endif
 
-    /* Get the pinState for the defined pin */
-    uint8_t pinStateNow = LPC_GPIO->B0[CFG_GPS_PIN];
+    /* The second started CFG_GPS_SENTENCE_DELAY_MS before the message */
+    gpsDiscipline(start / (1000000 / TIMER_FREQUENCY_HZ)
+                  - (timer_uptime_t)CFG_GPS_SENTENCE_DELAY_MS * (TIMER_FREQUENCY_HZ / 1000), false);
+}
+
+#ifdef CFG_GPS_PPS
+/**************************************************************************/
+/*!
+    @brief  Takes a new PPS edge from the capture and measures the time
+            since the one before by the timer clock
+*/
+/**************************************************************************/
+static void gpsPpsTake()
+{
+    timer_uptime_t time;
+    uint32_t count = timer_capture(&time);
+
+    if (count == gpsPpsCount)
+    {
+        return;
+    }
 
-    /* Edge detection */
-    if(pinStateNow != pinState)
+    /* Only the last edge is kept by the capture */
+    if (count - gpsPpsCount > 1)
     {
-        /* Rising edge */
-        if(pinStateNow != 0)
+        gpsPpsKnown = 0;
+    }
+    gpsStat.pps += count - gpsPpsCount;
+    gpsPpsCount = count;
+
+    /* Only an edge a second after the one before is the PPS, not noise */
+    bool periodic = false;
+    if (gpsPpsKnown > 0 && time - gpsPps[0] < 2 * GPS_SECOND)
+    {
+        int32_t periodUs = (int32_t)((time - gpsPps[0]) * (1000000 / TIMER_FREQUENCY_HZ)) - 1000000;
+        uint32_t absUs = (periodUs < 0) ? -periodUs : periodUs;
+
+        gpsStat.ppsPeriodUs = periodUs;
+        if (absUs > gpsStat.ppsPeriodMaxAbsUs)
         {
-            /* Call the callback function if present */
-            if (NULL != _gpsCallback )
-            {
-                _gpsCallback();
-            }
+            gpsStat.ppsPeriodMaxAbsUs = absUs;
         }
+        periodic = (absUs <= CFG_GPS_PPS_TOLERANCE_US);
+    }
+    if (!periodic)
+    {
+        gpsStat.ppsAperiodic++;
+    }
+
+    gpsPps[1] = gpsPps[0];
+    gpsPps[0] = time;
+    gpsPpsPeriodic[1] = gpsPpsPeriodic[0];
+    gpsPpsPeriodic[0] = periodic;
+    if (gpsPpsKnown < 2)
+    {
+        gpsPpsKnown++;
     }
 }
 
 /**************************************************************************/
 /*!
-    @brief  Handles a single incoming character.  If a new line is
-            detected, the entire command will be passed to the command
-            parser.  If a text character is detected, it will be added to
-            the message buffer until a new line is detected (up to the
-            maximum queue size, CFG_GPS_MAXMSGSIZE).
-
-    @param[in]  c
-                The character to parse.
+    @brief  Disciplines the RTC by the PPS edge that started the second of
+            the last time message, the last edge less than a second before
+            the message. Only an edge a second after the one before is
+            paired.
+
+    @param[in]  start
+                Uptime in us the message started
+
+    @return false if no PPS ran or its last edge was not a second after
+            the one before, the idle line dates the second instead
 */
 /**************************************************************************/
-void gpsRx(uint8_t c)
+static bool gpsPpsPair(gpsFeedUs_t start)
 {
-    switch (c)
+    timer_uptime_t sentence = start / (1000000 / TIMER_FREQUENCY_HZ);
+
+    for (uint8_t i = 0; i < gpsPpsKnown; i++)
+    {
+        if (gpsPpsPeriodic[i] && gpsPps[i] <= sentence && sentence - gpsPps[i] < GPS_SECOND)
+        {
+            gpsStat.ppsPaired++;
+            gpsDiscipline(gpsPps[i], true);
+            return true;
+        }
+    }
+
+    /* PPS runs but not for this second, the message is not trusted */
+    if (gpsPpsKnown > 0 && gpsPpsPeriodic[0] && timer_uptime() - gpsPps[0] < 2 * GPS_SECOND)
     {
-    case '\n':
-        /* Terminate the buffer and reset the ptr */
-        /* Send it to the handler for processing */
-        *gps_buffer_ptr = '\0';
-        nmeaParse((char *)gps_buffer);
-        gps_buffer_ptr = gps_buffer;
-        break;
-
-    case '$':
-        /* Beginning of a NMEA packet */
-        break;
-
-    default:
-        /* Received a single character */
-        *gps_buffer_ptr++ = c;
-        break;
+        gpsStat.ppsUnpaired++;
+        return true;
     }
+
+    return false;
 }
+#endif
 
+/**************************************************************************/
+/*!
+    @brief  Counts the valid time messages in a row a second apart
 
-error_t gpsTime(rtcTime_t *utc)
+    @param[in]  ubx
+                NAV-TIMEUTC, false for RMC
+*/
+/**************************************************************************/
+static void gpsTimeMessage(bool ubx)
 {
-    if(!rmc.valid)
+    rtcTime_t t;
+
+    gpsUbx = ubx;
+    if (ubx)
     {
-        /* ToDo: use proper error type */
-        return 1;
+        ubxTimeUtc_t timeUtc;
+        ubxTimeGetUtc(&timeUtc);
+        gpsStat.timeUtc++;
+        gpsStat.tAcc = timeUtc.tAcc;
+        gpsStat.nano = timeUtc.nano;
+    }
+    else
+    {
+        gpsStat.rmc++;
     }
 
-    uint16_t year = (rmc.date % 100) + 100;
-    uint8_t month = (rmc.date / 100) % 100;
-    uint8_t day = (rmc.date / 10000) % 100;
-
-    uint8_t hour = ((uint32_t)rmc.time / 10000) % 100;
-    uint8_t minute = ((uint32_t)rmc.time / 100) % 100;
-    uint8_t second = ((uint32_t)rmc.time % 100);
+    if (gpsTime(&t) != ERROR_NONE)
+    {
+        gpsSyncAgree = 0;
+        return;
+    }
+    if (ubx)
+    {
+        gpsStat.timeUtcValid++;
+    }
+    else
+    {
+        gpsStat.rmcValid++;
+    }
 
-    /* ToDo: check for error */
-    ASSERT_STATUS(rtcCreateTime(year, month, day, hour, minute, second, 0, utc));
+    uint32_t utc = rtcToEpochTime(&t);
+    if (gpsSyncAgree > 0 && utc == gpsSyncUtc)
+    {
+        /* RMC and NAV-TIMEUTC of the same second while switching over */
+        return;
+    }
+    if (gpsSyncAgree > 0 && utc == gpsSyncUtc + 1)
+    {
+        if (gpsSyncAgree < 255)
+        {
+            gpsSyncAgree++;
+        }
+    }
+    else
+    {
+        gpsSyncAgree = 1;
+    }
+    gpsSyncUtc = utc;
 
-    return ERROR_NONE;
+    /* Call the callback function if present */
+    if (NULL != _gpsCallback)
+    {
+        _gpsCallback();
+    }
 }
 
 /**************************************************************************/
 /*!
-    @brief  Parse the NMEA string. This function tokenizes the command
-            input, then searches for corresponding NMEA sentence.
-
-    @param[in]  cmd
-                The entire command string to be parsed
+    @brief  Disciplines the RTC with the last time message, once
+            CFG_GPS_SYNC_SENTENCES in a row agree. The counter and the
+            prescaler phase are set so the RTC second starts with the UTC
+            second. Corrections below CFG_GPS_PPS_SYNC_MIN_US by PPS or
+            CFG_GPS_SYNC_MIN_MS by the idle line are only counted.
+
+    @param[in]  second
+                Uptime the second of the message started
+    @param[in]  pps
+                The second is a PPS edge
 */
 /**************************************************************************/
-bool nmeaParse(char *nmea)
+static void gpsDiscipline(timer_uptime_t second, bool pps)
 {
-    /* Check if sentence complete */
-    if (nmea[strlen(nmea) - 4] != '*')
+    if (gpsSyncAgree < CFG_GPS_SYNC_SENTENCES)
     {
-        return false;
+        return;
     }
 
-    /* ToDo: checksum check */
-    /*
-    uint16_t sum = parseHex(nmea[strlen(nmea)-3]) * 16;
-    sum += parseHex(nmea[strlen(nmea)-a]);
-    for (uint8_t i=1; i < (strlen(nmea)-4); i++)
+    /* RTC at the second, back by its age */
+    rtcPrecise_t now;
+    rtcGetPrecise(&now);
+    int64_t age = ((int64_t)(timer_uptime() - second) * RTC_TICKS_PER_SECOND) / TIMER_FREQUENCY_HZ;
+
+    /* GPS - RTC at the second */
+    int64_t offset = ((int64_t)gpsSyncUtc - now.seconds) * RTC_TICKS_PER_SECOND + age - now.ticks;
+    int64_t offsetUs = (offset * 1000000) / RTC_TICKS_PER_SECOND;
+    uint64_t absUs = (offsetUs < 0) ? -offsetUs : offsetUs;
+
+    gpsStat.lastSync = gpsSyncUtc;
+    gpsStat.lastSyncPps = pps;
+    gpsStat.offsetUs = (absUs > INT32_MAX) ? ((offsetUs < 0) ? -INT32_MAX : INT32_MAX) : (int32_t)offsetUs;
+    if (absUs > gpsStat.offsetMaxAbsUs)
     {
-        sum ^= nmea[i];
+        gpsStat.offsetMaxAbsUs = (absUs > UINT32_MAX) ? UINT32_MAX : (uint32_t)absUs;
     }
-    if (sum != 0)
+
+#ifdef CFG_GPS_PPS
+    uint64_t minUs = pps ? CFG_GPS_PPS_SYNC_MIN_US : (uint64_t)CFG_GPS_SYNC_MIN_MS * 1000;
+#else
+    uint64_t minUs = (uint64_t)CFG_GPS_SYNC_MIN_MS * 1000;
+#endif
+    bool set = (absUs >= minUs);
+    TRACE(TRACE_GPS_SYNC, set, (absUs / 1000 > UINT16_MAX) ? UINT16_MAX : absUs / 1000);
+    if (!set)
     {
-        return false;
+        gpsStat.skipped++;
+        return;
     }
-    */
 
-    /* Parse GPRMC sentence */
-    if (strstr(nmea, "GPRMC"))
-    {
-        char *p = nmea;
+    /* Fast set, the RTC is running already */
+    rtcGetPrecise(&now);
+    uint64_t ticks = (uint64_t)now.seconds * RTC_TICKS_PER_SECOND + now.ticks + offset;
+    now.seconds = ticks / RTC_TICKS_PER_SECOND;
+    now.ticks = ticks % RTC_TICKS_PER_SECOND;
+    rtcSetPrecise(&now);
+    gpsStat.syncs++;
+}
 
-        float timef;
-        bool fix;
-        float latitude;
-        float longitude;
-        //float speed;
-        //float coarse;
-        uint32_t date;
+/**************************************************************************/
+/*!
+    @brief  Returns the receive, sentence and sync statistics
+*/
+/**************************************************************************/
+void gpsGetStat(gpsStat_t *stat)
+{
+    *stat = gpsStat;
+    gpsFeedGetStat(&stat->feed);
+    nmeaGetStat(&stat->nmea);
+    ubxTimeGetStat(&stat->ubx);
+    stat->agree = gpsSyncAgree;
+}
 
-        p = strchr(p, ',') + 1;
-        timef = atof(p);
+void gpsResetStat()
+{
+    uint32_t lastSync = gpsStat.lastSync;
+    bool lastSyncPps = gpsStat.lastSyncPps;
+    int32_t offsetUs = gpsStat.offsetUs;
+
+    gpsFeedResetStat();
+    nmeaResetStat();
+    ubxTimeResetStat();
+    gpsStat = (gpsStat_t){ 0 };
+
+    /* The last sync stays */
+    gpsStat.lastSync = lastSync;
+    gpsStat.lastSyncPps = lastSyncPps;
+    gpsStat.offsetUs = offsetUs;
+}
 
-        p = strchr(p, ',') + 1;
-        if (p[0] == 'A')
-        {
-            fix = true;
-        }
-        else if (p[0] == 'V')
-        {
-            fix = false;
-        }
-        else
-        {
-            return false;
-        }
+/**************************************************************************/
+/*!
+    @brief  UTC of the last time message, NAV-TIMEUTC rounded to the
+            second by its fraction
 
-        p = strchr(p, ',') + 1;
-        latitude = atof(p);
+    @return ERROR_INVALIDPARAMETER without a valid fix, else the result
+            of rtcCreateTime
+*/
+/**************************************************************************/
+error_t gpsTime(rtcTime_t *utc)
+{
+    if (gpsUbx)
+    {
+        ubxTimeUtc_t t;
+        ubxTimeGetUtc(&t);
 
-        p = strchr(p, ',') + 1;
-        if (p[0] == 'S')
-        {
-            latitude *= -1.0;
-        }
-        else if (p[0] == 'N')
+        if (!(t.valid & UBX_TIMEUTC_VALID_UTC) || t.year < 1900)
         {
-            latitude = latitude;
+            return ERROR_INVALIDPARAMETER;
         }
-        else if (p[0] == ',')
-        {
-            latitude = 0.0;
-        }
-        else
-        {
-            return false;
-        }
-
-        p = strchr(p, ',') + 1;
-        longitude = atof(p);
 
-        p = strchr(p, ',') + 1;
-        if (p[0] == 'W')
-        {
-            longitude *= -1.0;
-        }
-        else if (p[0] == 'E')
-        {
-            longitude = longitude;
-        }
-        else if (p[0] == ',')
+        error_t error = rtcCreateTime(t.year - 1900, t.month, t.day, t.hour, t.minute, t.second, 0, utc);
+        if (error == ERROR_NONE && (t.nano >= 500000000 || t.nano <= -500000000))
         {
-            longitude = 0.0;
+            error = rtcAddSeconds(utc, (t.nano < 0) ? -1 : 1);
         }
-        else
-        {
-            return false;
-        }
-
-        p = strchr(p, ',') + 1;
-        //speed = atof(p);
-
-        p = strchr(p, ',') + 1;
-        //coarse = atof(p);
-
-        p = strchr(p, ',') + 1;
-        date = atol(p);
+        return error;
+    }
 
-        rmc.time = timef;
-        rmc.date = date;
-        rmc.valid = fix;
-        rmc.latitude = latitude;
-        rmc.longitude = longitude;
+    nmeaRmc_t rmc;
+    nmeaGetRmc(&rmc);
 
-        return true;
+    if(!rmc.valid)
+    {
+        return ERROR_INVALIDPARAMETER;
     }
 
-    return false;
+    return rtcCreateTime(rmc.year + 100, rmc.month, rmc.day,
+                         rmc.time.hour, rmc.time.minute, rmc.time.second, 0, utc);
 }
 
 /**************************************************************************/
 /*!
     @brief  Registers the optional callback function that will be called
-            eve
+            on every valid time message, RMC or NAV-TIMEUTC
 
     @section EXAMPLE
 
@@ -317,5 +511,23 @@ void gpsSetCallback (void (*pFunc)(void))
     _gpsCallback = pFunc;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Switches the receiver output to UBX NAV-TIMEUTC and TIM-TP, or
+            back to NMEA. Sent blocking, about 50 ms at 9600 baud, the
+            receiver answers with ACK-ACK or ACK-NAK per message.
+
+    @param[in]  ubx
+                UBX output, false for NMEA
+*/
+/**************************************************************************/
+void gpsSetUbx(bool ubx)
+{
+    uint8_t frames[UBX_TIME_CONFIG_MAX];
+    uint16_t length = ubxTimeConfig(frames, CFG_GPS_BAUDRATE, ubx);
+
+    uart2Send(frames, length);
+}
+
 
 #endif
@@ -0,0 +1,263 @@
+/**************************************************************************/
+/*!
+    @file     gps_feed.c
+
+    @brief    Reads the GPS receiver output from the circular buffer the
+              DMA writes into, without an interrupt per character. The
+              positions are running totals of the characters written and
+              read, so an overwritten part is detected and skipped. UBX
+              frames go to the UBX time decoder, the bytes between them
+              to the NMEA parser.
+
+              The receiver sends the messages of a second as one burst,
+              the idle line after it dates its last character. The start
+              of the time message, RMC or NAV-TIMEUTC, is dated back from
+              there by the character time, for the RTC without a PPS
+              input.
+*/
+/**************************************************************************/
+
+#include "rtc/gps_feed.h"
+
+#include <stddef.h>
+
+static uint32_t gpsFeedCharNs;      /* 10 bits per character */
+static uint32_t gpsFeedRead;
+static uint32_t gpsFeedDollar;
+static uint32_t gpsFeedUbxStart;
+
+/* Last idle line, and where the one before it was */
+static bool gpsFeedIdleSeen;
+static uint32_t gpsFeedIdleCount;
+static uint32_t gpsFeedIdleWritten;
+static gpsFeedUs_t gpsFeedIdleTime;
+static bool gpsFeedIdlePrevKnown;
+static uint32_t gpsFeedIdlePrevWritten;
+
+/* Last time message, dated once the idle line after it is seen */
+static bool gpsFeedTimePending;
+static uint32_t gpsFeedTimeStart;
+static uint32_t gpsFeedTimeEnd;
+static bool gpsFeedTimeDated;
+static gpsFeedUs_t gpsFeedTimeUs;
+
+static gpsFeedStat_t gpsFeedStat;
+
+static void gpsFeedTime(uint32_t start);
+static void gpsFeedDate(void);
+
+
+/**************************************************************************/
+/*!
+    @brief  Resets the feed, the NMEA parser and the UBX decoder
+
+    @param[in]  baudrate
+                Of the receiver, for the character time
+*/
+/**************************************************************************/
+void gpsFeedInit(uint32_t baudrate)
+{
+    gpsFeedCharNs = 10000000000ull / baudrate;
+    gpsFeedRead = 0;
+    gpsFeedDollar = 0;
+    gpsFeedUbxStart = 0;
+
+    gpsFeedIdleSeen = false;
+    gpsFeedIdlePrevKnown = false;
+
+    gpsFeedTimePending = false;
+    gpsFeedTimeDated = false;
+
+    gpsFeedStat = (gpsFeedStat_t){ 0 };
+
+    nmeaInit();
+    ubxTimeInit();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Takes an idle line, the interrupt counts them and keeps the
+            position and time of the last one
+
+    @param[in]  count
+                Idle lines so far
+    @param[in]  written
+                Characters written up to the idle line
+    @param[in]  time
+                Time of the idle line interrupt
+*/
+/**************************************************************************/
+void gpsFeedIdle(uint32_t count, uint32_t written, gpsFeedUs_t time)
+{
+    if (gpsFeedIdleSeen && count == gpsFeedIdleCount)
+    {
+        return;
+    }
+
+    /* The one before is only known if none was missed */
+    gpsFeedIdlePrevKnown = gpsFeedIdleSeen && (count - gpsFeedIdleCount == 1);
+    if (gpsFeedIdleSeen && count - gpsFeedIdleCount > 1)
+    {
+        gpsFeedStat.idlesMissed += count - gpsFeedIdleCount - 1;
+    }
+    gpsFeedStat.idles++;
+
+    gpsFeedIdlePrevWritten = gpsFeedIdleWritten;
+    gpsFeedIdleWritten = written;
+    gpsFeedIdleTime = time;
+    gpsFeedIdleCount = count;
+    gpsFeedIdleSeen = true;
+
+    gpsFeedDate();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Parses the characters written since the last call
+
+    @param[in]  ring
+                The circular buffer
+    @param[in]  size
+                Of the buffer, a power of 2
+    @param[in]  written
+                Characters written into it so far, wrapping at 2^32
+
+    @return Mask of GPS_FEED_SENTENCE() and GPS_FEED_UBX() of the
+            messages completed
+*/
+/**************************************************************************/
+uint16_t gpsFeedData(const uint8_t *ring, uint32_t size, uint32_t written)
+{
+    uint16_t sentences = 0;
+    uint32_t pending = written - gpsFeedRead;
+
+    if (pending > size)
+    {
+        /* Overwritten, half a buffer is left for the DMA to go on */
+        gpsFeedStat.lost += pending - size / 2;
+        gpsFeedRead = written - size / 2;
+
+        /* Ends the sentence with the gap, it counts as a checksum error */
+        nmeaRx('\n');
+        ubxTimeReset();
+        gpsFeedTimePending = false;
+    }
+    gpsFeedStat.bytes += written - gpsFeedRead;
+
+    while (gpsFeedRead != written)
+    {
+        uint8_t c = ring[gpsFeedRead & (size - 1)];
+        bool outside = ubxTimeIdle();
+        if (outside && c == UBX_SYNC_0)
+        {
+            gpsFeedUbxStart = gpsFeedRead;
+        }
+        if (c == '$')
+        {
+            gpsFeedDollar = gpsFeedRead;
+        }
+        gpsFeedRead++;
+
+        ubxTimeMsg_t m = ubxTimeRx(c);
+        if (m != UBX_TIME_NONE)
+        {
+            sentences |= GPS_FEED_UBX(m);
+            if (m == UBX_TIME_TIMEUTC)
+            {
+                gpsFeedTime(gpsFeedUbxStart);
+            }
+            continue;
+        }
+
+        /* Not inside a frame before or after, a sync byte alone is NMEA */
+        if (!outside || !ubxTimeIdle())
+        {
+            continue;
+        }
+
+        nmeaSentence_t s = nmeaRx(c);
+        if (s == NMEA_NONE)
+        {
+            continue;
+        }
+        sentences |= GPS_FEED_SENTENCE(s);
+
+        if (s == NMEA_RMC)
+        {
+            gpsFeedTime(gpsFeedDollar);
+        }
+    }
+
+    return sentences;
+}
+
+/**************************************************************************/
+/*!
+    @brief  A time message ended at the last character read
+
+    @param[in]  start
+                Position of its first character
+*/
+/**************************************************************************/
+static void gpsFeedTime(uint32_t start)
+{
+    gpsFeedTimePending = true;
+    gpsFeedTimeDated = false;
+    gpsFeedTimeStart = start;
+    gpsFeedTimeEnd = gpsFeedRead;
+    gpsFeedDate();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Dates the start of the time message from the first idle line
+            after it. The burst must have been continuous, no idle line
+            between the start of the message and that one.
+*/
+/**************************************************************************/
+static void gpsFeedDate()
+{
+    if (!gpsFeedTimePending || !gpsFeedIdleSeen || (int32_t)(gpsFeedIdleWritten - gpsFeedTimeEnd) < 0)
+    {
+        return;
+    }
+    gpsFeedTimePending = false;
+
+    if (!gpsFeedIdlePrevKnown || (int32_t)(gpsFeedTimeStart - gpsFeedIdlePrevWritten) < 0)
+    {
+        return;
+    }
+
+    /* The idle line is detected a character after the last one ended */
+    uint32_t chars = gpsFeedIdleWritten - gpsFeedTimeStart + 1;
+    gpsFeedTimeUs = gpsFeedIdleTime - ((uint64_t)chars * gpsFeedCharNs) / 1000;
+    gpsFeedTimeDated = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Time the last time message started, once per message
+
+    @return false if not known (yet)
+*/
+/**************************************************************************/
+bool gpsFeedTimeStarted(gpsFeedUs_t *time)
+{
+    if (!gpsFeedTimeDated)
+    {
+        return false;
+    }
+    gpsFeedTimeDated = false;
+    *time = gpsFeedTimeUs;
+    return true;
+}
+
+void gpsFeedGetStat(gpsFeedStat_t *stat)
+{
+    *stat = gpsFeedStat;
+}
+
+void gpsFeedResetStat()
+{
+    gpsFeedStat = (gpsFeedStat_t){ 0 };
+}
@@ -0,0 +1,656 @@
+/**************************************************************************/
+/*!
+    @file     nmea.c
+
+    @brief    NMEA 0183 parser taking one character at a time. The
+              checksum is kept while the sentence comes in, only the field
+              being received is buffered and RMC, ZDA and GGA are decoded
+              into integers, so there is no float and no sentence buffer.
+              A sentence counts once its checksum matched.
+*/
+/**************************************************************************/
+
+#include "rtc/nmea.h"
+
+#include <stddef.h>
+
+/* Fields seen in the sentence being received */
+#define NMEA_HAVE_TIME      (1 << 0)
+#define NMEA_HAVE_DAY       (1 << 1)
+#define NMEA_HAVE_MONTH     (1 << 2)
+#define NMEA_HAVE_YEAR      (1 << 3)
+#define NMEA_HAVE_FIX       (1 << 4)
+
+typedef enum
+{
+    NMEA_STATE_IDLE = 0,        /**< Waiting for '$' */
+    NMEA_STATE_FIELD,           /**< Address or data field */
+    NMEA_STATE_CHECKSUM_HIGH,
+    NMEA_STATE_CHECKSUM_LOW
+} nmeaState_t;
+
+static nmeaState_t nmeaState;
+static uint8_t nmeaSum;
+static uint8_t nmeaExpected;
+static uint8_t nmeaLength;
+static nmeaSentence_t nmeaType;
+static uint8_t nmeaFieldIndex;
+static char nmeaField[NMEA_FIELD_MAX];
+static uint8_t nmeaFieldLength;
+static bool nmeaFieldError;
+static uint8_t nmeaHave;
+
+/* The sentence being received, taken once the checksum matched */
+static union
+{
+    nmeaRmc_t rmc;
+    nmeaZda_t zda;
+    nmeaGga_t gga;
+} nmeaWork;
+
+static nmeaRmc_t nmeaRmc;
+static nmeaZda_t nmeaZda;
+static nmeaGga_t nmeaGga;
+
+static nmeaStat_t nmeaStat;
+
+static void nmeaFieldEnd(void);
+static nmeaSentence_t nmeaAddress(void);
+static bool nmeaRmcField(uint8_t index);
+static bool nmeaZdaField(uint8_t index);
+static bool nmeaGgaField(uint8_t index);
+static nmeaSentence_t nmeaComplete(void);
+static bool nmeaFixed(uint8_t decimals, int32_t *value);
+static bool nmeaTime(nmeaTime_t *time);
+static bool nmeaDegrees(uint8_t degreeDigits, int32_t *value);
+static int8_t nmeaHex(uint8_t c);
+
+
+/**************************************************************************/
+/*!
+    @brief  Resets the parser, a sentence being received is lost
+*/
+/**************************************************************************/
+void nmeaInit()
+{
+    nmeaState = NMEA_STATE_IDLE;
+    nmeaType = NMEA_NONE;
+
+    nmeaRmc = (nmeaRmc_t){ 0 };
+    nmeaZda = (nmeaZda_t){ 0 };
+    nmeaGga = (nmeaGga_t){ 0 };
+    nmeaStat = (nmeaStat_t){ 0 };
+}
+
+/**************************************************************************/
+/*!
+    @brief  Parses one received character
+
+    A '$' always starts a new sentence, so the parser resynchronises
+    after lost characters. Sentences longer than NMEA_SENTENCE_MAX or
+    without a checksum are dropped, as are those of other types, only
+    their checksum is checked.
+
+    @param[in]  c
+                The character received
+
+    @return The sentence this character completed, its data is taken
+            with nmeaGetRmc, nmeaGetZda or nmeaGetGga
+*/
+/**************************************************************************/
+nmeaSentence_t nmeaRx(uint8_t c)
+{
+    if (c == '$')
+    {
+        if (nmeaState != NMEA_STATE_IDLE)
+        {
+            /* The last one ended early */
+            nmeaStat.checksum++;
+        }
+        nmeaState = NMEA_STATE_FIELD;
+        nmeaSum = 0;
+        nmeaLength = 1;
+        nmeaType = NMEA_NONE;
+        nmeaFieldIndex = 0;
+        nmeaFieldLength = 0;
+        nmeaFieldError = false;
+        nmeaHave = 0;
+        return NMEA_NONE;
+    }
+
+    if (nmeaState == NMEA_STATE_IDLE)
+    {
+        return NMEA_NONE;
+    }
+
+    if (++nmeaLength > NMEA_SENTENCE_MAX)
+    {
+        nmeaStat.overflows++;
+        nmeaState = NMEA_STATE_IDLE;
+        return NMEA_NONE;
+    }
+
+    switch (nmeaState)
+    {
+    case NMEA_STATE_FIELD:
+        if (c == ',')
+        {
+            nmeaSum ^= c;
+            nmeaFieldEnd();
+            nmeaFieldIndex++;
+        }
+        else if (c == '*')
+        {
+            nmeaFieldEnd();
+            nmeaState = NMEA_STATE_CHECKSUM_HIGH;
+        }
+        else if (c == '\r' || c == '\n')
+        {
+            /* No checksum */
+            nmeaStat.checksum++;
+            nmeaState = NMEA_STATE_IDLE;
+        }
+        else
+        {
+            nmeaSum ^= c;
+
+            /* Fields of other sentences are not kept */
+            if (nmeaFieldIndex == 0 || nmeaType != NMEA_NONE)
+            {
+                if (nmeaFieldLength < NMEA_FIELD_MAX)
+                {
+                    nmeaField[nmeaFieldLength++] = c;
+                }
+                else
+                {
+                    nmeaFieldError = true;
+                }
+            }
+        }
+        break;
+
+    case NMEA_STATE_CHECKSUM_HIGH:
+        if (nmeaHex(c) < 0)
+        {
+            nmeaStat.checksum++;
+            nmeaState = NMEA_STATE_IDLE;
+            break;
+        }
+        nmeaExpected = nmeaHex(c) << 4;
+        nmeaState = NMEA_STATE_CHECKSUM_LOW;
+        break;
+
+    case NMEA_STATE_CHECKSUM_LOW:
+        nmeaState = NMEA_STATE_IDLE;
+        if (nmeaHex(c) < 0 || (nmeaExpected | nmeaHex(c)) != nmeaSum)
+        {
+            nmeaStat.checksum++;
+            break;
+        }
+        return nmeaComplete();
+
+    default:
+        nmeaState = NMEA_STATE_IDLE;
+        break;
+    }
+
+    return NMEA_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decodes the field just ended into the work copy
+*/
+/**************************************************************************/
+static void nmeaFieldEnd()
+{
+    if (nmeaFieldIndex == 0)
+    {
+        nmeaType = nmeaAddress();
+    }
+    else if (nmeaFieldError)
+    {
+        /* Too long, the sentence is dropped at its end */
+    }
+    else if (nmeaFieldLength > 0)
+    {
+        bool ok = true;
+        switch (nmeaType)
+        {
+        case NMEA_RMC:
+            ok = nmeaRmcField(nmeaFieldIndex);
+            break;
+        case NMEA_ZDA:
+            ok = nmeaZdaField(nmeaFieldIndex);
+            break;
+        case NMEA_GGA:
+            ok = nmeaGgaField(nmeaFieldIndex);
+            break;
+        default:
+            break;
+        }
+        if (!ok)
+        {
+            nmeaFieldError = true;
+        }
+    }
+    nmeaFieldLength = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  The sentence type from the address field, any talker
+*/
+/**************************************************************************/
+static nmeaSentence_t nmeaAddress()
+{
+    nmeaSentence_t type = NMEA_NONE;
+
+    /* Talker and type, proprietary sentences start with P */
+    if (nmeaFieldLength != 5 || nmeaField[0] == 'P')
+    {
+        return NMEA_NONE;
+    }
+
+    const char *s = &nmeaField[2];
+    if (s[0] == 'R' && s[1] == 'M' && s[2] == 'C')
+    {
+        type = NMEA_RMC;
+        nmeaWork.rmc = (nmeaRmc_t){ 0 };
+    }
+    else if (s[0] == 'Z' && s[1] == 'D' && s[2] == 'A')
+    {
+        type = NMEA_ZDA;
+        nmeaWork.zda = (nmeaZda_t){ 0 };
+    }
+    else if (s[0] == 'G' && s[1] == 'G' && s[2] == 'A')
+    {
+        type = NMEA_GGA;
+        nmeaWork.gga = (nmeaGga_t){ 0 };
+    }
+    return type;
+}
+
+/**************************************************************************/
+/*!
+    @brief  $--RMC,hhmmss.ss,A,ddmm.mm,N,dddmm.mm,E,speed,course,ddmmyy,...
+*/
+/**************************************************************************/
+static bool nmeaRmcField(uint8_t index)
+{
+    nmeaRmc_t *rmc = &nmeaWork.rmc;
+    int32_t v;
+
+    switch (index)
+    {
+    case 1:
+        if (!nmeaTime(&rmc->time))
+        {
+            return false;
+        }
+        nmeaHave |= NMEA_HAVE_TIME;
+        break;
+    case 2:
+        if (nmeaField[0] == 'A')
+        {
+            nmeaHave |= NMEA_HAVE_FIX;
+        }
+        break;
+    case 3:
+        return nmeaDegrees(2, &rmc->latitude);
+    case 4:
+        if (nmeaField[0] == 'S')
+        {
+            rmc->latitude = -rmc->latitude;
+        }
+        break;
+    case 5:
+        return nmeaDegrees(3, &rmc->longitude);
+    case 6:
+        if (nmeaField[0] == 'W')
+        {
+            rmc->longitude = -rmc->longitude;
+        }
+        break;
+    case 9:
+        if (!nmeaFixed(0, &v) || v > 311299)
+        {
+            return false;
+        }
+        rmc->day = v / 10000;
+        rmc->month = (v / 100) % 100;
+        rmc->year = v % 100;
+        if (rmc->day < 1 || rmc->month < 1 || rmc->month > 12)
+        {
+            return false;
+        }
+        nmeaHave |= NMEA_HAVE_DAY | NMEA_HAVE_MONTH | NMEA_HAVE_YEAR;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  $--ZDA,hhmmss.ss,dd,mm,yyyy,zone hours,zone minutes
+*/
+/**************************************************************************/
+static bool nmeaZdaField(uint8_t index)
+{
+    nmeaZda_t *zda = &nmeaWork.zda;
+    int32_t v;
+
+    switch (index)
+    {
+    case 1:
+        if (!nmeaTime(&zda->time))
+        {
+            return false;
+        }
+        nmeaHave |= NMEA_HAVE_TIME;
+        break;
+    case 2:
+        if (!nmeaFixed(0, &v) || v < 1 || v > 31)
+        {
+            return false;
+        }
+        zda->day = v;
+        nmeaHave |= NMEA_HAVE_DAY;
+        break;
+    case 3:
+        if (!nmeaFixed(0, &v) || v < 1 || v > 12)
+        {
+            return false;
+        }
+        zda->month = v;
+        nmeaHave |= NMEA_HAVE_MONTH;
+        break;
+    case 4:
+        if (!nmeaFixed(0, &v) || v < 1980 || v > 2099)
+        {
+            return false;
+        }
+        zda->year = v;
+        nmeaHave |= NMEA_HAVE_YEAR;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  $--GGA,hhmmss.ss,ddmm.mm,N,dddmm.mm,E,quality,satellites,hdop,
+            altitude,M,...
+*/
+/**************************************************************************/
+static bool nmeaGgaField(uint8_t index)
+{
+    nmeaGga_t *gga = &nmeaWork.gga;
+    int32_t v;
+
+    switch (index)
+    {
+    case 1:
+        if (!nmeaTime(&gga->time))
+        {
+            return false;
+        }
+        nmeaHave |= NMEA_HAVE_TIME;
+        break;
+    case 2:
+        return nmeaDegrees(2, &gga->latitude);
+    case 3:
+        if (nmeaField[0] == 'S')
+        {
+            gga->latitude = -gga->latitude;
+        }
+        break;
+    case 4:
+        return nmeaDegrees(3, &gga->longitude);
+    case 5:
+        if (nmeaField[0] == 'W')
+        {
+            gga->longitude = -gga->longitude;
+        }
+        break;
+    case 6:
+        if (!nmeaFixed(0, &v) || v < 0 || v > 9)
+        {
+            return false;
+        }
+        gga->quality = v;
+        if (v > 0)
+        {
+            nmeaHave |= NMEA_HAVE_FIX;
+        }
+        break;
+    case 7:
+        if (!nmeaFixed(0, &v) || v < 0 || v > 99)
+        {
+            return false;
+        }
+        gga->satellites = v;
+        break;
+    case 8:
+        if (!nmeaFixed(2, &v) || v < 0 || v > UINT16_MAX)
+        {
+            return false;
+        }
+        gga->hdop = v;
+        break;
+    case 9:
+        return nmeaFixed(2, &gga->altitudeCm);
+    default:
+        break;
+    }
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Takes the work copy of a sentence with a correct checksum
+*/
+/**************************************************************************/
+static nmeaSentence_t nmeaComplete()
+{
+    if (nmeaType == NMEA_NONE)
+    {
+        nmeaStat.ignored++;
+        return NMEA_NONE;
+    }
+    if (nmeaFieldError)
+    {
+        nmeaStat.fields++;
+        return NMEA_NONE;
+    }
+
+    uint8_t date = NMEA_HAVE_TIME | NMEA_HAVE_DAY | NMEA_HAVE_MONTH | NMEA_HAVE_YEAR;
+    switch (nmeaType)
+    {
+    case NMEA_RMC:
+        nmeaWork.rmc.valid = ((nmeaHave & (date | NMEA_HAVE_FIX)) == (date | NMEA_HAVE_FIX));
+        nmeaRmc = nmeaWork.rmc;
+        break;
+    case NMEA_ZDA:
+        nmeaWork.zda.valid = ((nmeaHave & date) == date);
+        nmeaZda = nmeaWork.zda;
+        break;
+    case NMEA_GGA:
+        nmeaWork.gga.valid = ((nmeaHave & (NMEA_HAVE_TIME | NMEA_HAVE_FIX)) == (NMEA_HAVE_TIME | NMEA_HAVE_FIX));
+        nmeaGga = nmeaWork.gga;
+        break;
+    default:
+        break;
+    }
+    nmeaStat.sentences++;
+    return nmeaType;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Converts the field, a decimal number, to a fixed point value
+            with the given fractional digits. Further digits are cut off.
+
+    @return false if the field is not a number or too large
+*/
+/**************************************************************************/
+static bool nmeaFixed(uint8_t decimals, int32_t *value)
+{
+    int32_t v = 0;
+    bool negative = false;
+    bool point = false;
+    bool digits = false;
+    uint8_t i = 0;
+
+    if (nmeaField[0] == '-')
+    {
+        negative = true;
+        i++;
+    }
+    for (; i < nmeaFieldLength; i++)
+    {
+        char c = nmeaField[i];
+        if (c == '.' && !point)
+        {
+            point = true;
+            continue;
+        }
+        if (c < '0' || c > '9')
+        {
+            return false;
+        }
+        digits = true;
+        if (point)
+        {
+            if (decimals == 0)
+            {
+                continue;
+            }
+            decimals--;
+        }
+        if (v > (INT32_MAX - 9) / 10)
+        {
+            return false;
+        }
+        v = v * 10 + (c - '0');
+    }
+    if (!digits)
+    {
+        return false;
+    }
+    for (; decimals > 0; decimals--)
+    {
+        if (v > INT32_MAX / 10)
+        {
+            return false;
+        }
+        v *= 10;
+    }
+
+    *value = negative ? -v : v;
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Converts the field, hhmmss with an optional fraction
+*/
+/**************************************************************************/
+static bool nmeaTime(nmeaTime_t *time)
+{
+    int32_t v;
+
+    /* hhmmss * 1000 + ms */
+    if (!nmeaFixed(3, &v) || v < 0)
+    {
+        return false;
+    }
+    time->hour = v / 10000000;
+    time->minute = (v / 100000) % 100;
+    time->second = (v / 1000) % 100;
+    time->millis = v % 1000;
+
+    /* A leap second is 60 */
+    return (time->hour < 24 && time->minute < 60 && time->second <= 60);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Converts the field, degrees and decimal minutes, to 1e-7
+            degrees
+
+    @param[in]  degreeDigits
+                2 for the latitude, 3 for the longitude
+*/
+/**************************************************************************/
+static bool nmeaDegrees(uint8_t degreeDigits, int32_t *value)
+{
+    int32_t v;
+
+    /* ddmm * 100000 + fraction of the minute */
+    if (!nmeaFixed(5, &v) || v < 0)
+    {
+        return false;
+    }
+    int32_t degrees = v / 10000000;
+    int32_t minutes = v % 10000000;
+    if (degrees > ((degreeDigits == 2) ? 90 : 180) || minutes >= 6000000)
+    {
+        return false;
+    }
+
+    /* 1e-5 minutes to 1e-7 degrees is 100 / 60 */
+    *value = degrees * 10000000 + (minutes * 5) / 3;
+    return true;
+}
+
+static int8_t nmeaHex(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  The last RMC, ZDA and GGA sentences with a correct checksum
+*/
+/**************************************************************************/
+void nmeaGetRmc(nmeaRmc_t *rmc)
+{
+    *rmc = nmeaRmc;
+}
+
+void nmeaGetZda(nmeaZda_t *zda)
+{
+    *zda = nmeaZda;
+}
+
+void nmeaGetGga(nmeaGga_t *gga)
+{
+    *gga = nmeaGga;
+}
+
+void nmeaGetStat(nmeaStat_t *stat)
+{
+    *stat = nmeaStat;
+}
+
+void nmeaResetStat()
+{
+    nmeaStat = (nmeaStat_t){ 0 };
+}
@@ -2,6 +2,10 @@
 
 #include "rtc/rtc.h"
 #include "stm32f10x_conf.h"
+#include "timer.h"
+#include "event.h"
+#include "perf.h"
+#include "trace.h"
 
 
 typedef enum
@@ -14,6 +18,15 @@ typedef enum
 uint32_t rtcCounter = 0;
 rtcConfig_t rtcConfig;
 
+/* Second event posted by the interrupt, with the cycle counter at entry */
+static volatile bool rtcEvent = false;
+static volatile uint32_t rtcEventCycles;
+static volatile rtcStat_t rtcStat;
+
+/* Set when the prescaler was shortened to align the second boundary,
+   the next second interrupt restores it */
+static volatile bool rtcPrescalerRestore = false;
+
 void RTC_IRQHandler(void);
 
 void rtcConfiguration(void);
@@ -25,6 +38,9 @@ rtcConfig_t rtcGetConfiguration(void);
 
 void rtcInit()
 {
+    /* Enable PWR and BKP clocks, the configuration is kept in BKP */
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+
     rtcConfig = rtcLoadConfiguration();
 
     if (rtcConfig == RTC_CFG_INITIALIZED)
@@ -135,7 +151,7 @@ void rtcConfiguration(void)
     RTC_WaitForLastTask();
 
     /* Set RTC prescaler: set RTC period to 1sec */
-    RTC_SetPrescaler(32767); /* RTC period = RTCCLK/RTC_PR = (32.768 KHz)/(32767+1) */
+    RTC_SetPrescaler(RTC_TICKS_PER_SECOND - 1); /* RTC period = RTCCLK/RTC_PR = (32.768 KHz)/(32767+1) */
 
     /* Wait until last write operation on RTC registers has finished */
     RTC_WaitForLastTask();
@@ -146,22 +162,195 @@ uint32_t rtcGet(void)
     return rtcCounter;
 }
 
-void rtcSet(uint32_t t)
+/**************************************************************************/
+/*!
+    @brief  Takes the pending second event. Returns false if no second
+            passed since the last call, otherwise the cycle counter at
+            the second interrupt is returned in cycles.
+*/
+/**************************************************************************/
+bool rtcTakeEvent(uint32_t *cycles)
+{
+    if (!rtcEvent)
+    {
+        return false;
+    }
+
+    __disable_irq();
+    *cycles = rtcEventCycles;
+    rtcEvent = false;
+    __enable_irq();
+
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Marks the second event taken at cycles as handled (display
+            updated) and records the latency
+*/
+/**************************************************************************/
+void rtcEventHandled(uint32_t cycles)
+{
+    uint32_t latency = timer_cycles() - cycles;
+
+    rtcStat.latencyCycles = latency;
+    if (latency > rtcStat.latencyCyclesMax)
+    {
+        rtcStat.latencyCyclesMax = latency;
+    }
+    rtcStat.events++;
+}
+
+void rtcGetStat(rtcStat_t *stat)
+{
+    __disable_irq();
+    *stat = rtcStat;
+    __enable_irq();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the counter together with the prescaler divider. The
+            counter is read again after the divider, a rollover in between
+            repeats the read, so both values belong to the same second.
+*/
+/**************************************************************************/
+void rtcGetPrecise(rtcPrecise_t *p)
 {
-    /* Call the configuration method */
-    rtcConfiguration();
+    uint32_t seconds;
+    uint32_t divider;
 
-    /* Write counter */
-    RTC_SetCounter(t);
+    do
+    {
+        seconds = RTC_GetCounter();
+        divider = RTC_GetDivider();
+    }
+    while (seconds != RTC_GetCounter());
+
+    /* The divider counts down from the prescaler value to 0 */
+    p->seconds = seconds;
+    p->ticks = (RTC_TICKS_PER_SECOND - 1) - divider;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the RTC with sub second precision. Writing the counter
+            reloads the divider, so the current second is shortened by
+            loading the prescaler with the remaining ticks first. The
+            second interrupt restores the prescaler.
+
+            If the RTC already runs from the LSE only the counter (and
+            prescaler) are written, the full configuration is done for
+            the first set only.
+*/
+/**************************************************************************/
+void rtcSetPrecise(const rtcPrecise_t *p)
+{
+    uint32_t start = timer_cycles();
+    bool full = (rtcConfig != RTC_CFG_INITIALIZED);
+    bool prescaler = (p->ticks != 0) || rtcPrescalerRestore;
+
+    /* Keep the interrupt off the prescaler while it is written here */
+    rtcPrescalerRestore = false;
+
+    if (full)
+    {
+        /* Call the configuration method */
+        rtcConfiguration();
+    }
+    else
+    {
+        /* Allow access to BKP Domain */
+        PWR_BackupAccessCmd(ENABLE);
+
+        /* Wait until last write operation on RTC registers has finished */
+        RTC_WaitForLastTask();
+    }
+
+    if (prescaler)
+    {
+        /* Remaining ticks of the current second */
+        RTC_SetPrescaler((RTC_TICKS_PER_SECOND - 1) - p->ticks);
+        RTC_WaitForLastTask();
+    }
+
+    /* Write counter, this reloads the divider */
+    RTC_SetCounter(p->seconds);
 
     /* Wait until last write operation on RTC registers has finished */
     RTC_WaitForLastTask();
+    rtcPrescalerRestore = (p->ticks != 0);
 
-    /* Store that the rtc was initialized */
-    rtcStoreConfiguration(RTC_CFG_INITIALIZED);
+    if (full)
+    {
+        /* Store that the rtc was initialized */
+        rtcStoreConfiguration(RTC_CFG_INITIALIZED);
 
-    /* Reinitialize rtc */
-    rtcInit();
+        /* Reinitialize rtc */
+        rtcInit();
+    }
+    else
+    {
+        /* Deny access to BKP Domain */
+        PWR_BackupAccessCmd(DISABLE);
+    }
+
+    uint32_t cycles = timer_cycles() - start;
+    if (full)
+    {
+        rtcStat.setFullCycles = cycles;
+        if (cycles > rtcStat.setFullCyclesMax)
+        {
+            rtcStat.setFullCyclesMax = cycles;
+        }
+    }
+    else
+    {
+        rtcStat.setCycles = cycles;
+        if (cycles > rtcStat.setCyclesMax)
+        {
+            rtcStat.setCyclesMax = cycles;
+        }
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns a - b in ticks (valid for differences below 18 hours)
+*/
+/**************************************************************************/
+int32_t rtcPreciseDiff(const rtcPrecise_t *a, const rtcPrecise_t *b)
+{
+    return (int32_t)(a->seconds - b->seconds) * RTC_TICKS_PER_SECOND +
+           ((int32_t)a->ticks - (int32_t)b->ticks);
+}
+
+uint16_t rtcTicksToMillis(uint16_t ticks)
+{
+    return ((uint32_t)ticks * 1000) >> 15;
+}
+
+uint32_t rtcTicksToNanos(uint16_t ticks)
+{
+    return ((uint64_t)ticks * 1000000000) >> 15;
+}
+
+uint16_t rtcNanosToTicks(uint32_t nanos)
+{
+    if (nanos >= 1000000000)
+    {
+        return RTC_TICKS_PER_SECOND - 1;
+    }
+    return ((uint64_t)nanos << 15) / 1000000000;
+}
+
+void rtcSet(uint32_t t)
+{
+    rtcPrecise_t p;
+    p.seconds = t;
+    p.ticks = 0;
+    rtcSetPrecise(&p);
 }
 
 
@@ -176,15 +365,47 @@ void rtcSet(uint32_t t)
   */
 void RTC_IRQHandler(void)
 {
+    PERF_BEGIN(PERF_ISR_RTC);
+    uint32_t entry = timer_cycles();
+
     if (RTC_GetITStatus(RTC_IT_SEC) != RESET)
     {
         /* Clear the RTC Second interrupt */
         RTC_ClearITPendingBit(RTC_IT_SEC);
 
         rtcCounter = RTC_GetCounter();
+        TRACE(TRACE_ISR_RTC, (rtcCounter >> 16) & 0xFF, rtcCounter & 0xFFFF);
 
-        /* Wait until last write operation on RTC registers has finished */
-        RTC_WaitForLastTask();
+        /* Post the event, everything else is done in the main loop */
+        if (rtcEvent)
+        {
+            rtcStat.eventsMissed++;
+        }
+        rtcEventCycles = entry;
+        rtcEvent = true;
+        eventPost(EVENT_RTC_SECOND);
+
+        /* The shortened second of rtcSetPrecise is over. This is the only
+           register write, so only here (once after a set) the ISR has to
+           wait for it. */
+        if (rtcPrescalerRestore)
+        {
+            rtcPrescalerRestore = false;
+            PWR_BackupAccessCmd(ENABLE);
+            RTC_WaitForLastTask();
+            RTC_SetPrescaler(RTC_TICKS_PER_SECOND - 1);
+            RTC_WaitForLastTask();
+            PWR_BackupAccessCmd(DISABLE);
+        }
     }
+
+    uint32_t cycles = timer_cycles() - entry;
+    rtcStat.isrCycles = cycles;
+    if (cycles > rtcStat.isrCyclesMax)
+    {
+        rtcStat.isrCyclesMax = cycles;
+    }
+
+    PERF_END(PERF_ISR_RTC);
 }
 
@@ -39,6 +39,67 @@
 #include <string.h>
 #include "rtc/rtc_functions.h"
 
+/* Days from 1 Mar 1968 (start of a leap year cycle) to 1 Jan 1970. Within
+   the epoch range every 4th year is a leap year (2000 is one), so the
+   civil date can be handled in plain 4 year cycles of 1461 days. */
+#define RTC_EPOCH_DAYS_SINCE_CYCLE  (671)
+#define RTC_EPOCH_CYCLE_YEAR        (68)
+#define RTC_EPOCH_WEEKDAY           (RTC_WEEKDAYS_THURSDAY)
+
+
+/**************************************************************************/
+/*!
+ @brief Division free helpers for the epoch conversion
+
+ @note  The Cortex-M3 takes up to 12 cycles for a division, so the constant
+        divisions of the date conversion are done with a multiply and a
+        shift. Every reciprocal is exact for the given input range, which
+        covers all values the conversion can produce in the epoch range.
+ */
+/**************************************************************************/
+static inline uint32_t rtcDiv86400(uint32_t x) /* x <= RTC_MAX_EPOCH_TIME */
+{
+    return (uint32_t)(((uint64_t)x * 0xC22E4507ULL) >> 48);
+}
+
+static inline uint32_t rtcDiv3600(uint32_t x) /* x < 86400 */
+{
+    return (x * 37283UL) >> 27;
+}
+
+static inline uint32_t rtcDiv60(uint32_t x) /* x < 3600 */
+{
+    return (x * 17477UL) >> 20;
+}
+
+static inline uint32_t rtcDiv1461(uint32_t x) /* x < 65536 */
+{
+    return (x * 22967UL) >> 25;
+}
+
+static inline uint32_t rtcDiv365(uint32_t x) /* x < 1461 */
+{
+    return (x * 2873UL) >> 20;
+}
+
+static inline uint32_t rtcDiv153(uint32_t x) /* x < 1832 */
+{
+    return (x * 857UL) >> 17;
+}
+
+static inline uint32_t rtcDiv5(uint32_t x) /* x < 16384 */
+{
+    return (x * 3277UL) >> 14;
+}
+
+static inline uint32_t rtcMod7(uint32_t x) /* x < 43690 */
+{
+    return x - ((x * 37450UL) >> 18) * 7;
+}
+
+
+/* Days per month of a non leap year */
+static const uint8_t rtcDaysInMonth[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
 /**************************************************************************/
 /*!
@@ -66,36 +127,9 @@ static error_t rtcCheckValidDate(uint32_t year, uint8_t month, uint32_t day)
     {
         return ERROR_INVALIDPARAMETER;
     }
-    if (month == 2)
-    {
-        if (rtcIsLeapYear(year))
-        {
-            if (day > 29)
-            {
-                return ERROR_INVALIDPARAMETER;
-            }
-        }
-        else
-        {
-            if (day > 28)
-            {
-                return ERROR_INVALIDPARAMETER;
-            }
-        }
-    }
-    else if ((month == 4) || (month == 6) || (month == 9) || (month == 11))
-    {
-        if (day > 30)
-        {
-            return ERROR_INVALIDPARAMETER;
-        }
-    }
-    else
+    if ((day < 1) || (day > rtcGetDaysInMonth(year, month)))
     {
-        if (day > 31)
-        {
-            return ERROR_INVALIDPARAMETER;
-        }
+        return ERROR_INVALIDPARAMETER;
     }
     return ERROR_NONE;
 }
@@ -200,33 +234,37 @@ error_t rtcCreateTime(uint32_t year, rtcMonths_t month, uint8_t day,
 /**************************************************************************/
 error_t rtcCreateTimeFromEpoch(uint32_t epochTime, rtcTime_t *time)
 {
-    int32_t j, g, dg, c, dc, b, db, a, da, y, m, d;
+    uint32_t days, secs, cycle, doc, yoc, doy, mp, month;
 
     if (epochTime > RTC_MAX_EPOCH_TIME)
     {
         return ERROR_RTC_OUTOFEPOCHRANGE;
     }
-    j = epochTime / 86400 + 2472632;
-    g = j / 146097;
-    dg = j % 146097;
-    c = (dg / 36524 + 1) * 3 / 4;
-    dc = dg - c * 36524;
-    b = dc / 1461;
-    db = dc % 1461;
-    a = (db / 365 + 1) * 3 / 4;
-    da = db - a * 365;
-    y = g * 400 + c * 100 + b * 4 + a;
-    m = (da * 5 + 308) / 153 - 2;
-    d = da - (m + 4) * 153 / 5 + 122;
-    time->years = y - 6700 + (m + 2) / 12;
-    time->months = (m + 2) % 12 + 1;
-    time->days = d + 1;
-    time->weekdays = (j + 2) % 7;
-
-    j = epochTime % 86400;
-    time->hours = j / 3600;
-    time->minutes = (j % 3600) / 60;
-    time->seconds = j % 60;
+
+    days = rtcDiv86400(epochTime);
+    secs = epochTime - days * 86400;
+
+    /* Split the days since 1 Mar 1968 into 4 year cycles, years of the
+       cycle and days of the year. The year starts in March, so the leap
+       day is the last day of a cycle (doc == 1460). */
+    cycle = rtcDiv1461(days + RTC_EPOCH_DAYS_SINCE_CYCLE);
+    doc = days + RTC_EPOCH_DAYS_SINCE_CYCLE - cycle * 1461;
+    yoc = rtcDiv365(doc - (doc == 1460));
+    doy = doc - yoc * 365;
+
+    /* March based month and day (Mar = 0 ... Feb = 11) */
+    mp = rtcDiv153(doy * 5 + 2);
+    month = (mp < 10) ? mp + 3 : mp - 9;
+
+    time->years = RTC_EPOCH_CYCLE_YEAR + cycle * 4 + yoc + (month <= 2);
+    time->months = month;
+    time->days = doy - rtcDiv5(mp * 153 + 2) + 1;
+    time->weekdays = rtcMod7(days + RTC_EPOCH_WEEKDAY);
+
+    time->hours = rtcDiv3600(secs);
+    secs -= time->hours * 3600;
+    time->minutes = rtcDiv60(secs);
+    time->seconds = secs - time->minutes * 60;
     time->timezone = 0;
     return ERROR_NONE;
 }
@@ -260,7 +298,60 @@ error_t rtcAssignWeekday(rtcTime_t *t)
 {
     uint32_t NrOfDay;
     NrOfDay = rtcGetEpochDate(t->years, t->months, t->days);
-    t->weekdays = (NrOfDay + 3) % 7;
+    t->weekdays = rtcMod7(NrOfDay + RTC_EPOCH_WEEKDAY);
+    return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+ @brief   Advances rtcTime_t by exactly one second
+ @note    Only the fields that roll over are touched, so this is a lot
+          cheaper than a full epoch conversion. The weekday is carried
+          along with the day.
+ @param   t[in/out]:  rtcTime_t to manipulate (must be a valid time)
+ @return  errorCode
+ */
+/**************************************************************************/
+error_t rtcTickSecond(rtcTime_t *t)
+{
+    if (++t->seconds < 60)
+    {
+        return ERROR_NONE;
+    }
+    t->seconds = 0;
+    if (++t->minutes < 60)
+    {
+        return ERROR_NONE;
+    }
+    t->minutes = 0;
+    if (++t->hours < 24)
+    {
+        return ERROR_NONE;
+    }
+    t->hours = 0;
+
+    if (++t->weekdays > RTC_WEEKDAYS_SUNDAY)
+    {
+        t->weekdays = RTC_WEEKDAYS_MONDAY;
+    }
+    if (++t->days <= rtcDaysInMonth[t->months - 1])
+    {
+        return ERROR_NONE;
+    }
+    if ((t->months == RTC_MONTHS_FEBRUARY) && (t->days == 29) && rtcIsLeapYear(t->years))
+    {
+        return ERROR_NONE;
+    }
+    t->days = 1;
+    if (++t->months <= RTC_MONTHS_DECEMBER)
+    {
+        return ERROR_NONE;
+    }
+    t->months = RTC_MONTHS_JANUARY;
+    if (++t->years > RTC_MAX_EPOCH_YEAR)
+    {
+        return ERROR_RTC_OUTOFEPOCHRANGE;
+    }
     return ERROR_NONE;
 }
 
@@ -347,18 +438,28 @@ error_t rtcAddDays(rtcTime_t *t, int32_t d)
 error_t rtcAddMonths(rtcTime_t *t, int32_t m)
 {
     rtcTime_t newTime;
+    if ((m > 12 * (RTC_MAX_EPOCH_YEAR - RTC_MIN_EPOCH_YEAR + 1)) ||
+            (m < -12 * (RTC_MAX_EPOCH_YEAR - RTC_MIN_EPOCH_YEAR + 1)))
+    {
+        return ERROR_RTC_OUTOFEPOCHRANGE;
+    }
     int32_t monthCount = (int32_t) t->years * 12 + t->months;
     monthCount += m;
-    if ((monthCount < RTC_MIN_EPOCH_YEAR * 12 + 1) || (monthCount > RTC_MIN_EPOCH_YEAR
+    if ((monthCount < RTC_MIN_EPOCH_YEAR * 12 + 1) || (monthCount > RTC_MAX_EPOCH_YEAR
             * 12 + 1/*Jan 2038*/))
     {
         return ERROR_RTC_OUTOFEPOCHRANGE;
     }
 
-    /* Check if new time is in EPOCH range */
+    /* Check if new time is in EPOCH range, the day is limited to the
+       length of the new month (31 Jan + 1 month = 28/29 Feb) */
     memcpy(&newTime, t, sizeof(rtcTime_t));
     newTime.years = (monthCount - 1) / 12;
     newTime.months = (monthCount - 1) % 12 + 1;
+    if (newTime.days > rtcGetDaysInMonth(newTime.years, newTime.months))
+    {
+        newTime.days = rtcGetDaysInMonth(newTime.years, newTime.months);
+    }
     if (rtcToEpochTime(&newTime) > RTC_MAX_EPOCH_TIME)
     {
         return ERROR_RTC_OUTOFEPOCHRANGE;
@@ -379,11 +480,21 @@ error_t rtcAddMonths(rtcTime_t *t, int32_t m)
 error_t rtcAddYears(rtcTime_t *t, int32_t y)
 {
     rtcTime_t newTime;
-    /* Check if new time is in EPOCH range */
+    int32_t year = (int32_t) t->years + y;
+    if ((year < RTC_MIN_EPOCH_YEAR) || (year > RTC_MAX_EPOCH_YEAR))
+    {
+        return ERROR_RTC_OUTOFEPOCHRANGE;
+    }
+
+    /* Check if new time is in EPOCH range, 29 Feb becomes 28 Feb in non
+       leap years */
     memcpy(&newTime, t, sizeof(rtcTime_t));
-    newTime.years += y;
-    if ((newTime.years < RTC_MIN_EPOCH_YEAR) || (newTime.years > RTC_MAX_EPOCH_YEAR)
-            || (rtcToEpochTime(&newTime) > RTC_MAX_EPOCH_TIME))
+    newTime.years = year;
+    if (newTime.days > rtcGetDaysInMonth(newTime.years, newTime.months))
+    {
+        newTime.days = rtcGetDaysInMonth(newTime.years, newTime.months);
+    }
+    if (rtcToEpochTime(&newTime) > RTC_MAX_EPOCH_TIME)
     {
         return ERROR_RTC_OUTOFEPOCHRANGE;
     }
@@ -436,7 +547,7 @@ error_t rtcGetWeekday(uint32_t year, rtcMonths_t month, uint8_t day,
         return errorCode;
     }
     NrOfDay = rtcGetEpochDate(year, month, day);
-    *weekDay = (NrOfDay + 3) % 7;
+    *weekDay = rtcMod7(NrOfDay + RTC_EPOCH_WEEKDAY);
 
     return ERROR_NONE;
 }
@@ -451,8 +562,9 @@ error_t rtcGetWeekday(uint32_t year, rtcMonths_t month, uint8_t day,
 /**************************************************************************/
 error_t rtcGetWeekNumber(rtcTime_t *t, uint8_t *weekNumber)
 {
+    /* Week 2 starts with the first Monday after 1 January */
     uint32_t NrOfDay = rtcGetEpochDate(t->years, 1, 1);
-    uint8_t nextMondayDay = 8 - NrOfDay;
+    uint8_t nextMondayDay = 8 - rtcMod7(NrOfDay + RTC_EPOCH_WEEKDAY);
 
     if ((t->months == 1) && (t->days < nextMondayDay))
     {
@@ -486,6 +598,27 @@ int32_t rtcGetDaysInYear(int32_t year)
     return 365;
 }
 
+/**************************************************************************/
+/*!
+ @brief   Number of days in the supplied month
+ @param   year[in]:   import year of the month
+          month[in]:  import month to take number of days
+ @return  28 .. 31 days, 0 for an invalid month
+ */
+/**************************************************************************/
+uint8_t rtcGetDaysInMonth(uint32_t year, rtcMonths_t month)
+{
+    if ((month > RTC_MONTHS_DECEMBER) || (month < RTC_MONTHS_JANUARY))
+    {
+        return 0;
+    }
+    if ((month == RTC_MONTHS_FEBRUARY) && rtcIsLeapYear(year))
+    {
+        return 29;
+    }
+    return rtcDaysInMonth[month - 1];
+}
+
 /**************************************************************************/
 /*!
  @brief   Calculate number of days from Jan 1 1970
@@ -507,10 +640,21 @@ uint32_t rtcGetEpochDate(uint32_t year, rtcMonths_t month, uint8_t day)
     }
     /* month must be cast to uint8_t or this fails on some platforms */
     uint8_t m = (uint8_t)(month & 0xFF);
-    return (1461 * (year + 6700 + (m - 14) / 12)) / 4 + (367 *
-            (m - 2 - 12 * ((m - 14) / 12))) / 12 -
-           (3 * ((year + 6800 + (m - 14) / 12) / 100)) / 4 +
-           day - 2472663;
+
+    /* Count from 1 Mar 1968, January and February belong to the previous
+       year of the cycle */
+    if (m <= RTC_MONTHS_FEBRUARY)
+    {
+        year--;
+        m += 9;
+    }
+    else
+    {
+        m -= 3;
+    }
+    year -= RTC_EPOCH_CYCLE_YEAR;
+    return (year >> 2) * 1461 + (year & 3) * 365 + rtcDiv5(m * 153 + 2) +
+           day - 1 - RTC_EPOCH_DAYS_SINCE_CYCLE;
 }
 
 /**************************************************************************/
@@ -1,15 +1,93 @@
 #include "platform_config.h"
 
 #include "rtc/tz.h"
+#include "perf.h"
+#include "trace.h"
 #include <string.h>
 
-static rtcTime_t _tzDSTStartUTC;
-static rtcTime_t _tzSTDStartUTC;
-static rtcTime_t _tzDSTStartLocal;
-static rtcTime_t _tzSTDStartLocal;
+#ifdef CFG_TZ_TABLE
+#define TZ_TABLE_YEARS  (RTC_MAX_EPOCH_YEAR - RTC_MIN_EPOCH_YEAR + 1)
+#endif
 
-static tzRule_t _tzDST;
-static tzRule_t _tzSTD;
+/* One time zone: its rules and the transition instants of the cached year
+   as epoch seconds. The cache is valid for epochs in [yearStart, yearEnd),
+   yearEnd = 0 marks it invalid. Both transitions 0 means the zone has no
+   DST. */
+typedef struct tzZone_st
+{
+    tzRule_t std;
+    tzRule_t dst;
+    uint32_t yearStart;
+    uint32_t yearEnd;
+    uint32_t dstStartUTC;
+    uint32_t stdStartUTC;
+    uint32_t dstStartLocal;
+    uint32_t stdStartLocal;
+#ifdef CFG_TZ_TABLE
+    /* UTC transition instants for every year of the epoch range, generated
+       once whenever the rules change: [0] = DST start, [1] = STD start */
+    uint32_t table[TZ_TABLE_YEARS][2];
+    bool tableValid;
+#endif
+} tzZone_t;
+
+static tzZone_t _tzZones[CFG_TZ_ZONES];
+
+static void tzZoneChanged( tzZone_t *z );
+
+
+/**************************************************************************/
+/*!
+ @brief  Returns the EEPROM address of a rule of a zone. Zone 0 keeps the
+         addresses of the single zone firmware.
+ */
+/**************************************************************************/
+static uint16_t tzEEPROMAddress( uint8_t zone, bool isDst )
+{
+    if (zone == 0)
+    {
+        return isDst ? CFG_EEPROM_TZ_DST : CFG_EEPROM_TZ_STD;
+    }
+    return CFG_EEPROM_TZ_ZONE(zone) + (isDst ? 8 : 0);
+}
+
+static void tzStoreRule( uint16_t address, tzRule_t *r )
+{
+    /* Convert */
+    uint16_t offset = r->offset;
+    uint16_t hourdow = (r->hour << 8) + r->dow;
+    uint16_t weekmonth = (r->week << 8) + r->month;
+
+    /* Allow access to FLASH Domain */
+    FLASH_Unlock();
+
+    /* Write to the FLASH Domain */
+    TRACE(TRACE_CONFIG_WRITE, 3, address);
+    EE_WriteVariable(address+0, offset);
+    EE_WriteVariable(address+1, hourdow);
+    EE_WriteVariable(address+2, weekmonth);
+
+    /* Deny access to FLASH Domain */
+    FLASH_Lock();
+}
+
+static void tzLoadRule( uint16_t address, tzRule_t *r )
+{
+    /* Variables never written read as a rule without DST and offset */
+    uint16_t offset = 0;
+    uint16_t hourdow = 0;
+    uint16_t weekmonth = 0;
+
+    EE_ReadVariable(address+0, &offset);
+    EE_ReadVariable(address+1, &hourdow);
+    EE_ReadVariable(address+2, &weekmonth);
+
+    r->offset = offset;
+    r->hour = hourdow >> 8;
+    r->dow = hourdow & 0xFF;
+    r->week = weekmonth >> 8;
+    r->month = weekmonth & 0xFF;
+}
 
 
 /**************************************************************************/
@@ -19,100 +97,133 @@ static tzRule_t _tzSTD;
 /**************************************************************************/
 void tzInit( void )
 {
-    tzLoadSTD(&_tzSTD);
-    tzLoadDST(&_tzDST);
+    for (uint8_t i = 0; i < CFG_TZ_ZONES; i++)
+    {
+        tzZoneLoadSTD( i, &_tzZones[i].std );
+        tzZoneLoadDST( i, &_tzZones[i].dst );
+        tzZoneChanged( &_tzZones[i] );
+    }
 }
 
 void   tzSetSTD( tzRule_t *std )
 {
-    _tzSTD = *std;
+    tzZoneSetSTD( 0, std );
 }
 
 void   tzGetSTD( tzRule_t *std )
 {
-    *std = _tzSTD;
+    tzZoneGetSTD( 0, std );
 }
 
 void tzStoreSTD( tzRule_t *std )
 {
-    /* Convert */
-    uint16_t offset = std->offset;
-    uint16_t hourdow = (std->hour << 8) + std->dow;
-    uint16_t weekmonth = (std->week << 8) + std->month;
-
-    /* Allow access to FLASH Domain */
-    FLASH_Unlock();
-
-    /* Write to the FLASH Domain */
-    EE_WriteVariable(CFG_EEPROM_TZ_STD+0, offset);
-    EE_WriteVariable(CFG_EEPROM_TZ_STD+1, hourdow);
-    EE_WriteVariable(CFG_EEPROM_TZ_STD+2, weekmonth);
-
-    /* Deny access to FLASH Domain */
-    FLASH_Lock();
+    tzZoneStoreSTD( 0, std );
 }
 
 void tzLoadSTD( tzRule_t *std )
 {
-    uint16_t offset;
-    uint16_t hourdow;
-    uint16_t weekmonth;
-
-    EE_ReadVariable(CFG_EEPROM_TZ_STD+0, &offset);
-    EE_ReadVariable(CFG_EEPROM_TZ_STD+1, &hourdow);
-    EE_ReadVariable(CFG_EEPROM_TZ_STD+2, &weekmonth);
-
-    std->offset = offset;
-    std->hour = hourdow >> 8;
-    std->dow = hourdow & 0xFF;
-    std->week = weekmonth >> 8;
-    std->month = weekmonth & 0xFF;
+    tzZoneLoadSTD( 0, std );
 }
 
 void   tzSetDST( tzRule_t *dst )
 {
-    _tzDST = *dst;
+    tzZoneSetDST( 0, dst );
 }
 
 void   tzGetDST( tzRule_t *dst )
 {
-    *dst = _tzDST;
+    tzZoneGetDST( 0, dst );
 }
 
 void tzStoreDST( tzRule_t *dst )
 {
-	/* Convert */
-	uint16_t offset = dst->offset;
-	uint16_t hourdow = (dst->hour << 8) + dst->dow;
-	uint16_t weekmonth = (dst->week << 8) + dst->month;
+    tzZoneStoreDST( 0, dst );
+}
 
-	/* Allow access to FLASH Domain */
-	FLASH_Unlock();
+void tzLoadDST( tzRule_t *dst )
+{
+    tzZoneLoadDST( 0, dst );
+}
 
-	/* Write to the FLASH Domain */
-	EE_WriteVariable(CFG_EEPROM_TZ_DST+0, offset);
-	EE_WriteVariable(CFG_EEPROM_TZ_DST+1, hourdow);
-	EE_WriteVariable(CFG_EEPROM_TZ_DST+2, weekmonth);
+/**************************************************************************/
+/*!
+ @brief  Sets / gets / stores / loads the rules of a zone
+ @param  zone[in]:      zone index (0 .. CFG_TZ_ZONES-1)
+         std/dst[in]:   tzRule_t reference
+ */
+/**************************************************************************/
+void   tzZoneSetSTD( uint8_t zone, tzRule_t *std )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    _tzZones[zone].std = *std;
+    tzZoneChanged( &_tzZones[zone] );
+}
 
-	/* Deny access to FLASH Domain */
-	FLASH_Lock();
+void   tzZoneGetSTD( uint8_t zone, tzRule_t *std )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    *std = _tzZones[zone].std;
 }
 
-void tzLoadDST( tzRule_t *dst )
+void   tzZoneStoreSTD( uint8_t zone, tzRule_t *std )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    tzStoreRule( tzEEPROMAddress( zone, false ), std );
+}
+
+void   tzZoneLoadSTD( uint8_t zone, tzRule_t *std )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    tzLoadRule( tzEEPROMAddress( zone, false ), std );
+}
+
+void   tzZoneSetDST( uint8_t zone, tzRule_t *dst )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    _tzZones[zone].dst = *dst;
+    tzZoneChanged( &_tzZones[zone] );
+}
+
+void   tzZoneGetDST( uint8_t zone, tzRule_t *dst )
 {
-	uint16_t offset;
-	uint16_t hourdow;
-	uint16_t weekmonth;
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    *dst = _tzZones[zone].dst;
+}
 
-	EE_ReadVariable(CFG_EEPROM_TZ_DST+0, &offset);
-	EE_ReadVariable(CFG_EEPROM_TZ_DST+1, &hourdow);
-	EE_ReadVariable(CFG_EEPROM_TZ_DST+2, &weekmonth);
+void   tzZoneStoreDST( uint8_t zone, tzRule_t *dst )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    tzStoreRule( tzEEPROMAddress( zone, true ), dst );
+}
 
-	dst->offset = offset;
-	dst->hour = hourdow >> 8;
-	dst->dow = hourdow & 0xFF;
-	dst->week = weekmonth >> 8;
-	dst->month = weekmonth & 0xFF;
+void   tzZoneLoadDST( uint8_t zone, tzRule_t *dst )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return;
+    }
+    tzLoadRule( tzEEPROMAddress( zone, true ), dst );
 }
 
 /**************************************************************************/
@@ -134,7 +245,7 @@ void   tzCreateRule( uint16_t offset, uint8_t hour, rtcWeekdays_t dow,
     tzRule_t newRule;
 
     /* Basic validation */
-    if ((hour > 23) || (dow > 6) || (week > 4) || (month > 12) || (month < 1))
+    if ((hour > 23) || (dow > 6) || (week > 4) || (month > 12))
     {
         return;
     }
@@ -159,49 +270,160 @@ void   tzCreateRule( uint16_t offset, uint8_t hour, rtcWeekdays_t dow,
 /**************************************************************************/
 void   tzRuleToTime( tzRule_t *r, uint16_t year, rtcTime_t *t )
 {
-    // TEST THIS THING TO DEATH!!!!
+    rtcWeekdays_t weekday;
+    uint8_t tDay;
+
+    if (year >= 1900)
+    {
+        year -= 1900;
+    }
+
+    if(r->week == TZ_WEEK_LAST)
+    {
+        /* Go back from the last day of the month to the weekday */
+        uint8_t lastDay = rtcGetDaysInMonth(year, r->month);
+        rtcGetWeekday(year, r->month, lastDay, &weekday);
+        tDay = lastDay - (weekday - r->dow + 7) % 7;
+    }
+    else
+    {
+        /*
+        Example:
+            Second sunday in march 2015
+            tDay = 1 + 7 * (week - 1) + (rule->dow - weekday + 7) % 7;
+            tDay = 1 + 7 * 1 + (6 - 6 + 7) % 7
+            -> 8
+        */
+        rtcGetWeekday(year, r->month, 1, &weekday);
+        tDay = 1 + 7 * (r->week - 1) + (r->dow - weekday + 7) % 7;
+    }
+
+    /* Filled directly, the transitions of 2038 are past the epoch range
+       rtcCreateTime would refuse but still order correctly as epochs */
+    rtcTime_t newTime;
+    newTime.years = year;
+    newTime.months = r->month;
+    newTime.days = tDay;
+    newTime.weekdays = r->dow;
+    newTime.hours = r->hour;
+    newTime.minutes = 0;
+    newTime.seconds = 0;
+    newTime.timezone = 0;
+
+    memcpy(t, &newTime, sizeof(rtcTime_t));
+}
+
+/**************************************************************************/
+/*!
+ @brief  Checks if both rules of a zone describe a transition
+ */
+/**************************************************************************/
+static inline bool tzHasDST( tzZone_t *z )
+{
+    return (z->dst.month >= RTC_MONTHS_JANUARY) && (z->dst.month <= RTC_MONTHS_DECEMBER) &&
+           (z->std.month >= RTC_MONTHS_JANUARY) && (z->std.month <= RTC_MONTHS_DECEMBER);
+}
+
+/**************************************************************************/
+/*!
+ @brief  Calculates the UTC instants where DST and STD start in a year
+ @param  z[in]:          zone considered
+         year[in]:       1900-based year considered
+         dstStart[out]:  seconds since 1970 (UTC) where DST starts
+         stdStart[out]:  seconds since 1970 (UTC) where STD starts
+ */
+/**************************************************************************/
+static void tzCalcTransitions( tzZone_t *z, uint16_t year, uint32_t *dstStart, uint32_t *stdStart )
+{
+    rtcTime_t t;
+
+    if (!tzHasDST( z ))
+    {
+        *dstStart = 0;
+        *stdStart = 0;
+        return;
+    }
 
-    uint8_t tYear = year;
-    uint8_t tMonth = r->month;
-    uint8_t tWeek = r->week;
+    /* The rule hours are given in the local time that is left */
+    tzRuleToTime( &z->dst, year, &t );
+    *dstStart = rtcToEpochTime( &t ) - (int32_t)z->std.offset * 60;
 
-    if(tWeek == TZ_WEEK_LAST)
+    tzRuleToTime( &z->std, year, &t );
+    *stdStart = rtcToEpochTime( &t ) - (int32_t)z->dst.offset * 60;
+}
+
+/**************************************************************************/
+/*!
+ @brief  Invalidates the cache of a zone after its rules changed. With
+         CFG_TZ_TABLE the transition table is invalidated as well and
+         rebuilt by the next conversion, so setting both rules builds it
+         once, from the pair of new rules.
+ */
+/**************************************************************************/
+static void tzZoneChanged( tzZone_t *z )
+{
+    z->yearEnd = 0;
+
+#ifdef CFG_TZ_TABLE
+    z->tableValid = false;
+#endif
+}
+
+/**************************************************************************/
+/*!
+ @brief  Fills the transition cache of a zone for a given year
+ @param  z[in]:          zone considered
+         year[in]:       year considered
+ */
+/**************************************************************************/
+static void tzZoneCalcStartTimes( tzZone_t *z, uint16_t year )
+{
+    if (year >= 1900)
+    {
+        year -= 1900;
+    }
+
+#ifdef CFG_TZ_TABLE
+    if (!z->tableValid)
     {
-        if(tMonth == RTC_MONTHS_DECEMBER)
+        for (uint16_t i = 0; i < TZ_TABLE_YEARS; i++)
         {
-            tMonth = RTC_MONTHS_JANUARY;
-            year++;
+            tzCalcTransitions( z, RTC_MIN_EPOCH_YEAR + i, &z->table[i][0], &z->table[i][1] );
         }
-        tMonth = tMonth + 1;
-        tWeek = TZ_WEEK_FIRST;
+        z->tableValid = true;
     }
 
-    rtcWeekdays_t weekday;
-    rtcGetWeekday(tYear, tMonth, 1, &weekday);
-    uint8_t tDay = 1 + 7 * (tWeek - 1) + (r->dow - weekday + 7) % 7;
-
-    /*
-    Example:
-        Last sunday in march 2015
-        tDay = 1 + 7 * (week - 1) + (rule->dow - weekday + 7) % 7;
-        tDay = 1 + 7 * 0 + (6 - 2 + 7) % 7
-        -> 5
-    */
-
-    uint8_t tHour = r->hour;
-    uint8_t tMinute = 0;
-    uint8_t tSecond = 0;
-    uint8_t tTimezone = 0; //what is that anyway?
-
-    rtcTime_t newTime;
-    rtcCreateTime( tYear, tMonth, tDay, tHour, tMinute, tSecond, tTimezone, &newTime );
+    if ((year >= RTC_MIN_EPOCH_YEAR) && (year <= RTC_MAX_EPOCH_YEAR))
+    {
+        z->dstStartUTC = z->table[year - RTC_MIN_EPOCH_YEAR][0];
+        z->stdStartUTC = z->table[year - RTC_MIN_EPOCH_YEAR][1];
+    }
+    else
+#endif
+    {
+        tzCalcTransitions( z, year, &z->dstStartUTC, &z->stdStartUTC );
+    }
 
-    if(r->week == TZ_WEEK_LAST)
+    if (tzHasDST( z ))
     {
-        rtcAddDays( &newTime, -7 );
+        z->dstStartLocal = z->dstStartUTC + (int32_t)z->std.offset * 60;
+        z->stdStartLocal = z->stdStartUTC + (int32_t)z->dst.offset * 60;
+    }
+    else
+    {
+        z->dstStartLocal = 0;
+        z->stdStartLocal = 0;
     }
 
-    memcpy(t, &newTime, sizeof(rtcTime_t));
+    z->yearStart = rtcGetEpochDate( year, RTC_MONTHS_JANUARY, 1 ) * 86400;
+    if (year < RTC_MAX_EPOCH_YEAR)
+    {
+        z->yearEnd = rtcGetEpochDate( year + 1, RTC_MONTHS_JANUARY, 1 ) * 86400;
+    }
+    else
+    {
+        z->yearEnd = RTC_MAX_EPOCH_TIME + 1;
+    }
 }
 
 /**************************************************************************/
@@ -213,105 +435,279 @@ void   tzRuleToTime( tzRule_t *r, uint16_t year, rtcTime_t *t )
 /**************************************************************************/
 void   tzCalcStartTimes( uint16_t year )
 {
-    tzRuleToTime( &_tzDST, year, &_tzDSTStartLocal );
-    _tzDSTStartUTC = _tzDSTStartLocal;
-    rtcAddMinutes( &_tzDSTStartUTC, -(_tzSTD.offset) );
-
-    tzRuleToTime( &_tzSTD, year, &_tzSTDStartLocal );
-    _tzSTDStartUTC = _tzSTDStartLocal;
-    rtcAddMinutes( &_tzSTDStartUTC, -(_tzDST.offset) );
+    tzZoneCalcStartTimes( &_tzZones[0], year );
 }
 
 /**************************************************************************/
 /*!
- @brief  Checks if utc is in DST
- @param  utc[in]:       rtcTime_t utc time as input
- @return TZ_DST or TZ_NON_DST
+ @brief  Makes sure the cached transitions of a zone belong to the year
+         of epoch
  */
 /**************************************************************************/
-bool   tzUTCIsDST( rtcTime_t *utc )
+static inline void tzCheckYear( tzZone_t *z, uint32_t epoch )
 {
-    if( utc->years != _tzDSTStartUTC.years )
+    if ((epoch < z->yearStart) || (epoch >= z->yearEnd))
     {
-        tzCalcStartTimes(utc->years);
+        rtcTime_t t;
+        rtcCreateTimeFromEpoch( epoch, &t );
+        tzZoneCalcStartTimes( z, t.years );
     }
+}
 
-    int32_t diff;
-    rtcGetDifference( &_tzSTDStartUTC, &_tzDSTStartUTC, &diff );
-
-    int32_t diff1, diff2;
-    rtcGetDifference( utc, &_tzDSTStartUTC, &diff1 );
-    rtcGetDifference( utc, &_tzSTDStartUTC, &diff2 );
-
-    if( diff > 0 )
+/**************************************************************************/
+/*!
+ @brief  Checks if epoch lies in the DST period given by the two
+         transition instants of its year. Handles rules where DST spans
+         the turn of the year (southern hemisphere). Equal instants mean
+         there is no DST.
+ */
+/**************************************************************************/
+static inline bool tzIsDST( uint32_t epoch, uint32_t dstStart, uint32_t stdStart )
+{
+    if (stdStart >= dstStart)
     {
-        return ( diff1 >= 0 && diff2 < 0 );
+        return ( epoch >= dstStart && epoch < stdStart );
     }
     else
     {
-        return !( diff1 >= 0 && diff2 < 0 );
+        return !( epoch >= stdStart && epoch < dstStart );
     }
 }
 
 /**************************************************************************/
 /*!
- @brief  Checks if local is in DST
- @param  local[in]:       rtcTime_t local time as input
- @return TZ_DST or TZ_NON_DST
+ @brief  Adds an offset in minutes to an epoch, saturating at both ends
+         of the epoch range
  */
 /**************************************************************************/
-bool   tzLocalIsDST( rtcTime_t *local )
+static inline uint32_t tzApplyOffset( uint32_t epoch, int32_t minutes )
 {
-    if( local->years != _tzDSTStartLocal.years )
+    int64_t e = (int64_t)epoch + (int64_t)minutes * 60;
+    if (e < 0)
     {
-        tzCalcStartTimes(local->years);
+        return 0;
     }
+    return (e > (int64_t)RTC_MAX_EPOCH_TIME) ? RTC_MAX_EPOCH_TIME : (uint32_t)e;
+}
 
-    int32_t diff;
-    rtcGetDifference( &_tzSTDStartLocal, &_tzDSTStartLocal, &diff );
-
-    int32_t diff1, diff2;
-    rtcGetDifference( local, &_tzDSTStartLocal, &diff1 );
-    rtcGetDifference( local, &_tzSTDStartLocal, &diff2 );
+/**************************************************************************/
+/*!
+ @brief  Converts an UTC epoch with the already checked cache of a zone
+ */
+/**************************************************************************/
+static inline uint32_t tzZoneToLocal( tzZone_t *z, uint32_t utc )
+{
+    if( tzIsDST( utc, z->dstStartUTC, z->stdStartUTC ) )
+    {
+        return tzApplyOffset( utc, z->dst.offset );
+    }
+    return tzApplyOffset( utc, z->std.offset );
+}
 
+/**************************************************************************/
+/*!
+ @brief  Checks if an UTC epoch is in DST in a zone
+ @param  zone[in]:      zone index (0 .. CFG_TZ_ZONES-1)
+         utc[in]:       seconds since 1970 (UTC)
+ @return TZ_DST or TZ_NON_DST, TZ_NON_DST for an invalid zone
+ */
+/**************************************************************************/
+bool   tzZoneEpochUTCIsDST( uint8_t zone, uint32_t utc )
+{
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return false;
+    }
+    tzZone_t *z = &_tzZones[zone];
+    tzCheckYear( z, utc );
+    return tzIsDST( utc, z->dstStartUTC, z->stdStartUTC );
+}
 
-    if( diff > 0 )
+/**************************************************************************/
+/*!
+ @brief  Checks if a local epoch is in DST in a zone
+ @param  zone[in]:      zone index (0 .. CFG_TZ_ZONES-1)
+         local[in]:     seconds since 1970 (local time)
+ @return TZ_DST or TZ_NON_DST, TZ_NON_DST for an invalid zone
+ */
+/**************************************************************************/
+bool   tzZoneEpochLocalIsDST( uint8_t zone, uint32_t local )
+{
+    if (zone >= CFG_TZ_ZONES)
     {
-        return ( diff1 >= 0 && diff2 < 0 );
+        return false;
     }
-    else
+    tzZone_t *z = &_tzZones[zone];
+    tzCheckYear( z, local );
+    return tzIsDST( local, z->dstStartLocal, z->stdStartLocal );
+}
+
+/**************************************************************************/
+/*!
+ @brief  Convert an UTC epoch to the local epoch of a zone
+ @param  zone[in]:      zone index (0 .. CFG_TZ_ZONES-1)
+         utc[in]:       seconds since 1970 (UTC)
+ @return seconds since 1970 (local time), utc for an invalid zone
+ */
+/**************************************************************************/
+uint32_t tzZoneEpochUTCToLocal( uint8_t zone, uint32_t utc )
+{
+    if (zone >= CFG_TZ_ZONES)
     {
-        return !( diff1 >= 0 && diff2 < 0  );
+        return utc;
     }
+    PERF_BEGIN(PERF_TZ_TO_LOCAL);
+    tzZone_t *z = &_tzZones[zone];
+    tzCheckYear( z, utc );
+    uint32_t local = tzZoneToLocal( z, utc );
+    PERF_END(PERF_TZ_TO_LOCAL);
+    return local;
 }
 
 /**************************************************************************/
 /*!
- @brief  Convert UTC to Local time
- @param  utc[in]:       rtcTime_t utc time as input
-         local[out]:    rtcTime_t local time as output
- @return errorCode
+ @brief  Convert a local epoch of a zone to UTC epoch
+ @param  zone[in]:      zone index (0 .. CFG_TZ_ZONES-1)
+         local[in]:     seconds since 1970 (local time)
+ @return seconds since 1970 (UTC), local for an invalid zone
  */
 /**************************************************************************/
-void   tzUTCToLocal( rtcTime_t *utc, rtcTime_t *local )
+uint32_t tzZoneEpochLocalToUTC( uint8_t zone, uint32_t local )
 {
-    if( utc->years != _tzDSTStartUTC.years )
+    if (zone >= CFG_TZ_ZONES)
+    {
+        return local;
+    }
+    tzZone_t *z = &_tzZones[zone];
+    tzCheckYear( z, local );
+    if( tzIsDST( local, z->dstStartLocal, z->stdStartLocal ) )
     {
-        tzCalcStartTimes(utc->years);
+        return tzApplyOffset( local, -z->dst.offset );
     }
+    return tzApplyOffset( local, -z->std.offset );
+}
 
-    if( tzUTCIsDST( utc ) )
+/**************************************************************************/
+/*!
+ @brief  Convert an UTC epoch to the local epochs of the first count
+         zones. The civil date of utc is decoded at most once for all
+         zones whose cache misses.
+ @param  utc[in]:       seconds since 1970 (UTC)
+         local[out]:    seconds since 1970 (local time), one per zone
+         count[in]:     number of zones to convert (max CFG_TZ_ZONES)
+ */
+/**************************************************************************/
+void   tzZonesEpochUTCToLocal( uint32_t utc, uint32_t *local, uint8_t count )
+{
+    uint16_t year = 0;
+
+    if (count > CFG_TZ_ZONES)
     {
-        *local = *utc;
-        rtcAddMinutes( local, _tzDST.offset );
+        count = CFG_TZ_ZONES;
     }
-    else
+
+    for (uint8_t i = 0; i < count; i++)
     {
-        *local = *utc;
-        rtcAddMinutes( local, _tzSTD.offset );
+        tzZone_t *z = &_tzZones[i];
+        if ((utc < z->yearStart) || (utc >= z->yearEnd))
+        {
+            if (year == 0)
+            {
+                rtcTime_t t;
+                rtcCreateTimeFromEpoch( utc, &t );
+                year = t.years;
+            }
+            tzZoneCalcStartTimes( z, year );
+        }
+        local[i] = tzZoneToLocal( z, utc );
     }
 }
 
+/**************************************************************************/
+/*!
+ @brief  Checks if an UTC epoch is in DST
+ @param  utc[in]:       seconds since 1970 (UTC)
+ @return TZ_DST or TZ_NON_DST
+ */
+/**************************************************************************/
+bool   tzEpochUTCIsDST( uint32_t utc )
+{
+    return tzZoneEpochUTCIsDST( 0, utc );
+}
+
+/**************************************************************************/
+/*!
+ @brief  Checks if a local epoch is in DST
+ @param  local[in]:     seconds since 1970 (local time)
+ @return TZ_DST or TZ_NON_DST
+ */
+/**************************************************************************/
+bool   tzEpochLocalIsDST( uint32_t local )
+{
+    return tzZoneEpochLocalIsDST( 0, local );
+}
+
+/**************************************************************************/
+/*!
+ @brief  Convert an UTC epoch to local epoch
+ @param  utc[in]:       seconds since 1970 (UTC)
+ @return seconds since 1970 (local time)
+ */
+/**************************************************************************/
+uint32_t tzEpochUTCToLocal( uint32_t utc )
+{
+    return tzZoneEpochUTCToLocal( 0, utc );
+}
+
+/**************************************************************************/
+/*!
+ @brief  Convert a local epoch to UTC epoch
+ @param  local[in]:     seconds since 1970 (local time)
+ @return seconds since 1970 (UTC)
+ */
+/**************************************************************************/
+uint32_t tzEpochLocalToUTC( uint32_t local )
+{
+    return tzZoneEpochLocalToUTC( 0, local );
+}
+
+/**************************************************************************/
+/*!
+ @brief  Checks if utc is in DST
+ @param  utc[in]:       rtcTime_t utc time as input
+ @return TZ_DST or TZ_NON_DST
+ */
+/**************************************************************************/
+bool   tzUTCIsDST( rtcTime_t *utc )
+{
+    return tzEpochUTCIsDST( rtcToEpochTime( utc ) );
+}
+
+/**************************************************************************/
+/*!
+ @brief  Checks if local is in DST
+ @param  local[in]:       rtcTime_t local time as input
+ @return TZ_DST or TZ_NON_DST
+ */
+/**************************************************************************/
+bool   tzLocalIsDST( rtcTime_t *local )
+{
+    return tzEpochLocalIsDST( rtcToEpochTime( local ) );
+}
+
+/**************************************************************************/
+/*!
+ @brief  Convert UTC to Local time
+ @param  utc[in]:       rtcTime_t utc time as input
+         local[out]:    rtcTime_t local time as output
+ @return errorCode
+ */
+/**************************************************************************/
+void   tzUTCToLocal( rtcTime_t *utc, rtcTime_t *local )
+{
+    rtcCreateTimeFromEpoch( tzEpochUTCToLocal( rtcToEpochTime( utc ) ), local );
+}
+
 /**************************************************************************/
 /*!
  @brief  Convert Local to UTC time
@@ -322,19 +718,5 @@ void   tzUTCToLocal( rtcTime_t *utc, rtcTime_t *local )
 /**************************************************************************/
 void   tzLocalToUTC( rtcTime_t *local, rtcTime_t *utc )
 {
-    if( local->years != _tzDSTStartLocal.years )
-    {
-        tzCalcStartTimes(utc->years);
-    }
-
-    if( tzLocalIsDST( local ) )
-    {
-        *utc = *local;
-        rtcAddMinutes( utc, -_tzDST.offset );
-    }
-    else
-    {
-        *utc = *local;
-        rtcAddMinutes( utc, -_tzSTD.offset );
-    }
+    rtcCreateTimeFromEpoch( tzEpochLocalToUTC( rtcToEpochTime( local ) ), utc );
 }
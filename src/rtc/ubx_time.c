@@ -0,0 +1,201 @@
+/**************************************************************************/
+/*!
+    @file     ubx_time.c
+
+    @brief    Decodes the UBX timing messages of a u-blox receiver,
+              NAV-TIMEUTC for the second and TIM-TP for the next pulse.
+              The framer table takes only them and the acknowledgements,
+              everything else is skipped at the header without storing
+              the payload. The fields are read straight from the payload,
+              little endian, with no text to parse.
+*/
+/**************************************************************************/
+
+#include "rtc/ubx_time.h"
+
+#include <stddef.h>
+
+static const ubxMsg_t ubxTimeMsgs[] =
+{
+    { UBX_NAV_TIMEUTC, UBX_NAV_TIMEUTC_LENGTH },
+    { UBX_TIM_TP,      UBX_TIM_TP_LENGTH      },
+    { UBX_ACK_ACK,     UBX_ACK_LENGTH         },
+    { UBX_ACK_NAK,     UBX_ACK_LENGTH         }
+};
+
+static ubxFramer_t ubxTimeFramer;
+static uint8_t ubxTimePayload[UBX_NAV_TIMEUTC_LENGTH];
+
+static ubxTimeUtc_t ubxTimeUtc;
+static ubxTimeTp_t ubxTimeTp;
+static ubxTimeAck_t ubxTimeAck;
+
+static uint16_t ubxU16(const uint8_t *p);
+static uint32_t ubxU32(const uint8_t *p);
+
+
+/**************************************************************************/
+/*!
+    @brief  Resets the decoder, a frame being received is lost
+*/
+/**************************************************************************/
+void ubxTimeInit()
+{
+    ubxFramerInit(&ubxTimeFramer, ubxTimePayload, sizeof(ubxTimePayload),
+                  ubxTimeMsgs, sizeof(ubxTimeMsgs) / sizeof(ubxTimeMsgs[0]));
+
+    ubxTimeUtc = (ubxTimeUtc_t){ 0 };
+    ubxTimeTp = (ubxTimeTp_t){ 0 };
+    ubxTimeAck = (ubxTimeAck_t){ 0 };
+}
+
+/**************************************************************************/
+/*!
+    @brief  Drops a frame being received, the statistics stay
+*/
+/**************************************************************************/
+void ubxTimeReset()
+{
+    ubxFramerReset(&ubxTimeFramer);
+}
+
+/**************************************************************************/
+/*!
+    @brief  No frame being received past the sync bytes, bytes in between
+            belong to other protocols
+*/
+/**************************************************************************/
+bool ubxTimeIdle()
+{
+    return ubxFramerIdle(&ubxTimeFramer);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Handles a single incoming byte
+
+    @return The message completed with a correct checksum
+*/
+/**************************************************************************/
+ubxTimeMsg_t ubxTimeRx(uint8_t c)
+{
+    if (ubxFramerRx(&ubxTimeFramer, c) != UBX_RX_FRAME)
+    {
+        return UBX_TIME_NONE;
+    }
+
+    const uint8_t *p = ubxTimePayload;
+    switch (ubxTimeFramer.msgId)
+    {
+    case UBX_NAV_TIMEUTC:
+        ubxTimeUtc.iTow = ubxU32(&p[0]);
+        ubxTimeUtc.tAcc = ubxU32(&p[4]);
+        ubxTimeUtc.nano = (int32_t)ubxU32(&p[8]);
+        ubxTimeUtc.year = ubxU16(&p[12]);
+        ubxTimeUtc.month = p[14];
+        ubxTimeUtc.day = p[15];
+        ubxTimeUtc.hour = p[16];
+        ubxTimeUtc.minute = p[17];
+        ubxTimeUtc.second = p[18];
+        ubxTimeUtc.valid = p[19];
+        return UBX_TIME_TIMEUTC;
+
+    case UBX_TIM_TP:
+        ubxTimeTp.towMs = ubxU32(&p[0]);
+        ubxTimeTp.towSubMs = ubxU32(&p[4]);
+        ubxTimeTp.qErr = (int32_t)ubxU32(&p[8]);
+        ubxTimeTp.week = ubxU16(&p[12]);
+        ubxTimeTp.flags = p[14];
+        ubxTimeTp.refInfo = p[15];
+        return UBX_TIME_TP;
+
+    case UBX_ACK_ACK:
+    case UBX_ACK_NAK:
+        ubxTimeAck.msgId = ubxU16(&p[0]);
+        ubxTimeAck.ack = (ubxTimeFramer.msgId == UBX_ACK_ACK);
+        return ubxTimeAck.ack ? UBX_TIME_ACK : UBX_TIME_NAK;
+
+    default:
+        return UBX_TIME_NONE;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the frames that switch the receiver port to UBX with
+            NAV-TIMEUTC and TIM-TP every second, or back to NMEA. The
+            messages are set up first, then the port, which keeps its
+            baud rate and takes both protocols in.
+
+    @param[out] frames
+                Room for UBX_TIME_CONFIG_MAX bytes
+    @param[in]  baudrate
+                Of the receiver port
+    @param[in]  ubx
+                UBX output, false for NMEA
+
+    @return Bytes written
+*/
+/**************************************************************************/
+uint16_t ubxTimeConfig(uint8_t *frames, uint32_t baudrate, bool ubx)
+{
+    uint16_t length = 0;
+    uint8_t rate = ubx ? 1 : 0;
+
+    /* CFG-MSG class, id and rate on the current port */
+    uint8_t msg[3] = { UBX_NAV_TIMEUTC & 0xFF, UBX_NAV_TIMEUTC >> 8, rate };
+    length += ubxFrame(&frames[length], UBX_CFG_MSG, msg, sizeof(msg));
+    msg[0] = UBX_TIM_TP & 0xFF;
+    msg[1] = UBX_TIM_TP >> 8;
+    length += ubxFrame(&frames[length], UBX_CFG_MSG, msg, sizeof(msg));
+
+    /* CFG-PRT for UART1, 8N1, UBX and NMEA in */
+    uint8_t prt[20] =
+    {
+        1, 0,                                   /* Port, reserved */
+        0, 0,                                   /* No TX ready pin */
+        0xD0, 0x08, 0x00, 0x00,                 /* 8 bits, no parity, 1 stop bit */
+        baudrate & 0xFF, (baudrate >> 8) & 0xFF, (baudrate >> 16) & 0xFF, baudrate >> 24,
+        0x03, 0x00,                             /* In UBX and NMEA */
+        ubx ? 0x01 : 0x02, 0x00,                /* Out UBX or NMEA */
+        0, 0, 0, 0                              /* Flags, reserved */
+    };
+    length += ubxFrame(&frames[length], UBX_CFG_PRT, prt, sizeof(prt));
+
+    return length;
+}
+
+void ubxTimeGetUtc(ubxTimeUtc_t *utc)
+{
+    *utc = ubxTimeUtc;
+}
+
+void ubxTimeGetTp(ubxTimeTp_t *tp)
+{
+    *tp = ubxTimeTp;
+}
+
+void ubxTimeGetAck(ubxTimeAck_t *ack)
+{
+    *ack = ubxTimeAck;
+}
+
+void ubxTimeGetStat(ubxStat_t *stat)
+{
+    *stat = ubxTimeFramer.stat;
+}
+
+void ubxTimeResetStat()
+{
+    ubxTimeFramer.stat = (ubxStat_t){ 0 };
+}
+
+static uint16_t ubxU16(const uint8_t *p)
+{
+    return p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t ubxU32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -35,6 +35,9 @@
 
 #include "timer.h"
 #include "led.h"
+#include "event.h"
+#include "perf.h"
+#include "trace.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -159,7 +162,9 @@ void PendSV_Handler(void)
 *******************************************************************************/
 void SysTick_Handler(void)
 {
+#ifndef CFG_TIMER_TICKLESS
     timer_tick();
+#endif
 }
 
 /*******************************************************************************
@@ -172,9 +177,15 @@ void SysTick_Handler(void)
 *******************************************************************************/
 void USB_LP_CAN1_RX0_IRQHandler(void)
 {
+  PERF_BEGIN(PERF_ISR_USB);
+  TRACE(TRACE_ISR_USB, 0, 0);
   led_usr_on();
   USB_Istr();
   led_usr_off();
+
+  /* Received data is read by the CLI in the main loop */
+  eventPost(EVENT_USB);
+  PERF_END(PERF_ISR_USB);
 }
 
 /*******************************************************************************
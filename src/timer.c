@@ -3,43 +3,473 @@
 // Copyright (c) 2014 Liviu Ionescu.
 //
 
+#include "platform_config.h"
 #include "timer.h"
+#include "event.h"
+#include "perf.h"
+#include "trace.h"
 #include "cortexm/ExceptionHandlers.h"
 
 // ----------------------------------------------------------------------------
 
 // Forward declarations.
 
+#ifdef CFG_TIMER_TICKLESS
+void TIM2_IRQHandler (void);
+#else
 void timer_tick (void);
+#endif
 
 // ----------------------------------------------------------------------------
 
-volatile timer_ticks_t timer_delayCount;
+#ifdef CFG_TIMER_TICKLESS
+// TIM2 counts the low 16 bits of the uptime, its overflows the rest.
+static volatile timer_ticks_t timer_overflows;
+
+// Last rising edge captured by channel 2, only the interrupt writes them.
+static volatile uint32_t timer_captureCount;
+static volatile timer_uptime_t timer_captureTime;
+#else
+// 64-bit uptime in two words, only timer_tick writes them.
+static volatile timer_ticks_t timer_tickCount;
+static volatile timer_ticks_t timer_tickCountHigh;
+#endif
+
+static volatile uint32_t timer_isrCount;
+
+// Deadline of the list head, checked by the interrupt. The list itself is
+// only touched by the main loop.
+static volatile timer_ticks_t timer_nextDeadline;
+static volatile bool timer_nextArmed;
+
+static timer_soft_t *timer_list;
+
+// ----------------------------------------------------------------------------
+
+// Wrap-safe: a is before b.
+static inline bool timer_before (timer_ticks_t a, timer_ticks_t b)
+{
+    return (int32_t) (a - b) < 0;
+}
+
+static void timer_insert (timer_soft_t *timer)
+{
+    timer_soft_t **p = &timer_list;
+
+    // Behind timers with the same deadline, so they expire in start order.
+    while (*p != NULL && !timer_before (timer->deadline, (*p)->deadline))
+    {
+        p = &(*p)->next;
+    }
+
+    timer->next = *p;
+    *p = timer;
+}
+
+static void timer_unlink (timer_soft_t *timer)
+{
+    for (timer_soft_t **p = &timer_list; *p != NULL; p = &(*p)->next)
+    {
+        if (*p == timer)
+        {
+            *p = timer->next;
+            break;
+        }
+    }
+
+    timer->next = NULL;
+}
+
+// Posts EVENT_TIMER once the armed deadline is due. Called from the
+// interrupt or with interrupts disabled.
+static void timer_check (void)
+{
+    if (!timer_nextArmed)
+    {
+#ifdef CFG_TIMER_TICKLESS
+        TIM_ITConfig (TIM2, TIM_IT_CC1, DISABLE);
+#endif
+        return;
+    }
+
+    if (!timer_before (timer_now (), timer_nextDeadline))
+    {
+        timer_nextArmed = false;
+#ifdef CFG_TIMER_TICKLESS
+        TIM_ITConfig (TIM2, TIM_IT_CC1, DISABLE);
+#endif
+        eventPost (EVENT_TIMER);
+        return;
+    }
+
+#ifdef CFG_TIMER_TICKLESS
+    // The compare only sees 16 bits, a deadline further away is armed by
+    // a later overflow.
+    if (timer_nextDeadline - timer_now () <= 0xFFFFu)
+    {
+        TIM_SetCompare1 (TIM2, (uint16_t) timer_nextDeadline);
+        TIM_ClearITPendingBit (TIM2, TIM_IT_CC1);
+        TIM_ITConfig (TIM2, TIM_IT_CC1, ENABLE);
+
+        // The counter may have passed the compare value meanwhile.
+        if (!timer_before (timer_now (), timer_nextDeadline))
+        {
+            timer_nextArmed = false;
+            TIM_ITConfig (TIM2, TIM_IT_CC1, DISABLE);
+            eventPost (EVENT_TIMER);
+        }
+    }
+    else
+    {
+        TIM_ITConfig (TIM2, TIM_IT_CC1, DISABLE);
+    }
+#endif
+}
+
+static void timer_arm (void)
+{
+    __disable_irq ();
+    if (timer_list != NULL)
+    {
+        timer_nextDeadline = timer_list->deadline;
+        timer_nextArmed = true;
+    }
+    else
+    {
+        timer_nextArmed = false;
+    }
+    timer_check ();
+    __enable_irq ();
+}
 
 // ----------------------------------------------------------------------------
 
+#ifdef CFG_TIMER_TICKLESS
+
+void timer_init (void)
+{
+    RCC_APB1PeriphClockCmd (RCC_APB1Periph_TIM2, ENABLE);
+
+    // The timer clock is doubled when APB1 is divided.
+    RCC_ClocksTypeDef clocks;
+    RCC_GetClocksFreq (&clocks);
+    uint32_t timerClock = clocks.PCLK1_Frequency;
+    if (clocks.PCLK1_Frequency != clocks.HCLK_Frequency)
+    {
+        timerClock *= 2u;
+    }
+
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    TIM_TimeBaseStructInit (&TIM_TimeBaseStructure);
+    TIM_TimeBaseStructure.TIM_Prescaler = (uint16_t) (timerClock / TIMER_FREQUENCY_HZ - 1u);
+    TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseInit (TIM2, &TIM_TimeBaseStructure);
+
+    // The init generates an update to load the prescaler, not an overflow.
+    TIM_ClearITPendingBit (TIM2, TIM_IT_Update | TIM_IT_CC1);
+    TIM_ITConfig (TIM2, TIM_IT_Update, ENABLE);
+
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = TIM2_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init (&NVIC_InitStructure);
+
+    TIM_Cmd (TIM2, ENABLE);
+
+    // Enable the DWT cycle counter for timestamps and measurements.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Overflow every 655 ms and the compare of the next deadline, the only
+// timer interrupts left, and the capture if started.
+void TIM2_IRQHandler (void)
+{
+    PERF_BEGIN (PERF_ISR_TIMER);
+    timer_isrCount++;
+
+    uint8_t flags = 0u;
+
+    if (TIM_GetITStatus (TIM2, TIM_IT_Update) != RESET)
+    {
+        TIM_ClearITPendingBit (TIM2, TIM_IT_Update);
+        timer_overflows++;
+        flags |= 1u;
+    }
+
+    if (TIM_GetITStatus (TIM2, TIM_IT_CC1) != RESET)
+    {
+        TIM_ClearITPendingBit (TIM2, TIM_IT_CC1);
+        flags |= 2u;
+    }
+
+    if (TIM_GetITStatus (TIM2, TIM_IT_CC2) != RESET)
+    {
+        // Reading the capture clears the flag. The edge was less than an
+        // overflow period ago, so the low 16 bits place it.
+        uint16_t captured = TIM_GetCapture2 (TIM2);
+        timer_uptime_t now = timer_uptime ();
+
+        timer_captureTime = now - (uint16_t) ((uint16_t) now - captured);
+        timer_captureCount++;
+        flags |= 4u;
+        eventPost (EVENT_CAPTURE);
+    }
+
+    TRACE (TRACE_ISR_TIMER, flags, 0);
+    timer_check ();
+    PERF_END (PERF_ISR_TIMER);
+}
+
+timer_ticks_t timer_now (void)
+{
+    return (timer_ticks_t) timer_uptime ();
+}
+
+void timer_capture_init (void)
+{
+    RCC_APB2PeriphClockCmd (RCC_APB2Periph_GPIOA, ENABLE);
+
+    GPIO_InitTypeDef GPIO_InitStructure;
+    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_1;
+    // Pulled down, an open input must not capture noise as edges.
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IPD;
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_Init (GPIOA, &GPIO_InitStructure);
+
+    // The filter takes 8 samples at the timer clock, not at the ticks.
+    TIM_ICInitTypeDef TIM_ICInitStructure;
+    TIM_ICStructInit (&TIM_ICInitStructure);
+    TIM_ICInitStructure.TIM_Channel = TIM_Channel_2;
+    TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Rising;
+    TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    TIM_ICInitStructure.TIM_ICFilter = 0x3;
+    TIM_ICInit (TIM2, &TIM_ICInitStructure);
+
+    timer_captureCount = 0u;
+    TIM_ClearITPendingBit (TIM2, TIM_IT_CC2);
+    TIM_ITConfig (TIM2, TIM_IT_CC2, ENABLE);
+}
+
+void timer_capture_deinit (void)
+{
+    TIM_ITConfig (TIM2, TIM_IT_CC2, DISABLE);
+    TIM_ClearITPendingBit (TIM2, TIM_IT_CC2);
+}
+
+uint32_t timer_capture (timer_uptime_t *time)
+{
+    uint32_t count;
+
+    // Retry if an edge was captured in between.
+    do
+    {
+        count = timer_captureCount;
+        *time = timer_captureTime;
+    }
+    while (count != timer_captureCount);
+
+    return count;
+}
+
+timer_uptime_t timer_uptime (void)
+{
+    timer_ticks_t high;
+    uint16_t count;
+    bool pending;
+
+    // Retry if the interrupt counted an overflow in between.
+    do
+    {
+        high = timer_overflows;
+        count = (uint16_t) TIM2->CNT;
+        pending = (TIM2->SR & TIM_SR_UIF) != 0u;
+    }
+    while (high != timer_overflows);
+
+    // Overflowed but not yet counted, with interrupts disabled or from a
+    // higher priority. A high count was read before the overflow.
+    if (pending && count < 0x8000u)
+    {
+        high++;
+    }
+
+    return ((timer_uptime_t) high << 16) | count;
+}
+
+#else
+
 void timer_init (void)
 {
     // Use SysTick as reference for the delay loops.
     SysTick_Config (SystemCoreClock / TIMER_FREQUENCY_HZ);
+
+    // Enable the DWT cycle counter for timestamps and measurements.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void timer_tick (void)
+{
+    PERF_BEGIN (PERF_ISR_TIMER);
+    timer_isrCount++;
+
+    if (++timer_tickCount == 0u)
+    {
+        ++timer_tickCountHigh;
+    }
+
+    // Only the list head is checked here, timer_poll does the rest.
+    timer_check ();
+    PERF_END (PERF_ISR_TIMER);
+}
+
+timer_ticks_t timer_now (void)
+{
+    return timer_tickCount;
+}
+
+timer_uptime_t timer_uptime (void)
+{
+    timer_ticks_t high;
+    timer_ticks_t low;
+
+    // Retry if the low word wrapped in between, at most once.
+    do
+    {
+        high = timer_tickCountHigh;
+        low = timer_tickCount;
+    }
+    while (high != timer_tickCountHigh);
+
+    return ((timer_uptime_t) high << 32) | low;
 }
 
+#endif // CFG_TIMER_TICKLESS
+
 void timer_sleep (timer_ticks_t ticks)
 {
-    timer_delayCount = ticks;
+    timer_uptime_t start = timer_uptime ();
 
-    // Busy wait until the SysTick decrements the counter to zero.
-    while (timer_delayCount != 0u)
+    // Busy wait on the uptime, needs no interrupt per tick.
+    while (timer_elapsed (start) < ticks)
         ;
 }
 
-void timer_tick (void)
+uint32_t timer_isr_count (void)
+{
+    return timer_isrCount;
+}
+
+timer_uptime_t timer_elapsed (timer_uptime_t since)
+{
+    return timer_uptime () - since;
+}
+
+uint32_t timer_elapsed_ms (timer_uptime_t since)
+{
+    return timer_to_ms (timer_elapsed (since));
+}
+
+uint32_t timer_to_ms (timer_uptime_t ticks)
+{
+    // Stay with a 32-bit division for the common short intervals.
+    if (ticks <= UINT32_MAX)
+    {
+        return (uint32_t) ticks / (TIMER_FREQUENCY_HZ / 1000u);
+    }
+
+    ticks /= (TIMER_FREQUENCY_HZ / 1000u);
+    return (ticks > UINT32_MAX) ? UINT32_MAX : (uint32_t) ticks;
+}
+
+void timer_start (timer_soft_t *timer, timer_ticks_t delay, timer_ticks_t period,
+                  timer_callback_t callback)
+{
+    if (timer->active)
+    {
+        timer_unlink (timer);
+    }
+
+    timer->deadline = timer_now () + delay;
+    timer->period = period;
+    timer->callback = callback;
+    timer->active = true;
+    timer->expired = false;
+    timer->overruns = 0u;
+
+    timer_insert (timer);
+    timer_arm ();
+}
+
+void timer_stop (timer_soft_t *timer)
+{
+    if (timer->active)
+    {
+        timer_unlink (timer);
+        timer->active = false;
+        timer_arm ();
+    }
+}
+
+bool timer_active (timer_soft_t *timer)
+{
+    return timer->active;
+}
+
+bool timer_expired (timer_soft_t *timer)
+{
+    bool expired = timer->expired;
+    timer->expired = false;
+    return expired;
+}
+
+void timer_poll (void)
 {
-    // Decrement to zero the counter used by the delay routine.
-    if (timer_delayCount != 0u)
+    timer_ticks_t now = timer_now ();
+
+    while (timer_list != NULL && !timer_before (now, timer_list->deadline))
     {
-        --timer_delayCount;
+        timer_soft_t *timer = timer_list;
+        timer_list = timer->next;
+        timer->next = NULL;
+
+        if (timer->period != 0u)
+        {
+            // Keep the phase. A poll late by more than a period runs the
+            // callback once and skips the periods missed, it does not
+            // run them in a burst.
+            timer->deadline += timer->period;
+            if (!timer_before (now, timer->deadline))
+            {
+                timer_ticks_t missed = (now - timer->deadline) / timer->period + 1u;
+                timer->deadline += missed * timer->period;
+                timer->overruns += missed;
+            }
+            timer_insert (timer);
+        }
+        else
+        {
+            timer->active = false;
+        }
+
+        timer->expired = true;
+
+        // Already unlinked or reinserted, so the callback may start or
+        // stop any timer including this one.
+        if (timer->callback != NULL)
+        {
+            timer->callback (timer);
+        }
     }
+
+    timer_arm ();
 }
 
 // ----------------------------------------------------------------------------
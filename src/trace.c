@@ -0,0 +1,143 @@
+#include "platform_config.h"
+
+#include "trace.h"
+
+#ifdef CFG_TRACE
+
+#include "timer.h"
+
+#if (CFG_TRACE_RECORDS & (CFG_TRACE_RECORDS - 1)) != 0
+#error "CFG_TRACE_RECORDS must be a power of 2"
+#endif
+
+#define TRACE_HEADER_SIZE   (24)
+
+static traceRecord_t traceRing[CFG_TRACE_RECORDS];
+static uint32_t traceWritten;
+static uint32_t traceDropped;
+static volatile bool traceFrozen;
+
+static void tracePut32(uint8_t *p, uint32_t v);
+static void traceChecksum(const uint8_t *p, uint32_t length, uint8_t *a, uint8_t *b);
+
+
+/**************************************************************************/
+/*!
+    @brief Logs one record, safe to call from any interrupt priority.
+           Records written while a dump is running are dropped.
+*/
+/**************************************************************************/
+void traceWrite(traceId_t id, uint8_t arg8, uint16_t arg16)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (traceFrozen)
+    {
+        traceDropped++;
+    }
+    else
+    {
+        traceRecord_t *r = &traceRing[traceWritten & (CFG_TRACE_RECORDS - 1)];
+        r->cycles = timer_cycles();
+        r->id = id;
+        r->arg8 = arg8;
+        r->arg16 = arg16;
+        traceWritten++;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void traceClear()
+{
+    __disable_irq();
+    traceWritten = 0;
+    traceDropped = 0;
+    __enable_irq();
+}
+
+uint32_t traceGetWritten()
+{
+    return traceWritten;
+}
+
+uint32_t traceGetDropped()
+{
+    return traceDropped;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sends the ring in binary, oldest record first
+
+    Header (little endian): "TRC1", record size (u16), records (u16),
+    written (u32), dropped (u32), core clock (u32), cycles at the dump
+    (u32). Then the records and a Fletcher checksum over all of it, the
+    same as the protocol uses. Formatting is left to the host decoder.
+
+    @param[in]  send
+                Buffer send function of the CLI
+*/
+/**************************************************************************/
+void traceDump(void (*send)(uint8_t *, uint32_t))
+{
+    traceFrozen = true;
+
+    uint32_t written = traceWritten;
+    uint32_t count = (written < CFG_TRACE_RECORDS) ? written : CFG_TRACE_RECORDS;
+    uint32_t first = (written - count) & (CFG_TRACE_RECORDS - 1);
+
+    uint8_t header[TRACE_HEADER_SIZE] = TRACE_MAGIC;
+    header[4] = sizeof(traceRecord_t);
+    header[5] = 0;
+    header[6] = count & 0xFF;
+    header[7] = count >> 8;
+    tracePut32(&header[8], written);
+    tracePut32(&header[12], traceDropped);
+    tracePut32(&header[16], SystemCoreClock);
+    tracePut32(&header[20], timer_cycles());
+
+    /* The ring wraps, so the records go out in up to two spans */
+    uint8_t *span1 = (uint8_t *)&traceRing[first];
+    uint32_t span1Length = ((first + count <= CFG_TRACE_RECORDS) ? count : CFG_TRACE_RECORDS - first) * sizeof(traceRecord_t);
+    uint8_t *span2 = (uint8_t *)&traceRing[0];
+    uint32_t span2Length = count * sizeof(traceRecord_t) - span1Length;
+
+    uint8_t checksum[2] = { 0, 0 };
+    traceChecksum(header, TRACE_HEADER_SIZE, &checksum[0], &checksum[1]);
+    traceChecksum(span1, span1Length, &checksum[0], &checksum[1]);
+    traceChecksum(span2, span2Length, &checksum[0], &checksum[1]);
+
+    send(header, TRACE_HEADER_SIZE);
+    if (span1Length > 0)
+    {
+        send(span1, span1Length);
+    }
+    if (span2Length > 0)
+    {
+        send(span2, span2Length);
+    }
+    send(checksum, 2);
+
+    traceFrozen = false;
+}
+
+static void tracePut32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static void traceChecksum(const uint8_t *p, uint32_t length, uint8_t *a, uint8_t *b)
+{
+    for (uint32_t i = 0; i < length; i++)
+    {
+        *a = *a + p[i];
+        *b = *b + *a;
+    }
+}
+
+#endif // CFG_TRACE
@@ -1,6 +1,12 @@
 #include "platform_config.h"
 
 #include "stm32f10x_usart.h"
+#include "stm32f10x_dma.h"
+
+#include "event.h"
+#include "perf.h"
+#include "timer.h"
+#include "trace.h"
 
 
 /* RX Ring Buffer */
@@ -14,6 +20,16 @@ uint32_t USART2_Rx_In_Ptr = 0;
 uint32_t USART2_Rx_Out_Ptr = 0;
 uint32_t USART2_Rx_Length = 0;
 
+/* USART2 RX by DMA, the ring is USART2_Rx_Buffer */
+#if (CFG_USART2_BUFSIZE & (CFG_USART2_BUFSIZE - 1)) != 0
+#error "CFG_USART2_BUFSIZE must be a power of 2 for the DMA ring"
+#endif
+
+volatile uint32_t USART2_Rx_Halves = 0;
+volatile uint32_t USART2_Rx_Idles = 0;
+volatile uint32_t USART2_Rx_Idle_Written = 0;
+volatile timer_uptime_t USART2_Rx_Idle_Time = 0;
+
 void uart1Init(void)
 {
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1 | RCC_APB2Periph_AFIO |
@@ -88,6 +104,164 @@ void uart2Init(void)
     NVIC_EnableIRQ(USART2_IRQn);
 }
 
+/**************************************************************************/
+/*!
+    @brief  Initialises USART2 to receive by DMA. DMA1 channel 6 fills
+            USART2_Rx_Buffer as a ring, the half and full transfer and
+            the idle line interrupts post EVENT_USART2. The reader takes
+            the position from uart2DmaWritten, uart2ReadChar is not used.
+
+    @param[in]  baudrate
+                Of the device on USART2
+*/
+/**************************************************************************/
+void uart2InitDma(uint32_t baudrate)
+{
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART2, ENABLE);
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO | RCC_APB2Periph_GPIOA, ENABLE);
+
+    GPIO_InitTypeDef GPIO_InitStructure;
+
+    /* TX Pin */
+    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_2;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_Init(GPIOA, &GPIO_InitStructure);
+
+    /* RX Pin */
+    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_3;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IPU;
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_Init(GPIOA, &GPIO_InitStructure);
+
+
+    USART_InitTypeDef USART_InitStructure;
+
+    USART_InitStructure.USART_BaudRate = baudrate;
+    USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+    USART_InitStructure.USART_StopBits = USART_StopBits_1;
+    USART_InitStructure.USART_Parity = USART_Parity_No;
+    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+
+    USART_Init(USART2, &USART_InitStructure);
+
+    /* USART2 RX is DMA1 channel 6 */
+    DMA_InitTypeDef DMA_InitStructure;
+
+    DMA_DeInit(DMA1_Channel6);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&USART2->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)USART2_Rx_Buffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = CFG_USART2_BUFSIZE;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel6, &DMA_InitStructure);
+
+    USART2_Rx_Halves = 0;
+    USART2_Rx_Idles = 0;
+
+    DMA_ITConfig(DMA1_Channel6, DMA_IT_HT | DMA_IT_TC, ENABLE);
+    DMA_Cmd(DMA1_Channel6, ENABLE);
+    USART_DMACmd(USART2, USART_DMAReq_Rx, ENABLE);
+
+    USART_Cmd(USART2, ENABLE);
+
+    USART_ITConfig(USART2, USART_IT_IDLE, ENABLE);
+    NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+    NVIC_EnableIRQ(USART2_IRQn);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stops the reception by DMA of uart2InitDma, no more interrupt
+            posts EVENT_USART2. USART2 and DMA1 are clocked off, nothing
+            else uses them.
+*/
+/**************************************************************************/
+void uart2DeinitDma(void)
+{
+    NVIC_DisableIRQ(USART2_IRQn);
+    NVIC_DisableIRQ(DMA1_Channel6_IRQn);
+
+    USART_ITConfig(USART2, USART_IT_IDLE, DISABLE);
+    USART_DMACmd(USART2, USART_DMAReq_Rx, DISABLE);
+    USART_Cmd(USART2, DISABLE);
+
+    DMA_ITConfig(DMA1_Channel6, DMA_IT_HT | DMA_IT_TC, DISABLE);
+    DMA_Cmd(DMA1_Channel6, DISABLE);
+    DMA_ClearITPendingBit(DMA1_IT_GL6);
+
+    NVIC_ClearPendingIRQ(USART2_IRQn);
+    NVIC_ClearPendingIRQ(DMA1_Channel6_IRQn);
+
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART2, DISABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, DISABLE);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Characters the DMA wrote into the ring so far, wrapping at
+            2^32. The position within the ring is this modulo
+            CFG_USART2_BUFSIZE.
+*/
+/**************************************************************************/
+uint32_t uart2DmaWritten(void)
+{
+    const uint32_t half = CFG_USART2_BUFSIZE / 2;
+    uint32_t halves;
+    uint32_t pos;
+
+    /* Retry if the interrupt counted a half in between */
+    do
+    {
+        halves = USART2_Rx_Halves;
+        pos = CFG_USART2_BUFSIZE - DMA_GetCurrDataCounter(DMA1_Channel6);
+    }
+    while (halves != USART2_Rx_Halves);
+
+    /* Crossed a half but not yet counted, with interrupts disabled or
+       from a higher priority */
+    if ((pos >= half) != ((halves & 1) != 0))
+    {
+        halves++;
+    }
+
+    return halves * half + pos % half;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the idle lines so far, with the characters written
+            and the uptime at the last one
+*/
+/**************************************************************************/
+uint32_t uart2DmaIdle(uint32_t *written, timer_uptime_t *time)
+{
+    uint32_t idles;
+
+    do
+    {
+        idles = USART2_Rx_Idles;
+        *written = USART2_Rx_Idle_Written;
+        *time = USART2_Rx_Idle_Time;
+    }
+    while (idles != USART2_Rx_Idles);
+
+    return idles;
+}
+
+const uint8_t *uart2DmaBuffer(void)
+{
+    return USART2_Rx_Buffer;
+}
+
 void uart1SendChar(uint8_t c)
 {
     USART_SendData(USART1, c);
@@ -164,9 +338,12 @@ uint32_t uart2ReadChar(uint8_t *c)
 
 void USART1_IRQHandler(void)
 {
+    PERF_BEGIN(PERF_ISR_USART1);
+
     if(USART_GetITStatus(USART1, USART_IT_RXNE) != RESET)
     {
         uint8_t c = USART_ReceiveData(USART1);
+        TRACE(TRACE_ISR_USART1, c, 0);
         USART1_Rx_Buffer[USART1_Rx_In_Ptr] = c;
         USART1_Rx_In_Ptr++;
         USART1_Rx_Length++;
@@ -179,14 +356,21 @@ void USART1_IRQHandler(void)
         {
             // error discard rx
         }
+
+        eventPost(EVENT_USART1);
     }
+
+    PERF_END(PERF_ISR_USART1);
 }
 
 void USART2_IRQHandler(void)
 {
+    PERF_BEGIN(PERF_ISR_USART2);
+
     if(USART_GetITStatus(USART2, USART_IT_RXNE) != RESET)
     {
         uint8_t c = USART_ReceiveData(USART2);
+        TRACE(TRACE_ISR_USART2, c, 0);
         USART2_Rx_Buffer[USART2_Rx_In_Ptr] = c;
         USART2_Rx_In_Ptr++;
         USART2_Rx_Length++;
@@ -199,7 +383,45 @@ void USART2_IRQHandler(void)
         {
             // error discard rx
         }
+
+        eventPost(EVENT_USART2);
     }
+
+    if(USART_GetITStatus(USART2, USART_IT_IDLE) != RESET)
+    {
+        /* Cleared by reading the data register, the DMA took the data */
+        timer_uptime_t time = timer_uptime();
+        USART_ReceiveData(USART2);
+
+        USART2_Rx_Idle_Written = uart2DmaWritten();
+        USART2_Rx_Idle_Time = time;
+        USART2_Rx_Idles++;
+
+        eventPost(EVENT_USART2);
+    }
+
+    PERF_END(PERF_ISR_USART2);
+}
+
+void DMA1_Channel6_IRQHandler(void)
+{
+    PERF_BEGIN(PERF_ISR_DMA1_CH6);
+
+    /* Both if the interrupt was held off for half a ring */
+    if(DMA_GetITStatus(DMA1_IT_HT6) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_HT6);
+        USART2_Rx_Halves++;
+    }
+    if(DMA_GetITStatus(DMA1_IT_TC6) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC6);
+        USART2_Rx_Halves++;
+    }
+
+    eventPost(EVENT_USART2);
+
+    PERF_END(PERF_ISR_DMA1_CH6);
 }
 
 
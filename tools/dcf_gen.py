@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Generates synthetic DCF77 edge files for tools/dcf_replay.c.
+
+Each file holds the receiver output for a number of minutes, starting at a
+random second, with edge jitter, dropped pulses and spikes:
+
+    dcf_gen.py --count 200 --spikes 0.1 --drop 0.02 --jitter 20 --out noisy
+    dcf_replay noisy/*.txt
+"""
+
+import argparse
+import datetime
+import os
+import random
+
+
+def bcd(value, bits):
+    value = (value // 10) << 4 | (value % 10)
+    return [(value >> i) & 1 for i in range(bits)]
+
+
+def parity(bits):
+    return bits + [sum(bits) & 1]
+
+
+def frame(local, cest):
+    """Bits 0..58 sent the minute before local"""
+    bits = [0] * 59
+    bits[17] = 1 if cest else 0
+    bits[18] = 0 if cest else 1
+    bits[20] = 1
+    bits[21:29] = parity(bcd(local.minute, 7))
+    bits[29:36] = parity(bcd(local.hour, 6))
+    bits[36:59] = parity(bcd(local.day, 6) + [(local.isoweekday() >> i) & 1 for i in range(3)]
+                         + bcd(local.month, 5) + bcd(local.year % 100, 8))
+    return bits
+
+
+def signal(args, rng, start):
+    """Pulses and spikes as (rise, fall) in us, the mark of the start
+    minute at 0"""
+    pulses = []
+    jitter = args.jitter * 1000
+    for m in range(args.minutes):
+        bits = frame(start + datetime.timedelta(minutes=m + 1), args.zone == "cest")
+        for s, bit in enumerate(bits):
+            if rng.random() < args.drop:
+                continue
+            t = (m * 60 + s) * 1000000
+            rise = t + rng.uniform(-jitter, jitter)
+            fall = t + (200000 if bit else 100000) + rng.uniform(-jitter, jitter)
+            pulses.append((rise, fall))
+
+    spikes = []
+    end = args.minutes * 60 * 1000000
+    t = 0
+    while args.spikes > 0:
+        t += rng.expovariate(args.spikes) * 1000000
+        if t >= end:
+            break
+        spikes.append((t, t + rng.uniform(1000, 20000)))
+
+    return pulses, spikes
+
+
+def edges(pulses, spikes, begin):
+    """Level changes after begin, a spike inverts the level, so inside a
+    pulse it is a gap"""
+    changes = []
+    for kind, intervals in enumerate((pulses, spikes)):
+        for rise, fall in intervals:
+            changes.append((rise, kind, 1))
+            changes.append((fall, kind, -1))
+    changes.sort()
+
+    out = []
+    depth = [0, 0]
+    level = 0
+    for t, kind, d in changes:
+        depth[kind] += d
+        now = (depth[0] > 0) != (depth[1] > 0)
+        if now != level:
+            level = now
+            if t >= begin:
+                out.append((int(t), 1 if level else 0))
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=1, help="files to generate")
+    parser.add_argument("--minutes", type=int, default=30, help="length of a file")
+    parser.add_argument("--spikes", type=float, default=0.0, help="spikes per second")
+    parser.add_argument("--drop", type=float, default=0.0, help="probability of a missing pulse")
+    parser.add_argument("--jitter", type=float, default=5.0, help="edge jitter in ms, uniform +-")
+    parser.add_argument("--start", default="2026-10-16 17:15", help="local time of the first minute")
+    parser.add_argument("--zone", choices=("cet", "cest"), default="cest")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--out", default=".", help="directory of the files")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    start = datetime.datetime.strptime(args.start, "%Y-%m-%d %H:%M")
+    os.makedirs(args.out, exist_ok=True)
+
+    for n in range(args.count):
+        # The receiver is switched on at a random second of the first minute
+        begin = rng.uniform(0, 60) * 1000000
+        base = 1000000 - int(begin)
+        name = os.path.join(args.out, "dcf%04d.txt" % n)
+        with open(name, "w") as f:
+            f.write("# spikes %g/s drop %g jitter %g ms seed %d\n" % (args.spikes, args.drop, args.jitter, args.seed))
+            f.write("# start %02d %02d %02d %02d %02d %d\n"
+                    % (start.year % 100, start.month, start.day, start.hour, start.minute, base))
+            for t, level in edges(*signal(args, rng, start), begin=begin):
+                f.write("%d %d\n" % (t + base, level))
+
+
+if __name__ == "__main__":
+    main()
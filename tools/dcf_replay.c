@@ -0,0 +1,337 @@
+/**************************************************************************/
+/*!
+    @file     dcf_replay.c
+
+    @brief    Feeds DCF77 edge files to the decoder on the host and reports
+              how many minutes decoded, why the others failed, how long
+              the first one took and the CPU time per edge.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Iinclude tools/dcf_replay.c src/rtc/dcf_decoder.c -o dcf_replay
+
+    An edge file has one edge per line, the time in us and the level of
+    the receiver output after it, 1 while the carrier is reduced:
+
+        # start 26 10 16 17 15 1000000
+        1000000 1
+        1100012 0
+
+    The optional start line gives the local time of a minute and the time
+    of its minute mark, then every decoded frame is checked. Synthetic
+    files come from tools/dcf_gen.py, recordings from the event trace
+    with 'trace_decode.py --dcf'.
+
+    With -f <ms> the edges are sampled at 1 kHz through the integrator of
+    CFG_DCF_SAMPLER first.
+*/
+/**************************************************************************/
+
+#include "rtc/dcf_decoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct
+{
+    dcfDecoderUs_t time;
+    uint8_t level;
+} replayEdge_t;
+
+typedef struct
+{
+    replayEdge_t *edges;
+    size_t count;
+    bool hasStart;
+    int32_t startMinutes;       /**< Local time of the start minute, minutes since 2000 */
+    int64_t startUs;            /**< Its minute mark, may be before the first edge */
+} replayFile_t;
+
+typedef struct
+{
+    uint32_t marks;             /**< Minute marks */
+    uint32_t valid;             /**< Of them decoded */
+    uint32_t wrong;             /**< Decoded, but not the expected time */
+    bool first;
+    double firstS;              /**< From the first edge to the first valid frame */
+} replayResult_t;
+
+static int32_t replayDays(int32_t year, int32_t month, int32_t day);
+static bool replayLoad(const char *name, replayFile_t *file);
+static void replayRun(const replayFile_t *file, replayResult_t *result, uint8_t filter, bool verbose);
+static void replayEdge(const replayFile_t *file, replayResult_t *result, dcfDecoderUs_t time, uint8_t level, bool verbose);
+static int replayCompare(const void *a, const void *b);
+
+
+/**************************************************************************/
+/*!
+    @brief  Days since 2000-01-01 of a date in 2000..2099
+*/
+/**************************************************************************/
+static int32_t replayDays(int32_t year, int32_t month, int32_t day)
+{
+    static const int16_t before[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+    int32_t leap = (year % 4 == 0 && month > 2) ? 1 : 0;
+
+    return year * 365 + (year + 3) / 4 + before[month - 1] + leap + day - 1;
+}
+
+static bool replayLoad(const char *name, replayFile_t *file)
+{
+    FILE *f = fopen(name, "r");
+    if (f == NULL)
+    {
+        perror(name);
+        return false;
+    }
+
+    size_t size = 1024;
+    char line[128];
+
+    *file = (replayFile_t){ 0 };
+    file->edges = malloc(size * sizeof(replayEdge_t));
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        int y, mo, d, h, mi;
+        long long start;
+        unsigned long long t;
+        unsigned int level;
+
+        if (line[0] == '#')
+        {
+            if (sscanf(line, "# start %d %d %d %d %d %lld", &y, &mo, &d, &h, &mi, &start) == 6)
+            {
+                file->hasStart = true;
+                file->startMinutes = (replayDays(y, mo, d) * 24 + h) * 60 + mi;
+                file->startUs = start;
+            }
+            continue;
+        }
+        if (sscanf(line, "%llu %u", &t, &level) != 2)
+        {
+            continue;
+        }
+
+        if (file->count == size)
+        {
+            size *= 2;
+            file->edges = realloc(file->edges, size * sizeof(replayEdge_t));
+        }
+        file->edges[file->count].time = t;
+        file->edges[file->count].level = (level != 0);
+        file->count++;
+    }
+
+    fclose(f);
+    return true;
+}
+
+static void replayRun(const replayFile_t *file, replayResult_t *result, uint8_t filter, bool verbose)
+{
+    *result = (replayResult_t){ 0 };
+    dcfDecoderInit();
+
+    if (filter == 0)
+    {
+        for (size_t i = 0; i < file->count; i++)
+        {
+            replayEdge(file, result, file->edges[i].time, file->edges[i].level, verbose);
+        }
+        return;
+    }
+
+    /* Samples every ms like the sampler interrupt, the edges are dated
+       back by the integrator delay */
+    dcfFilter_t f = { 0 };
+    uint8_t level = 0;
+    size_t next = 0;
+
+    for (dcfDecoderUs_t t = file->edges[0].time; next < file->count; t += 1000)
+    {
+        while (next < file->count && file->edges[next].time <= t)
+        {
+            level = file->edges[next++].level;
+        }
+
+        uint8_t last = f.level;
+        if (dcfFilterSample(&f, level, filter) != last)
+        {
+            replayEdge(file, result, t - filter * 1000, f.level, verbose);
+        }
+    }
+}
+
+static void replayEdge(const replayFile_t *file, replayResult_t *result, dcfDecoderUs_t time, uint8_t level, bool verbose)
+{
+    uint8_t events = dcfDecoderEdge(time, level);
+
+    if (!(events & DCF_DECODER_MINUTE))
+    {
+        return;
+    }
+    result->marks++;
+    if (!(events & DCF_DECODER_VALID))
+    {
+        return;
+    }
+    result->valid++;
+
+    dcfDecoderTime_t t;
+    dcfDecoderTime(&t);
+    int32_t minutes = (replayDays(t.year, t.month, t.day) * 24 + t.hour) * 60 + t.minute;
+
+    if (file->hasStart)
+    {
+        int64_t elapsed = (int64_t)time - file->startUs;
+        int32_t expected = file->startMinutes + (int32_t)((elapsed + 30000000) / 60000000);
+        if (minutes != expected)
+        {
+            result->wrong++;
+            if (verbose)
+            {
+                printf("  wrong at %.3f s: %02u:%02u %02u.%02u.%02u, %ld minutes off\n",
+                       (time - file->edges[0].time) / 1e6, t.hour, t.minute, t.day, t.month, t.year,
+                       (long)(minutes - expected));
+            }
+            return;
+        }
+    }
+
+    if (!result->first)
+    {
+        result->first = true;
+        result->firstS = (time - file->edges[0].time) / 1e6;
+    }
+}
+
+static int replayCompare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    bool verbose = false;
+    int repeat = 1;
+    int filter = 0;
+    int first = 1;
+
+    while (first < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (strcmp(argv[first], "-r") == 0 && first + 1 < argc)
+        {
+            repeat = atoi(argv[++first]);
+        }
+        else if (strcmp(argv[first], "-f") == 0 && first + 1 < argc)
+        {
+            filter = atoi(argv[++first]);
+        }
+        else
+        {
+            break;
+        }
+        first++;
+    }
+    if (first >= argc || repeat < 1 || filter < 0 || filter > 50)
+    {
+        fprintf(stderr, "usage: %s [-v] [-r repeat] [-f integrator ms] file...\n", argv[0]);
+        return 2;
+    }
+
+    int files = argc - first;
+    double *firstS = malloc(files * sizeof(double));
+    int locked = 0;
+    uint64_t edges = 0;
+    uint32_t marks = 0;
+    uint32_t valid = 0;
+    uint32_t wrong = 0;
+    uint32_t failed[DCF_FIELD_COUNT] = { 0 };
+    double cpu = 0;
+
+    for (int i = 0; i < files; i++)
+    {
+        replayFile_t file;
+        replayResult_t result;
+
+        if (!replayLoad(argv[first + i], &file))
+        {
+            return 1;
+        }
+        if (file.count == 0)
+        {
+            free(file.edges);
+            continue;
+        }
+
+        /* Repeated for the timing, the result is the same each time */
+        clock_t start = clock();
+        for (int r = 0; r < repeat; r++)
+        {
+            replayRun(&file, &result, filter, verbose && r == 0);
+        }
+        cpu += (double)(clock() - start) / CLOCKS_PER_SEC;
+        edges += (uint64_t)file.count * repeat;
+
+        dcfDecoderStat_t stat;
+        dcfDecoderGetStat(&stat);
+        for (int f = 0; f < DCF_FIELD_COUNT; f++)
+        {
+            failed[f] += stat.failed[f];
+        }
+
+        marks += result.marks;
+        valid += result.valid;
+        wrong += result.wrong;
+        if (result.first)
+        {
+            firstS[locked++] = result.firstS;
+        }
+
+        if (verbose)
+        {
+            printf("%s: %zu edges, %lu of %lu minutes decoded, %lu wrong, first after ", argv[first + i], file.count,
+                   (unsigned long)result.valid, (unsigned long)result.marks, (unsigned long)result.wrong);
+            if (result.first)
+            {
+                printf("%.1f s\n", result.firstS);
+            }
+            else
+            {
+                printf("-\n");
+            }
+        }
+        free(file.edges);
+    }
+
+    printf("files: %d, with a valid frame %d (%.1f %%)\n", files, locked, 100.0 * locked / files);
+    printf("minute marks: %lu, decoded %lu (%.1f %%), wrong %lu\n", (unsigned long)marks, (unsigned long)valid,
+           marks ? 100.0 * valid / marks : 0.0, (unsigned long)wrong);
+    printf("failed: start %lu, minute %lu, hour %lu, date %lu, check %lu\n", (unsigned long)failed[DCF_FIELD_START],
+           (unsigned long)failed[DCF_FIELD_MINUTE], (unsigned long)failed[DCF_FIELD_HOUR],
+           (unsigned long)failed[DCF_FIELD_DATE], (unsigned long)failed[DCF_FIELD_CHECK]);
+    if (locked > 0)
+    {
+        double sum = 0;
+        qsort(firstS, locked, sizeof(double), replayCompare);
+        for (int i = 0; i < locked; i++)
+        {
+            sum += firstS[i];
+        }
+        printf("first valid: median %.1f s, mean %.1f s, max %.1f s\n", firstS[locked / 2], sum / locked,
+               firstS[locked - 1]);
+    }
+    printf("cpu: %.1f ns per edge (%llu edges)\n", edges ? cpu * 1e9 / edges : 0.0, (unsigned long long)edges);
+
+    free(firstS);
+    return 0;
+}
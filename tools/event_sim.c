@@ -0,0 +1,315 @@
+/**************************************************************************/
+/*!
+    @file     event_sim.c
+
+    @brief    Runs event.c on the host in a simulated minute of interrupts
+              and reports the passes of the main loop, the time awake and
+              the latency from an interrupt to its dispatch.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Itools/host -Iinclude -include tools/host/platform_config.h \
+            tools/event_sim.c src/event.c -o event_sim
+
+    Time is counted in core cycles at 72 MHz. The interrupt sources are
+    the 100 kHz SysTick of timer_sleep (before the timer became tickless,
+    it posts nothing), the 1 kHz USB start of frame, the RTC second and two DCF
+    edges per second. A handler runs when its time has come and the
+    interrupts are not masked, WFI skips ahead to the next one. Between
+    LDREX and STREX the interrupts get a chance to come in, a handler
+    there clears the exclusive monitor as on the core.
+
+    The main loop is modelled with fixed costs: a pass of the loop before
+    event.c polled everything, the handling of an event set and the loop
+    overhead. Those figures are assumptions, not measurements, the counts
+    of passes, wakeups and dispatches and the latencies follow from them
+    and from event.c. Every post must be taken by a later eventTake.
+*/
+/**************************************************************************/
+
+#include "event.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_HZ              (72000000ull)
+#define SIM_TIME            (60 * SIM_HZ)
+#define SIM_POLL_CYCLES     (180)       /**< One pass of the polling loop */
+#define SIM_DISPATCH_CYCLES (400)       /**< Handling one set of events */
+#define SIM_LOOP_CYCLES     (20)        /**< Loop overhead per pass */
+#define SIM_ISR_CYCLES      (60)        /**< One interrupt handler */
+#define SIM_EVENTS          (8)
+
+typedef struct
+{
+    const char *name;
+    uint64_t period;
+    uint32_t events;
+    uint64_t next;
+} simSource_t;
+
+static simSource_t simSources[] =
+{
+    { "SysTick",    SIM_HZ / 100000, EVENT_NONE,       0 },
+    { "USB SOF",    SIM_HZ / 1000,   EVENT_USB,        0 },
+    { "RTC second", SIM_HZ,          EVENT_RTC_SECOND, 0 },
+    { "DCF edge",   SIM_HZ / 2,      EVENT_DCF_EDGE,   0 }
+};
+
+#define SIM_SOURCES     (sizeof(simSources) / sizeof(simSources[0]))
+
+static uint64_t simNow;
+static bool simMasked;
+static bool simInIsr;
+static bool simMonitor;
+static uint32_t simIsrs;
+static uint32_t simTimerIsrs;
+
+/* Per event bit: time of the oldest post not taken yet, 0 for none */
+static uint64_t simPostedAt[SIM_EVENTS];
+static uint64_t simLatencyMax[SIM_EVENTS];
+static uint64_t simLatencySum[SIM_EVENTS];
+static uint32_t simTaken[SIM_EVENTS];
+static uint32_t simSpurious;
+
+DWT_Type hostDWT;
+CoreDebug_Type hostCoreDebug;
+uint32_t SystemCoreClock = SIM_HZ;
+
+static void simAdvance(uint64_t cycles);
+static void simInterrupts(void);
+static uint64_t simNextInterrupt(void);
+static void simDispatch(uint32_t events);
+static uint64_t simPolling(void);
+static uint32_t simEventLoop(bool tick);
+
+
+static void simAdvance(uint64_t cycles)
+{
+    simNow += cycles;
+    hostDWT.CYCCNT = (uint32_t)simNow;
+}
+
+/* Runs the handlers that are due */
+static void simInterrupts()
+{
+    if (simMasked || simInIsr)
+    {
+        return;
+    }
+
+    simInIsr = true;
+    for (uint8_t i = 0; i < SIM_SOURCES; i++)
+    {
+        while (simSources[i].next <= simNow)
+        {
+            simSources[i].next += simSources[i].period;
+            simMonitor = false;
+            simIsrs++;
+            if (simSources[i].events == EVENT_NONE)
+            {
+                simTimerIsrs++;
+            }
+            else
+            {
+                for (uint8_t b = 0; b < SIM_EVENTS; b++)
+                {
+                    if ((simSources[i].events & (1 << b)) && (simPostedAt[b] == 0))
+                    {
+                        simPostedAt[b] = simNow;
+                    }
+                }
+                eventPost(simSources[i].events);
+            }
+            simAdvance(SIM_ISR_CYCLES);
+        }
+    }
+    simInIsr = false;
+}
+
+static uint64_t simNextInterrupt()
+{
+    uint64_t next = UINT64_MAX;
+    for (uint8_t i = 0; i < SIM_SOURCES; i++)
+    {
+        if (simSources[i].next < next)
+        {
+            next = simSources[i].next;
+        }
+    }
+    return next;
+}
+
+uint32_t timer_isr_count(void)
+{
+    return simTimerIsrs;
+}
+
+void __disable_irq(void)
+{
+    simMasked = true;
+}
+
+void __enable_irq(void)
+{
+    simMasked = false;
+    simInterrupts();
+}
+
+/* Wakes on a pending interrupt even when they are masked */
+void __WFI(void)
+{
+    uint64_t next = simNextInterrupt();
+    if (next > simNow)
+    {
+        simAdvance(next - simNow);
+    }
+}
+
+/* An interrupt may come in between the load and the store */
+uint32_t __LDREXW(volatile uint32_t *addr)
+{
+    uint32_t value = *addr;
+    simMonitor = true;
+    simAdvance(2);
+    simInterrupts();
+    return value;
+}
+
+uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)
+{
+    if (!simMonitor)
+    {
+        return 1;
+    }
+    *addr = value;
+    simMonitor = false;
+    return 0;
+}
+
+static void simDispatch(uint32_t events)
+{
+    for (uint8_t b = 0; b < SIM_EVENTS; b++)
+    {
+        if ((events & (1 << b)) == 0)
+        {
+            continue;
+        }
+        if (simPostedAt[b] == 0)
+        {
+            simSpurious++;
+            continue;
+        }
+        uint64_t latency = simNow - simPostedAt[b];
+        simLatencySum[b] += latency;
+        if (latency > simLatencyMax[b])
+        {
+            simLatencyMax[b] = latency;
+        }
+        simTaken[b]++;
+        simPostedAt[b] = 0;
+    }
+}
+
+static void simReset(bool tick)
+{
+    simNow = 0;
+    simMasked = false;
+    simInIsr = false;
+    simIsrs = 0;
+    simTimerIsrs = 0;
+    simSpurious = 0;
+    memset(simPostedAt, 0, sizeof(simPostedAt));
+    memset(simLatencyMax, 0, sizeof(simLatencyMax));
+    memset(simLatencySum, 0, sizeof(simLatencySum));
+    memset(simTaken, 0, sizeof(simTaken));
+
+    for (uint8_t i = 0; i < SIM_SOURCES; i++)
+    {
+        simSources[i].next = simSources[i].period;
+    }
+    if (!tick)
+    {
+        simSources[0].next = UINT64_MAX;
+    }
+}
+
+/* The loop before event.c, polling everything without sleeping */
+static uint64_t simPolling()
+{
+    uint64_t passes = 0;
+
+    simReset(true);
+    while (simNow < SIM_TIME)
+    {
+        simAdvance(SIM_POLL_CYCLES);
+        simInterrupts();
+        passes++;
+    }
+    return passes;
+}
+
+/* Returns the posts never taken */
+static uint32_t simEventLoop(bool tick)
+{
+    uint64_t passes = 0;
+    uint64_t dispatches = 0;
+    uint64_t busy = 0;
+
+    simReset(tick);
+    eventInit();
+    while (simNow < SIM_TIME)
+    {
+        uint64_t start = simNow;
+        uint32_t events = eventTake();
+        if (events != EVENT_NONE)
+        {
+            simDispatch(events);
+            simAdvance(SIM_DISPATCH_CYCLES);
+            dispatches++;
+        }
+        if (events & EVENT_RTC_SECOND)
+        {
+            eventSecond();
+        }
+        simAdvance(SIM_LOOP_CYCLES);
+        busy += simNow - start;
+        eventWait();
+        passes++;
+    }
+
+    /* Whatever is still pending must come out of one more take */
+    simDispatch(eventTake());
+    uint32_t lost = simSpurious;
+    for (uint8_t b = 0; b < SIM_EVENTS; b++)
+    {
+        lost += (simPostedAt[b] != 0);
+    }
+
+    eventStat_t stat;
+    eventGetStat(&stat);
+    printf("event loop %s SysTick: %llu passes, %llu dispatches, %lu interrupts, %.2f%% in the loop "
+           "(eventStat %.2f%% awake, %lu wakeups in the last second)\n", tick ? "with" : "without",
+           (unsigned long long)passes, (unsigned long long)dispatches, (unsigned long)simIsrs,
+           100.0 * busy / simNow, 100.0 * stat.busyCycles / SIM_HZ, (unsigned long)stat.wakeups);
+
+    for (uint8_t i = 1; i < SIM_SOURCES; i++)
+    {
+        uint8_t b = __builtin_ctz(simSources[i].events);
+        printf("  %-10s latency mean %.2f us, max %.2f us over %lu dispatches\n", simSources[i].name,
+               simTaken[b] ? simLatencySum[b] * 1e6 / SIM_HZ / simTaken[b] : 0.0,
+               simLatencyMax[b] * 1e6 / SIM_HZ, (unsigned long)simTaken[b]);
+    }
+    printf("  posts lost or taken twice: %lu\n", (unsigned long)lost);
+    return lost;
+}
+
+int main()
+{
+    printf("polling loop: %llu passes, 100%% awake\n", (unsigned long long)simPolling());
+
+    uint32_t lost = simEventLoop(true);
+    lost += simEventLoop(false);
+    return (lost == 0) ? 0 : 1;
+}
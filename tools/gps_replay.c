@@ -0,0 +1,306 @@
+/**************************************************************************/
+/*!
+    @file     gps_replay.c
+
+    @brief    Replays NMEA and UBX logs through the GPS feed on the host
+              as the USART2 DMA would deliver them, and reports the
+              messages decoded, characters overwritten in the receive
+              buffer, the error of the time message start taken from the
+              idle line and the parse time per fix.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Iinclude tools/gps_replay.c src/rtc/gps_feed.c src/rtc/nmea.c \
+            src/rtc/ubx_time.c src/protocol/ubx.c -o gps_replay
+
+    Every RMC sentence or NAV-TIMEUTC frame starts a burst, one a second,
+    sent at the baud rate
+    with the sentence delay of the receiver. The DMA writes each character
+    into the ring, the half and full transfers and the idle line after a
+    burst wake the main loop, which polls the feed after a random latency
+    up to the loop latency. Logs are recordings of the receiver output or
+    files from tools/nmea_gen.py.
+*/
+/**************************************************************************/
+
+#include "rtc/gps_feed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPLAY_NEVER    (1e300)
+
+typedef struct
+{
+    uint32_t baudrate;
+    uint32_t size;              /**< Ring, a power of 2 */
+    double latencyUs;           /**< Longest delay of a poll after an event */
+    double delayUs;             /**< Time message start after the second */
+    double jitterUs;            /**< Of that, uniform +- */
+    double gap;                 /**< Pause before a message inside a burst, up to this part of a character */
+} replayConfig_t;
+
+typedef struct
+{
+    uint32_t bursts;
+    uint32_t time;              /**< RMC or NAV-TIMEUTC */
+    uint32_t dated;             /**< Of them with a start time */
+    double errorSumUs;
+    double errorMaxUs;
+    double cpu;
+} replayResult_t;
+
+/* The simulated USART2 and DMA */
+static uint8_t *replayRing;
+static uint32_t replayWritten;
+static uint32_t replayIdleCount;
+static uint32_t replayIdleWritten;
+static double replayIdleTime;
+static double replayPollAt;
+
+static uint8_t *replayLoad(const char *name, size_t *size);
+static void replayRun(const uint8_t *data, size_t size, const replayConfig_t *config, replayResult_t *result);
+static void replayEvent(double t, const replayConfig_t *config);
+static void replayPoll(const replayConfig_t *config, const double *starts, uint32_t bursts, replayResult_t *result);
+static bool replayIsTime(const uint8_t *data, size_t size, size_t i);
+
+
+static uint8_t *replayLoad(const char *name, size_t *size)
+{
+    FILE *f = fopen(name, "rb");
+    if (f == NULL)
+    {
+        perror(name);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = malloc(length > 0 ? length : 1);
+    *size = fread(data, 1, length, f);
+    fclose(f);
+    return data;
+}
+
+static bool replayIsTime(const uint8_t *data, size_t size, size_t i)
+{
+    static const uint8_t timeUtc[4] = { UBX_SYNC_0, UBX_SYNC_1, UBX_NAV_TIMEUTC & 0xFF, UBX_NAV_TIMEUTC >> 8 };
+
+    return (i + 6 <= size && ((data[i] == '$' && memcmp(&data[i + 3], "RMC", 3) == 0) ||
+                              memcmp(&data[i], timeUtc, sizeof(timeUtc)) == 0));
+}
+
+static void replayEvent(double t, const replayConfig_t *config)
+{
+    if (replayPollAt == REPLAY_NEVER)
+    {
+        replayPollAt = t + config->latencyUs * rand() / RAND_MAX;
+    }
+}
+
+static void replayPoll(const replayConfig_t *config, const double *starts, uint32_t bursts, replayResult_t *result)
+{
+    clock_t start = clock();
+    if (replayIdleCount > 0)
+    {
+        gpsFeedIdle(replayIdleCount, replayIdleWritten, (gpsFeedUs_t)replayIdleTime);
+    }
+    uint16_t sentences = gpsFeedData(replayRing, config->size, replayWritten);
+    gpsFeedUs_t timeUs;
+    bool dated = gpsFeedTimeStarted(&timeUs);
+    result->cpu += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (sentences & (GPS_FEED_SENTENCE(NMEA_RMC) | GPS_FEED_UBX(UBX_TIME_TIMEUTC)))
+    {
+        result->time++;
+    }
+    if (dated)
+    {
+        /* Against the closest burst start */
+        double error = REPLAY_NEVER;
+        for (uint32_t k = bursts; k > 0 && k + 3 > bursts; k--)
+        {
+            double e = (double)timeUs - starts[k - 1];
+            if (e * e < error * error)
+            {
+                error = e;
+            }
+        }
+        result->dated++;
+        result->errorSumUs += (error < 0) ? -error : error;
+        if ((error < 0 ? -error : error) > result->errorMaxUs)
+        {
+            result->errorMaxUs = (error < 0) ? -error : error;
+        }
+    }
+    replayPollAt = REPLAY_NEVER;
+}
+
+static void replayRun(const uint8_t *data, size_t size, const replayConfig_t *config, replayResult_t *result)
+{
+    double charUs = 10e6 / config->baudrate;
+    uint32_t half = config->size / 2;
+
+    size_t capacity = size / 64 + 16;
+    double *starts = malloc(capacity * sizeof(double));
+
+    *result = (replayResult_t){ 0 };
+    replayRing = calloc(config->size, 1);
+    replayWritten = 0;
+    replayIdleCount = 0;
+    replayPollAt = REPLAY_NEVER;
+    gpsFeedInit(config->baudrate);
+
+    double t = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (replayIsTime(data, size, i))
+        {
+            /* The next second, or right after the last burst if longer */
+            double jitter = config->jitterUs * (2.0 * rand() / RAND_MAX - 1.0);
+            double second = (result->bursts + 1) * 1e6 + config->delayUs + jitter;
+            if (second > t)
+            {
+                if (result->bursts > 0 && second - t > charUs)
+                {
+                    /* Idle line a character after the last one */
+                    double idle = t + charUs;
+                    while (replayPollAt <= idle)
+                    {
+                        replayPoll(config, starts, result->bursts, result);
+                    }
+                    replayIdleCount++;
+                    replayIdleWritten = replayWritten;
+                    replayIdleTime = idle;
+                    replayEvent(idle, config);
+                }
+                t = second;
+            }
+            if (result->bursts == capacity)
+            {
+                capacity *= 2;
+                starts = realloc(starts, capacity * sizeof(double));
+            }
+            starts[result->bursts++] = t;
+        }
+        else if (data[i] == '$' || (data[i] == UBX_SYNC_0 && i + 1 < size && data[i + 1] == UBX_SYNC_1))
+        {
+            /* Too short for an idle line */
+            t += config->gap * charUs * rand() / RAND_MAX;
+        }
+
+        /* The DMA writes a character when it is complete */
+        t += charUs;
+        while (replayPollAt <= t)
+        {
+            replayPoll(config, starts, result->bursts, result);
+        }
+        replayRing[replayWritten & (config->size - 1)] = data[i];
+        replayWritten++;
+        if (replayWritten % half == 0)
+        {
+            replayEvent(t, config);
+        }
+    }
+
+    /* The last burst */
+    replayIdleCount++;
+    replayIdleWritten = replayWritten;
+    replayIdleTime = t + charUs;
+    replayPoll(config, starts, result->bursts, result);
+
+    free(replayRing);
+    free(starts);
+}
+
+int main(int argc, char **argv)
+{
+    replayConfig_t config = { 9600, 1024, 5000, 50000, 0, 0 };
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        const char *option = argv[first];
+        double value = atof(argv[first + 1]);
+
+        if (strcmp(option, "-b") == 0)
+        {
+            config.baudrate = value;
+        }
+        else if (strcmp(option, "-s") == 0)
+        {
+            config.size = value;
+        }
+        else if (strcmp(option, "-l") == 0)
+        {
+            config.latencyUs = value * 1000;
+        }
+        else if (strcmp(option, "-d") == 0)
+        {
+            config.delayUs = value * 1000;
+        }
+        else if (strcmp(option, "-j") == 0)
+        {
+            config.jitterUs = value * 1000;
+        }
+        else if (strcmp(option, "-g") == 0 && value < 1)
+        {
+            config.gap = value;
+        }
+        else
+        {
+            break;
+        }
+        first += 2;
+    }
+    if (first >= argc || config.baudrate == 0 || config.size < 2 || (config.size & (config.size - 1)) != 0)
+    {
+        fprintf(stderr, "usage: %s [-b baud] [-s ring size] [-l loop latency ms] [-d sentence delay ms] "
+                "[-j jitter ms] [-g gap < 1 character] log...\n", argv[0]);
+        return 2;
+    }
+
+    printf("%lu baud, ring %lu, loop latency up to %.1f ms, time message %.1f +- %.1f ms after the second, gaps up to %.2f "
+           "characters\n", (unsigned long)config.baudrate, (unsigned long)config.size, config.latencyUs / 1000,
+           config.delayUs / 1000, config.jitterUs / 1000, config.gap);
+
+    for (int i = first; i < argc; i++)
+    {
+        size_t size;
+        uint8_t *data = replayLoad(argv[i], &size);
+        if (data == NULL)
+        {
+            return 1;
+        }
+
+        replayResult_t result;
+        replayRun(data, size, &config, &result);
+
+        gpsFeedStat_t feed;
+        nmeaStat_t nmea;
+        ubxStat_t ubx;
+        gpsFeedGetStat(&feed);
+        nmeaGetStat(&nmea);
+        ubxTimeGetStat(&ubx);
+
+        printf("%s: %zu bytes, %lu bursts\n", argv[i], size, (unsigned long)result.bursts);
+        printf("  sentences: %lu decoded, %lu other, %lu checksum, %lu too long\n",
+               (unsigned long)nmea.sentences, (unsigned long)nmea.ignored,
+               (unsigned long)nmea.checksum, (unsigned long)nmea.overflows);
+        printf("  UBX: %lu decoded, %lu other, %lu checksum, %lu too long\n",
+               (unsigned long)ubx.frames, (unsigned long)ubx.ignored,
+               (unsigned long)ubx.checksum, (unsigned long)ubx.overflows);
+        printf("  feed: %lu bytes, %lu overwritten, %lu idle lines, %lu missed\n", (unsigned long)feed.bytes,
+               (unsigned long)feed.lost, (unsigned long)feed.idles, (unsigned long)feed.idlesMissed);
+        printf("  time message start: %lu of %lu dated, error mean %.1f us, max %.1f us\n", (unsigned long)result.dated,
+               (unsigned long)result.time, result.dated ? result.errorSumUs / result.dated : 0.0, result.errorMaxUs);
+        printf("  cpu: %.2f ns per character, %.2f us per fix\n", feed.bytes ? result.cpu * 1e9 / feed.bytes : 0.0,
+               result.time ? result.cpu * 1e6 / result.time : 0.0);
+        free(data);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef __CMSIS_DEVICE_H
+#define __CMSIS_DEVICE_H
+
+/* Stands in for the CMSIS device header when the tools build modules on
+   the host. The core registers and intrinsics the modules use are
+   declared here and provided by the tool, which decides what time and
+   interrupts do. */
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+    volatile uint16_t CR1;
+    volatile uint16_t DIER;
+    volatile uint16_t SR;
+    volatile uint16_t CNT;
+    volatile uint16_t CCR1;
+    volatile uint16_t CCR2;
+} TIM_TypeDef;
+
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+#define TIM_SR_UIF                      ((uint16_t)0x0001)
+#define TIM_SR_CC1IF                    ((uint16_t)0x0002)
+#define TIM_SR_CC2IF                    ((uint16_t)0x0004)
+
+extern DWT_Type hostDWT;
+extern CoreDebug_Type hostCoreDebug;
+extern TIM_TypeDef hostTIM2;
+extern uint32_t SystemCoreClock;
+
+#define DWT         (&hostDWT)
+#define CoreDebug   (&hostCoreDebug)
+#define TIM2        (&hostTIM2)
+
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+uint32_t __LDREXW(volatile uint32_t *addr);
+uint32_t __STREXW(uint32_t value, volatile uint32_t *addr);
+
+#endif // __CMSIS_DEVICE_H
@@ -0,0 +1,8 @@
+#ifndef CORTEXM_EXCEPTION_HANDLERS_H_
+#define CORTEXM_EXCEPTION_HANDLERS_H_
+
+/* Stands in for the exception handler declarations of the startup code
+   when the tools build modules on the host. The handlers are plain
+   functions there, called by the tool. */
+
+#endif // CORTEXM_EXCEPTION_HANDLERS_H_
@@ -0,0 +1,29 @@
+#ifndef __PLATFORM_CONFIG_H
+#define __PLATFORM_CONFIG_H
+
+/* Stands in for include/platform_config.h when the tools build modules on
+   the host, with -Itools/host ahead of -Iinclude. Headers directly in
+   include/ find the real one next to them first, tools that use them
+   force this one in with -include. Only what those modules use is here,
+   the values follow the target configuration. */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f10x_conf.h"
+
+#define CFG_TIMER_TICKLESS
+
+#define CFG_EEPROM_TZ_STD       (uint16_t)0x0010
+#define CFG_EEPROM_TZ_DST       (uint16_t)0x0020
+#define CFG_EEPROM_TZ_ZONES     (uint16_t)0x0050
+#define CFG_EEPROM_TZ_ZONE(n)   (uint16_t)(CFG_EEPROM_TZ_ZONES + ((n) - 1) * 0x10)
+
+#define CFG_TZ_ZONES            (4)
+
+/* Flash and EEPROM emulation, provided by the tool */
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+uint16_t EE_WriteVariable(uint16_t VirtAddress, uint16_t Data);
+uint16_t EE_ReadVariable(uint16_t VirtAddress, uint16_t *Data);
+
+#endif // __PLATFORM_CONFIG_H
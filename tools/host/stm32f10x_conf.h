@@ -0,0 +1,143 @@
+#ifndef __STM32F10x_CONF_H
+#define __STM32F10x_CONF_H
+
+/* Stands in for the StdPeriph configuration when the tools build modules
+   on the host. The peripheral functions the modules call are declared
+   here and implemented by the tool on its register model. */
+#include "cmsis_device.h"
+
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+typedef enum
+{
+    RTC_IRQn = 3,
+    TIM2_IRQn = 28
+} IRQn_Type;
+
+typedef struct
+{
+    uint8_t NVIC_IRQChannel;
+    uint8_t NVIC_IRQChannelPreemptionPriority;
+    uint8_t NVIC_IRQChannelSubPriority;
+    FunctionalState NVIC_IRQChannelCmd;
+} NVIC_InitTypeDef;
+
+typedef struct
+{
+    uint32_t SYSCLK_Frequency;
+    uint32_t HCLK_Frequency;
+    uint32_t PCLK1_Frequency;
+    uint32_t PCLK2_Frequency;
+    uint32_t ADCCLK_Frequency;
+} RCC_ClocksTypeDef;
+
+typedef enum
+{
+    GPIO_Speed_10MHz = 1,
+    GPIO_Speed_2MHz,
+    GPIO_Speed_50MHz
+} GPIOSpeed_TypeDef;
+
+typedef enum
+{
+    GPIO_Mode_IN_FLOATING = 0x04,
+    GPIO_Mode_IPD = 0x28
+} GPIOMode_TypeDef;
+
+typedef struct
+{
+    uint16_t GPIO_Pin;
+    GPIOSpeed_TypeDef GPIO_Speed;
+    GPIOMode_TypeDef GPIO_Mode;
+} GPIO_InitTypeDef;
+
+typedef struct
+{
+    uint16_t TIM_Prescaler;
+    uint16_t TIM_CounterMode;
+    uint16_t TIM_Period;
+    uint16_t TIM_ClockDivision;
+    uint8_t TIM_RepetitionCounter;
+} TIM_TimeBaseInitTypeDef;
+
+typedef struct
+{
+    uint16_t TIM_Channel;
+    uint16_t TIM_ICPolarity;
+    uint16_t TIM_ICSelection;
+    uint16_t TIM_ICPrescaler;
+    uint16_t TIM_ICFilter;
+} TIM_ICInitTypeDef;
+
+/* The GPIO port is never touched by the tools, only its address passed */
+typedef struct GPIO_TypeDef GPIO_TypeDef;
+#define GPIOA                       ((GPIO_TypeDef *)0)
+#define GPIO_Pin_1                  ((uint16_t)0x0002)
+
+#define NVIC_PriorityGroup_1        ((uint32_t)0x600)
+
+#define RCC_APB1Periph_TIM2         ((uint32_t)0x00000001)
+#define RCC_APB1Periph_BKP          ((uint32_t)0x08000000)
+#define RCC_APB1Periph_PWR          ((uint32_t)0x10000000)
+#define RCC_FLAG_LSERDY             ((uint8_t)0x41)
+#define RCC_FLAG_PINRST             ((uint8_t)0x7A)
+#define RCC_FLAG_PORRST             ((uint8_t)0x7B)
+#define RCC_LSE_ON                  ((uint8_t)0x01)
+#define RCC_RTCCLKSource_LSE        ((uint32_t)0x00000100)
+#define RCC_APB2Periph_GPIOA        ((uint32_t)0x00000004)
+
+#define TIM_CounterMode_Up          ((uint16_t)0x0000)
+#define TIM_IT_Update               ((uint16_t)0x0001)
+#define TIM_IT_CC1                  ((uint16_t)0x0002)
+#define TIM_IT_CC2                  ((uint16_t)0x0004)
+#define TIM_Channel_2               ((uint16_t)0x0004)
+#define TIM_ICPolarity_Rising       ((uint16_t)0x0000)
+#define TIM_ICSelection_DirectTI    ((uint16_t)0x0001)
+#define TIM_ICPSC_DIV1              ((uint16_t)0x0000)
+
+#define RTC_IT_SEC                  ((uint16_t)0x0001)
+
+#define BKP_DR1                     ((uint16_t)0x0004)
+
+void NVIC_PriorityGroupConfig(uint32_t NVIC_PriorityGroup);
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct);
+
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState);
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+void RCC_GetClocksFreq(RCC_ClocksTypeDef *RCC_Clocks);
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG);
+void RCC_ClearFlag(void);
+void RCC_LSEConfig(uint8_t RCC_LSE);
+void RCC_RTCCLKConfig(uint32_t RCC_RTCCLKSource);
+void RCC_RTCCLKCmd(FunctionalState NewState);
+
+void PWR_BackupAccessCmd(FunctionalState NewState);
+
+uint16_t BKP_ReadBackupRegister(uint16_t BKP_DR);
+void BKP_WriteBackupRegister(uint16_t BKP_DR, uint16_t Data);
+
+void RTC_ITConfig(uint16_t RTC_IT, FunctionalState NewState);
+uint32_t RTC_GetCounter(void);
+void RTC_SetCounter(uint32_t CounterValue);
+void RTC_SetPrescaler(uint32_t PrescalerValue);
+uint32_t RTC_GetDivider(void);
+void RTC_WaitForLastTask(void);
+void RTC_WaitForSynchro(void);
+ITStatus RTC_GetITStatus(uint16_t RTC_IT);
+void RTC_ClearITPendingBit(uint16_t RTC_IT);
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_InitStruct);
+
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_ICStructInit(TIM_ICInitTypeDef *TIM_ICInitStruct);
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct);
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState);
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState);
+ITStatus TIM_GetITStatus(TIM_TypeDef *TIMx, uint16_t TIM_IT);
+void TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t TIM_IT);
+void TIM_SetCompare1(TIM_TypeDef *TIMx, uint16_t Compare1);
+uint16_t TIM_GetCapture2(TIM_TypeDef *TIMx);
+
+#endif // __STM32F10x_CONF_H
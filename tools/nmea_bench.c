@@ -0,0 +1,185 @@
+/**************************************************************************/
+/*!
+    @file     nmea_bench.c
+
+    @brief    Feeds NMEA logs to the parser on the host and reports the
+              sentences decoded, those dropped and why, jumps of the RMC
+              time and the throughput.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Iinclude tools/nmea_bench.c src/rtc/nmea.c -o nmea_bench
+
+    A log is the raw receiver output, a recording or a file from
+    tools/nmea_gen.py. With -r the logs are parsed repeatedly for the
+    timing, -v prints every RMC.
+*/
+/**************************************************************************/
+
+#include "rtc/nmea.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct
+{
+    uint32_t rmc;
+    uint32_t rmcValid;
+    uint32_t zda;
+    uint32_t gga;
+    uint32_t jumps;             /**< Valid RMC not a second after the last */
+    uint32_t mismatch;          /**< ZDA not the time of the RMC before */
+} benchResult_t;
+
+static uint8_t *benchLoad(const char *name, size_t *size);
+static void benchRun(const uint8_t *data, size_t size, benchResult_t *result, bool verbose);
+static int32_t benchSeconds(const nmeaTime_t *t);
+
+
+static uint8_t *benchLoad(const char *name, size_t *size)
+{
+    FILE *f = fopen(name, "rb");
+    if (f == NULL)
+    {
+        perror(name);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = malloc(length > 0 ? length : 1);
+    *size = fread(data, 1, length, f);
+    fclose(f);
+    return data;
+}
+
+static int32_t benchSeconds(const nmeaTime_t *t)
+{
+    return (t->hour * 60 + t->minute) * 60 + t->second;
+}
+
+static void benchRun(const uint8_t *data, size_t size, benchResult_t *result, bool verbose)
+{
+    nmeaRmc_t rmc;
+    nmeaRmc_t last = { 0 };
+    nmeaZda_t zda;
+
+    *result = (benchResult_t){ 0 };
+    nmeaInit();
+
+    for (size_t i = 0; i < size; i++)
+    {
+        switch (nmeaRx(data[i]))
+        {
+        case NMEA_RMC:
+            result->rmc++;
+            nmeaGetRmc(&rmc);
+            if (verbose)
+            {
+                printf("RMC %02u:%02u:%02u.%03u %02u.%02u.%02u %s %ld %ld\n", rmc.time.hour, rmc.time.minute,
+                       rmc.time.second, rmc.time.millis, rmc.day, rmc.month, rmc.year, rmc.valid ? "valid" : "invalid",
+                       (long)rmc.latitude, (long)rmc.longitude);
+            }
+            if (!rmc.valid)
+            {
+                break;
+            }
+            if (last.valid && (benchSeconds(&rmc.time) - benchSeconds(&last.time) + 86400) % 86400 != 1)
+            {
+                result->jumps++;
+            }
+            result->rmcValid++;
+            last = rmc;
+            break;
+
+        case NMEA_ZDA:
+            result->zda++;
+            nmeaGetZda(&zda);
+            if (zda.valid && last.valid && (benchSeconds(&zda.time) != benchSeconds(&last.time)
+                                            || zda.day != last.day || zda.month != last.month))
+            {
+                result->mismatch++;
+            }
+            break;
+
+        case NMEA_GGA:
+            result->gga++;
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool verbose = false;
+    int repeat = 1;
+    int first = 1;
+
+    while (first < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (strcmp(argv[first], "-r") == 0 && first + 1 < argc)
+        {
+            repeat = atoi(argv[++first]);
+        }
+        else
+        {
+            break;
+        }
+        first++;
+    }
+    if (first >= argc || repeat < 1)
+    {
+        fprintf(stderr, "usage: %s [-v] [-r repeat] log...\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t bytes = 0;
+    double cpu = 0;
+
+    for (int i = first; i < argc; i++)
+    {
+        size_t size;
+        uint8_t *data = benchLoad(argv[i], &size);
+        if (data == NULL)
+        {
+            return 1;
+        }
+
+        /* Repeated for the timing, the result is the same each time */
+        benchResult_t result;
+        nmeaStat_t stat;
+        clock_t start = clock();
+        for (int r = 0; r < repeat; r++)
+        {
+            benchRun(data, size, &result, verbose && r == 0);
+        }
+        cpu += (double)(clock() - start) / CLOCKS_PER_SEC;
+        bytes += (uint64_t)size * repeat;
+        nmeaGetStat(&stat);
+
+        printf("%s: %zu bytes\n", argv[i], size);
+        printf("  decoded: %lu RMC (%lu valid), %lu GGA, %lu ZDA, %lu other\n", (unsigned long)result.rmc,
+               (unsigned long)result.rmcValid, (unsigned long)result.gga, (unsigned long)result.zda,
+               (unsigned long)stat.ignored);
+        printf("  dropped: %lu checksum, %lu too long, %lu bad field\n", (unsigned long)stat.checksum,
+               (unsigned long)stat.overflows, (unsigned long)stat.fields);
+        printf("  RMC time jumps: %lu, ZDA not matching RMC: %lu\n", (unsigned long)result.jumps,
+               (unsigned long)result.mismatch);
+        free(data);
+    }
+
+    printf("cpu: %.2f ns per character, %.1f MB/s (%llu characters)\n", bytes ? cpu * 1e9 / bytes : 0.0,
+           cpu > 0 ? bytes / cpu / 1e6 : 0.0, (unsigned long long)bytes);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Generates synthetic NMEA logs for tools/nmea_bench.c.
+
+Every second holds the sentences of a typical receiver: RMC, GGA, GSA,
+three GSV and ZDA, with a GPS or a GNSS talker. With --ubx it holds the
+UBX NAV-TIMEUTC and TIM-TP frames of a receiver switched by 'gps_ubx on'
+instead. Characters can be corrupted or lost to exercise the checksum
+and the resynchronisation:
+
+    nmea_gen.py --seconds 20000 --errors 1e-4 --out gps.nmea
+    nmea_bench gps.nmea
+    nmea_gen.py --seconds 20000 --ubx --out gps.ubx
+    gps_replay gps.nmea gps.ubx
+"""
+
+import argparse
+import datetime
+import functools
+import operator
+import random
+import struct
+
+
+def sentence(body):
+    return "$%s*%02X\r\n" % (body, functools.reduce(operator.xor, body.encode(), 0))
+
+
+def frame(cls, msg, payload):
+    body = struct.pack("<BBH", cls, msg, len(payload)) + payload
+    a = b = 0
+    for c in body:
+        a = (a + c) & 0xFF
+        b = (b + a) & 0xFF
+    return b"\xb5\x62" + body + bytes((a, b))
+
+
+def degrees(value, digits, hemispheres):
+    hemisphere = hemispheres[0] if value >= 0 else hemispheres[1]
+    value = abs(value)
+    d = int(value)
+    return "%0*d%08.5f" % (digits, d, (value - d) * 60), hemisphere
+
+
+def epoch(t, talker, lat, lon, fix):
+    hms = t.strftime("%H%M%S") + ".00"
+    la, ns = degrees(lat, 2, "NS")
+    lo, ew = degrees(lon, 3, "EW")
+    out = [
+        sentence("%sRMC,%s,%s,%s,%s,%s,%s,0.012,,%s,,,%s" % (talker, hms, "A" if fix else "V", la, ns, lo, ew,
+                                                           t.strftime("%d%m%y"), "A" if fix else "N")),
+        sentence("%sGGA,%s,%s,%s,%s,%s,%d,09,0.98,45.3,M,47.9,M,," % (talker, hms, la, ns, lo, ew, 1 if fix else 0)),
+        sentence("%sGSA,A,3,05,07,09,13,16,20,26,27,30,,,,1.63,0.98,1.30" % talker),
+    ]
+    for n in range(3):
+        sats = ",".join("%02d,%02d,%03d,%02d" % (1 + n * 4 + i, 10 + i * 15, (n * 90 + i * 40) % 360, 20 + i * 5)
+                        for i in range(4))
+        out.append(sentence("GPGSV,3,%d,12,%s" % (n + 1, sats)))
+    out.append(sentence("%sZDA,%s,%s,%s,%s,00,00" % (talker, hms, t.strftime("%d"), t.strftime("%m"), t.strftime("%Y"))))
+    return "".join(out)
+
+
+def epoch_ubx(t, rng, fix):
+    """NAV-TIMEUTC of the second and TIM-TP of the next pulse"""
+    gps = t + datetime.timedelta(seconds=18) - datetime.datetime(1980, 1, 6)
+    week, tow = divmod(int(gps.total_seconds()), 7 * 86400)
+    timeutc = struct.pack("<IIiHBBBBBB", tow * 1000, rng.randint(15, 40) if fix else 0xFFFFFFFF,
+                          rng.randint(-200, 200) if fix else 0, t.year, t.month, t.day, t.hour, t.minute, t.second,
+                          0x07 if fix else 0x03)
+    tp = struct.pack("<IIiHBB", (tow + 1) * 1000, 0, rng.randint(-5000, 5000), week, 0x03, 0)
+    return frame(0x01, 0x21, timeutc) + frame(0x0D, 0x01, tp)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--seconds", type=int, default=10000, help="epochs, about 520 bytes each")
+    parser.add_argument("--errors", type=float, default=0.0, help="probability of a corrupted character")
+    parser.add_argument("--drops", type=float, default=0.0, help="probability of a lost character")
+    parser.add_argument("--talker", choices=("GP", "GN"), default="GN")
+    parser.add_argument("--ubx", action="store_true", help="UBX NAV-TIMEUTC and TIM-TP instead of NMEA")
+    parser.add_argument("--start", default="2026-10-16 17:15:00", help="UTC of the first epoch")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--out", default="gps.nmea")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    t = datetime.datetime.strptime(args.start, "%Y-%m-%d %H:%M:%S")
+    lat, lon = 52.520008, 13.404954
+
+    with open(args.out, "wb") as f:
+        for s in range(args.seconds):
+            if args.ubx:
+                text = bytearray(epoch_ubx(t + datetime.timedelta(seconds=s), rng, s >= 5))
+            else:
+                text = bytearray(epoch(t + datetime.timedelta(seconds=s), args.talker,
+                                       lat + rng.gauss(0, 1e-5), lon + rng.gauss(0, 1e-5), s >= 5).encode())
+            if args.errors > 0 or args.drops > 0:
+                out = bytearray()
+                for c in text:
+                    r = rng.random()
+                    if r < args.drops:
+                        continue
+                    if r < args.drops + args.errors:
+                        c = rng.randrange(32, 127)
+                    out.append(c)
+                text = out
+            f.write(text)
+
+
+if __name__ == "__main__":
+    main()
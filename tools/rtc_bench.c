@@ -0,0 +1,271 @@
+/**************************************************************************/
+/*!
+    @file     rtc_bench.c
+
+    @brief    Checks the epoch conversion of rtc_functions.c on the host
+              against the Julian day chain it replaced and compares their
+              speed, and checks the second ticker against the conversion.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Itools/host -Iinclude tools/rtc_bench.c src/rtc/rtc_functions.c -o rtc_bench
+
+    Every day of the epoch range is converted both ways at a time of day
+    that changes from day to day, with the weekday, the inverse and the
+    round trip, and every second of a few days around 2000 and 2038. The
+    timing converts a spread of epochs repeatedly, -r sets the rounds.
+
+    rtcTickSecond then runs from 1970 to the end of the range, every month,
+    year and leap day included, and is compared with the conversion at
+    every minute and every 61 seconds. -t skips that part, it takes a few
+    seconds.
+*/
+/**************************************************************************/
+
+#include "rtc/rtc_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DAYS      (RTC_MAX_EPOCH_TIME / 86400 + 1)
+
+static void benchOldFromEpoch(uint32_t epochTime, rtcTime_t *time);
+static uint32_t benchOldEpochDate(uint32_t year, uint8_t month, uint8_t day);
+static uint32_t benchCompare(uint32_t epochTime);
+static uint32_t benchCheck(void);
+static void benchTime(uint32_t rounds);
+static uint32_t benchTick(void);
+
+
+/* The Julian day chain rtcCreateTimeFromEpoch used before */
+static void benchOldFromEpoch(uint32_t epochTime, rtcTime_t *time)
+{
+    int32_t j, g, dg, c, dc, b, db, a, da, y, m, d;
+
+    j = epochTime / 86400 + 2472632;
+    g = j / 146097;
+    dg = j % 146097;
+    c = (dg / 36524 + 1) * 3 / 4;
+    dc = dg - c * 36524;
+    b = dc / 1461;
+    db = dc % 1461;
+    a = (db / 365 + 1) * 3 / 4;
+    da = db - a * 365;
+    y = g * 400 + c * 100 + b * 4 + a;
+    m = (da * 5 + 308) / 153 - 2;
+    d = da - (m + 4) * 153 / 5 + 122;
+    time->years = y - 6700 + (m + 2) / 12;
+    time->months = (m + 2) % 12 + 1;
+    time->days = d + 1;
+    time->weekdays = (j + 2) % 7;
+
+    j = epochTime % 86400;
+    time->hours = j / 3600;
+    time->minutes = (j % 3600) / 60;
+    time->seconds = j % 60;
+    time->timezone = 0;
+}
+
+/* The Julian day formula rtcGetEpochDate used before */
+static uint32_t benchOldEpochDate(uint32_t year, uint8_t month, uint8_t day)
+{
+    int32_t y = year;
+    int32_t m = month;
+
+    return (1461 * (y + 6700 + (m - 14) / 12)) / 4 + (367 * (m - 2 - 12 * ((m - 14) / 12))) / 12 -
+           (3 * ((y + 6800 + (m - 14) / 12) / 100)) / 4 + day - 2472663;
+}
+
+/* Mismatches of one epoch, printed for the first few */
+static uint32_t benchCompare(uint32_t epochTime)
+{
+    static uint32_t printed;
+    rtcTime_t t;
+    rtcTime_t old;
+    rtcWeekdays_t weekday;
+
+    memset(&t, 0, sizeof(t));
+    memset(&old, 0, sizeof(old));
+    if (rtcCreateTimeFromEpoch(epochTime, &t) != ERROR_NONE)
+    {
+        printf("  %lu: rejected\n", (unsigned long)epochTime);
+        return 1;
+    }
+    benchOldFromEpoch(epochTime, &old);
+    rtcGetWeekday(t.years, t.months, t.days, &weekday);
+
+    uint32_t day = epochTime / 86400;
+    uint32_t errors = 0;
+    errors += (memcmp(&t, &old, sizeof(t)) != 0);
+    errors += (weekday != t.weekdays);
+    errors += (rtcGetEpochDate(t.years, t.months, t.days) != day);
+    errors += (benchOldEpochDate(t.years, t.months, t.days) != day);
+    errors += (rtcToEpochTime(&t) != epochTime);
+
+    if (errors > 0 && printed++ < 10)
+    {
+        printf("  %lu: %04u-%02u-%02u %02u:%02u:%02u wd %u, before %04u-%02u-%02u %02u:%02u:%02u wd %u\n",
+               (unsigned long)epochTime, t.years + 1900, t.months, t.days, t.hours, t.minutes, t.seconds,
+               t.weekdays, old.years + 1900, old.months, old.days, old.hours, old.minutes, old.seconds,
+               old.weekdays);
+    }
+    return (errors > 0);
+}
+
+static uint32_t benchCheck()
+{
+    static const uint32_t seconds[] = { 946598400, 951609600, 2147299200 };
+    uint32_t mismatches = 0;
+    uint32_t checked = 0;
+
+    for (uint32_t day = 0; day < BENCH_DAYS; day++)
+    {
+        uint32_t epochTime = day * 86400 + (day * 7919) % 86400;
+        if (epochTime > RTC_MAX_EPOCH_TIME)
+        {
+            epochTime = RTC_MAX_EPOCH_TIME;
+        }
+        mismatches += benchCompare(epochTime);
+        checked++;
+    }
+
+    /* 30 Dec 1999, 27 Feb 2000 and the last days of the range */
+    for (uint32_t i = 0; i < sizeof(seconds) / sizeof(seconds[0]); i++)
+    {
+        for (uint32_t s = 0; s < 3 * 86400 && seconds[i] + s <= RTC_MAX_EPOCH_TIME; s++)
+        {
+            mismatches += benchCompare(seconds[i] + s);
+            checked++;
+        }
+    }
+
+    printf("conversion: %lu epochs, %lu mismatches\n", (unsigned long)checked, (unsigned long)mismatches);
+    return mismatches;
+}
+
+static void benchTime(uint32_t rounds)
+{
+    volatile uint32_t sink = 0;
+    rtcTime_t t;
+    clock_t start;
+    double fromNew, fromOld, dateNew, dateOld;
+    double calls = (double)rounds * BENCH_DAYS;
+
+    /* 86400 + 7 seconds apart, so the time of day changes as well */
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t day = 0; day < BENCH_DAYS - 1; day++)
+        {
+            rtcCreateTimeFromEpoch(day * 86407u, &t);
+            sink += t.days;
+        }
+    }
+    fromNew = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t day = 0; day < BENCH_DAYS - 1; day++)
+        {
+            benchOldFromEpoch(day * 86407u, &t);
+            sink += t.days;
+        }
+    }
+    fromOld = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t day = 0; day < BENCH_DAYS - 1; day++)
+        {
+            sink += rtcGetEpochDate(70 + (day & 63), 1 + day % 12, 1 + (day & 15));
+        }
+    }
+    dateNew = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t day = 0; day < BENCH_DAYS - 1; day++)
+        {
+            sink += benchOldEpochDate(70 + (day & 63), 1 + day % 12, 1 + (day & 15));
+        }
+    }
+    dateOld = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("rtcCreateTimeFromEpoch: %.2f ns, Julian day chain %.2f ns\n", fromNew * 1e9 / calls, fromOld * 1e9 / calls);
+    printf("rtcGetEpochDate: %.2f ns, Julian day formula %.2f ns\n", dateNew * 1e9 / calls, dateOld * 1e9 / calls);
+    (void)sink;
+}
+
+/* Mismatches of the ticker, printed for the first few */
+static uint32_t benchTick()
+{
+    rtcTime_t t;
+    rtcTime_t expected;
+    uint32_t mismatches = 0;
+    uint32_t checked = 0;
+
+    clock_t start = clock();
+    rtcCreateTimeFromEpoch(0, &t);
+    for (uint32_t epochTime = 1; epochTime <= RTC_MAX_EPOCH_TIME; epochTime++)
+    {
+        rtcTickSecond(&t);
+        if (t.seconds != 0 && epochTime % 61 != 0)
+        {
+            continue;
+        }
+
+        checked++;
+        rtcCreateTimeFromEpoch(epochTime, &expected);
+        if (memcmp(&t, &expected, sizeof(t)) != 0)
+        {
+            if (mismatches++ < 10)
+            {
+                printf("  %lu: ticked %04u-%02u-%02u %02u:%02u:%02u wd %u\n", (unsigned long)epochTime,
+                       t.years + 1900, t.months, t.days, t.hours, t.minutes, t.seconds, t.weekdays);
+            }
+            t = expected;
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("ticker: %lu seconds, %lu compared, %lu mismatches, %.2f ns per tick with the checks\n",
+           (unsigned long)RTC_MAX_EPOCH_TIME, (unsigned long)checked, (unsigned long)mismatches,
+           seconds * 1e9 / RTC_MAX_EPOCH_TIME);
+    return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = 500;
+    bool tick = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            rounds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0)
+        {
+            tick = false;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-r rounds] [-t]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint32_t mismatches = benchCheck();
+    benchTime(rounds);
+    if (tick)
+    {
+        mismatches += benchTick();
+    }
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,435 @@
+/**************************************************************************/
+/*!
+    @file     rtc_model.c
+
+    @brief    Runs rtc.c on the host against a model of the RTC counter,
+              prescaler and divider registers, for the coherent read of
+              rtcGetPrecise and the shortened second of rtcSetPrecise.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Itools/host -Iinclude tools/rtc_model.c src/rtc/rtc.c -o rtc_model
+
+    The model follows the reference manual: the divider counts down from
+    the prescaler value once per LSE tick, its reload increments the
+    counter and sets the second flag, and it is reloaded whenever the
+    counter or the prescaler is written. A write takes effect on the third
+    LSE tick after it, as RTOFF shows. Every register access moves the
+    time on by a cost, the 16 bit halves of the counter and divider are
+    separate accesses. The second interrupt preempts at the next access.
+
+    The reads start a few thousand ticks before the counter carries from
+    CNTL to CNTH and run at access costs from a fraction of a tick to half
+    a tick. Each result must lie between the time before and after the
+    call, a single read without the repeat is counted for comparison.
+
+    The sets take a point in time and the ticks elapsed in its second and
+    measure where the next three second boundaries land against where
+    they should be. The cost of the set is taken from rtcGetStat.
+*/
+/**************************************************************************/
+
+#include "rtc/rtc.h"
+#include "stm32f10x_conf.h"
+#include "event.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Time in 1/65536 LSE ticks */
+#define MODEL_TICK          (65536)
+#define MODEL_WRITE_TICKS   (3)
+#define MODEL_CYCLES_PER_S  (72000000)
+
+typedef struct
+{
+    uint64_t time;              /**< Now */
+    uint64_t edges;             /**< LSE ticks processed */
+    uint32_t cost;              /**< Time of one register access */
+    uint32_t accesses;
+
+    uint32_t cnt;
+    uint32_t div;
+    uint32_t prl;
+    bool secf;
+    bool itSec;
+
+    bool pending;               /**< Write waiting for its tick, RTOFF = 0 */
+    bool pendingCnt;
+    uint32_t pendingValue;
+    uint64_t pendingEdge;
+    uint32_t writeErrors;       /**< Writes while busy or without backup access */
+
+    bool backupAccess;
+    bool irqEnabled;
+    bool inIsr;
+    uint16_t bkp[11];
+
+    uint64_t boundaries[3];     /**< Edge of each counter increment */
+    uint32_t boundaryCount;
+} model_t;
+
+static model_t model;
+
+DWT_Type hostDWT;
+CoreDebug_Type hostCoreDebug;
+uint32_t SystemCoreClock = MODEL_CYCLES_PER_S;
+
+void RTC_IRQHandler(void);
+
+static void modelEdge(void);
+static void modelAdvance(uint64_t time);
+static void modelAccess(void);
+static void modelIdle(uint32_t ticks);
+static void modelWrite(bool cnt, uint32_t value);
+static uint64_t modelNow(void);
+static void modelReset(uint32_t cnt, uint32_t div, uint32_t cost);
+static uint32_t modelReads(void);
+static void modelSets(void);
+
+
+/* One LSE tick: the divider, then a write due at this tick */
+static void modelEdge()
+{
+    model.edges++;
+    if (model.div == 0)
+    {
+        model.div = model.prl;
+        model.cnt++;
+        model.secf = true;
+        if (model.boundaryCount < 3)
+        {
+            model.boundaries[model.boundaryCount++] = model.edges;
+        }
+    }
+    else
+    {
+        model.div--;
+    }
+
+    if (model.pending && (model.edges >= model.pendingEdge))
+    {
+        if (model.pendingCnt)
+        {
+            model.cnt = model.pendingValue;
+        }
+        else
+        {
+            model.prl = model.pendingValue;
+        }
+        model.div = model.prl;
+        model.pending = false;
+    }
+}
+
+/* Runs the time on, the second interrupt comes in right after */
+static void modelAdvance(uint64_t time)
+{
+    model.time += time;
+    while (model.edges < model.time / MODEL_TICK)
+    {
+        modelEdge();
+    }
+    hostDWT.CYCCNT = (uint32_t)(model.time * MODEL_CYCLES_PER_S / RTC_TICKS_PER_SECOND / MODEL_TICK);
+
+    if (model.secf && model.itSec && model.irqEnabled && !model.inIsr)
+    {
+        model.inIsr = true;
+        RTC_IRQHandler();
+        model.inIsr = false;
+    }
+}
+
+static void modelAccess()
+{
+    model.accesses++;
+    modelAdvance(model.cost);
+}
+
+static void modelIdle(uint32_t ticks)
+{
+    for (uint32_t i = 0; i < ticks; i++)
+    {
+        modelAdvance(MODEL_TICK);
+    }
+}
+
+static void modelWrite(bool cnt, uint32_t value)
+{
+    /* CNF on, two halves, CNF off */
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        modelAccess();
+    }
+    if (model.pending || !model.backupAccess)
+    {
+        model.writeErrors++;
+    }
+    model.pending = true;
+    model.pendingCnt = cnt;
+    model.pendingValue = value;
+    model.pendingEdge = model.edges + MODEL_WRITE_TICKS;
+}
+
+/* Seconds and ticks as the registers hold them, in ticks */
+static uint64_t modelNow()
+{
+    return (uint64_t)model.cnt * RTC_TICKS_PER_SECOND + (model.prl - model.div);
+}
+
+static void modelReset(uint32_t cnt, uint32_t div, uint32_t cost)
+{
+    memset(&model, 0, sizeof(model));
+    model.cnt = cnt;
+    model.div = div;
+    model.prl = RTC_TICKS_PER_SECOND - 1;
+    model.cost = cost;
+    model.irqEnabled = true;
+}
+
+void __disable_irq(void)
+{
+    model.irqEnabled = false;
+}
+
+void __enable_irq(void)
+{
+    model.irqEnabled = true;
+}
+
+void eventPost(uint32_t events)
+{
+    (void)events;
+}
+
+void NVIC_PriorityGroupConfig(uint32_t NVIC_PriorityGroup)
+{
+    (void)NVIC_PriorityGroup;
+}
+
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct)
+{
+    (void)NVIC_InitStruct;
+}
+
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState)
+{
+    (void)RCC_APB1Periph;
+    (void)NewState;
+}
+
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG)
+{
+    return (RCC_FLAG == RCC_FLAG_LSERDY) ? SET : RESET;
+}
+
+void RCC_ClearFlag(void)
+{
+}
+
+void RCC_LSEConfig(uint8_t RCC_LSE)
+{
+    (void)RCC_LSE;
+}
+
+void RCC_RTCCLKConfig(uint32_t RCC_RTCCLKSource)
+{
+    (void)RCC_RTCCLKSource;
+}
+
+void RCC_RTCCLKCmd(FunctionalState NewState)
+{
+    (void)NewState;
+}
+
+void PWR_BackupAccessCmd(FunctionalState NewState)
+{
+    model.backupAccess = (NewState == ENABLE);
+}
+
+uint16_t BKP_ReadBackupRegister(uint16_t BKP_DR)
+{
+    return model.bkp[BKP_DR / 4];
+}
+
+void BKP_WriteBackupRegister(uint16_t BKP_DR, uint16_t Data)
+{
+    if (!model.backupAccess)
+    {
+        model.writeErrors++;
+    }
+    model.bkp[BKP_DR / 4] = Data;
+}
+
+void RTC_ITConfig(uint16_t RTC_IT, FunctionalState NewState)
+{
+    modelAccess();
+    if (RTC_IT == RTC_IT_SEC)
+    {
+        model.itSec = (NewState == ENABLE);
+    }
+}
+
+/* CNTL first, as the library reads it */
+uint32_t RTC_GetCounter(void)
+{
+    modelAccess();
+    uint16_t low = model.cnt & 0xFFFF;
+    modelAccess();
+    uint16_t high = model.cnt >> 16;
+    return ((uint32_t)high << 16) | low;
+}
+
+void RTC_SetCounter(uint32_t CounterValue)
+{
+    modelWrite(true, CounterValue);
+}
+
+void RTC_SetPrescaler(uint32_t PrescalerValue)
+{
+    modelWrite(false, PrescalerValue);
+}
+
+uint32_t RTC_GetDivider(void)
+{
+    modelAccess();
+    uint32_t high = (model.div >> 16) & 0x000F;
+    modelAccess();
+    return (high << 16) | (model.div & 0xFFFF);
+}
+
+void RTC_WaitForLastTask(void)
+{
+    do
+    {
+        modelAccess();
+    }
+    while (model.pending);
+}
+
+void RTC_WaitForSynchro(void)
+{
+    modelAccess();
+}
+
+ITStatus RTC_GetITStatus(uint16_t RTC_IT)
+{
+    modelAccess();
+    return (RTC_IT == RTC_IT_SEC && model.secf && model.itSec) ? SET : RESET;
+}
+
+void RTC_ClearITPendingBit(uint16_t RTC_IT)
+{
+    modelAccess();
+    if (RTC_IT == RTC_IT_SEC)
+    {
+        model.secf = false;
+    }
+}
+
+/* Incoherent reads of rtcGetPrecise */
+static uint32_t modelReads()
+{
+    uint32_t bad = 0;
+    uint32_t torn = 0;
+    uint32_t reads = 0;
+
+    for (uint32_t cost = 64; cost <= MODEL_TICK / 2; cost += 331)
+    {
+        /* 0xFFFF seconds and 32768 - 4000 ticks */
+        modelReset(0xFFFF, 3999, cost);
+        for (uint32_t i = 0; i < 12000; i++)
+        {
+            rtcPrecise_t p;
+            uint64_t before = modelNow();
+            rtcGetPrecise(&p);
+            uint64_t after = modelNow();
+            uint64_t v = (uint64_t)p.seconds * RTC_TICKS_PER_SECOND + p.ticks;
+            bad += (v < before) || (v > after);
+            reads++;
+
+            /* The same without the second counter read */
+            before = modelNow();
+            uint32_t seconds = RTC_GetCounter();
+            uint32_t divider = RTC_GetDivider();
+            after = modelNow();
+            v = (uint64_t)seconds * RTC_TICKS_PER_SECOND + (RTC_TICKS_PER_SECOND - 1) - divider;
+            torn += (v < before) || (v > after);
+        }
+    }
+
+    /* Register accesses per call away from a rollover */
+    modelReset(1000, RTC_TICKS_PER_SECOND - 1, 16);
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        rtcPrecise_t p;
+        rtcGetPrecise(&p);
+    }
+
+    printf("reads: %lu across the CNTL/CNTH carry, %lu incoherent, %lu without the repeat, "
+           "%.1f register accesses per call\n", (unsigned long)reads, (unsigned long)bad,
+           (unsigned long)torn, model.accesses / 1000.0);
+    return bad;
+}
+
+/* Boundaries off by more than the write delay */
+static void modelSets()
+{
+    int64_t errorMin[3] = { INT64_MAX, INT64_MAX, INT64_MAX };
+    int64_t errorMax[3] = { INT64_MIN, INT64_MIN, INT64_MIN };
+    uint32_t sets = 0;
+    uint32_t restored = 0;
+    rtcStat_t stat;
+
+    /* The first set configures the RTC, the others only write it */
+    modelReset(0, RTC_TICKS_PER_SECOND - 1, 64);
+    rtcInit();
+    rtcSet(1000);
+    modelIdle(RTC_TICKS_PER_SECOND + 10);
+
+    for (uint32_t ticks = 0; ticks < RTC_TICKS_PER_SECOND; ticks += 97)
+    {
+        rtcPrecise_t p = { 1000000 + sets * 10, ticks };
+
+        modelIdle(1000 + ticks % 7919);
+        model.boundaryCount = 0;
+        uint64_t start = model.time;
+        rtcSetPrecise(&p);
+
+        while (model.boundaryCount < 3)
+        {
+            modelIdle(1);
+        }
+
+        /* The boundary that starts second k of the set, in ticks */
+        for (uint8_t k = 1; k <= 3; k++)
+        {
+            int64_t expected = (int64_t)(start / MODEL_TICK) + (RTC_TICKS_PER_SECOND - ticks) +
+                               (k - 1) * RTC_TICKS_PER_SECOND;
+            int64_t error = (int64_t)model.boundaries[k - 1] - expected;
+            errorMin[k - 1] = (error < errorMin[k - 1]) ? error : errorMin[k - 1];
+            errorMax[k - 1] = (error > errorMax[k - 1]) ? error : errorMax[k - 1];
+        }
+        restored += (model.prl == RTC_TICKS_PER_SECOND - 1) && (model.cnt == p.seconds + 3);
+        sets++;
+    }
+    rtcGetStat(&stat);
+
+    printf("sets: %lu, prescaler restored and counter right after %lu\n", (unsigned long)sets,
+           (unsigned long)restored);
+    for (uint8_t k = 0; k < 3; k++)
+    {
+        printf("  boundary %u: %+lld .. %+lld ticks\n", k + 1, (long long)errorMin[k], (long long)errorMax[k]);
+    }
+    printf("  set %.0f us, full configuration %.0f us, register writes refused %lu\n",
+           stat.setCyclesMax * 1e6 / MODEL_CYCLES_PER_S, stat.setFullCyclesMax * 1e6 / MODEL_CYCLES_PER_S,
+           (unsigned long)model.writeErrors);
+}
+
+int main()
+{
+    uint32_t bad = modelReads();
+    modelSets();
+    return (bad == 0) ? 0 : 1;
+}
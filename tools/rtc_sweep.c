@@ -0,0 +1,348 @@
+/**************************************************************************/
+/*!
+    @file     rtc_sweep.c
+
+    @brief    Sweeps the calendar functions of rtc_functions.c over every
+              day from 1970 to 2106 and checks them against the C library.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Itools/host -Iinclude tools/rtc_sweep.c src/rtc/rtc_functions.c -o rtc_sweep
+
+    Every day an unsigned 32 bit epoch reaches, up to 7 Feb 2106, is taken
+    at a time of day that changes from day to day. Up to 19 Jan 2038 the
+    conversion both ways, the weekday, the days of the month and the week
+    number must match gmtime, timegm and strftime %W. rtcAddMonths and
+    rtcAddYears move every day by a set of steps and must clamp the day to
+    the target month and keep the time, or refuse when the result leaves
+    the range. Past 19 Jan 2038 every conversion must be refused with
+    ERROR_RTC_OUTOFEPOCHRANGE. The throughput of each function is printed
+    at the end.
+
+    -m adds the long run: every minute up to 19 Jan 2038 is converted,
+    compared with gmtime and converted back by rtcToEpochTime.
+*/
+/**************************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include "rtc/rtc_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SWEEP_DAYS          (UINT32_MAX / 86400 + 1)
+#define SWEEP_RANGE_DAYS    (RTC_MAX_EPOCH_TIME / 86400 + 1)
+
+static const int32_t sweepMonths[] = { -1000, -121, -25, -13, -12, -1, 1, 2, 11, 12, 13, 25, 121, 1000 };
+static const int32_t sweepYears[] = { -100, -68, -4, -1, 1, 3, 4, 68, 100 };
+
+static uint32_t sweepErrors;
+static uint32_t sweepPrinted;
+
+static uint32_t sweepEpoch(uint32_t day);
+static void sweepFail(const char *what, uint32_t epochTime, int32_t step);
+static bool sweepReference(int32_t year, int32_t month, const struct tm *tm, time_t *expected);
+static void sweepCompare(const char *what, uint32_t epochTime, int32_t step, error_t error,
+                         const rtcTime_t *t, bool inRange, time_t expected);
+static void sweepDay(uint32_t day);
+static void sweepOutOfRange(uint32_t day);
+static uint32_t sweepMinutes(void);
+static void sweepTime(void);
+
+
+/* Epoch of a day, the time of day moves on by 7919 s per day */
+static uint32_t sweepEpoch(uint32_t day)
+{
+    uint64_t epochTime = (uint64_t)day * 86400 + (day * 7919) % 86400;
+    return (epochTime > UINT32_MAX) ? UINT32_MAX : (uint32_t)epochTime;
+}
+
+static void sweepFail(const char *what, uint32_t epochTime, int32_t step)
+{
+    sweepErrors++;
+    if (sweepPrinted++ < 10)
+    {
+        time_t t = epochTime;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        printf("  %s %+ld: %04d-%02d-%02d %02d:%02d:%02d (%lu)\n", what, (long)step, tm.tm_year + 1900,
+               tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (unsigned long)epochTime);
+    }
+}
+
+/* The time of tm moved to a 0-based month of a year since 1900, the day
+   clamped to the last day of that month. False if not in the range. */
+static bool sweepReference(int32_t year, int32_t month, const struct tm *tm, time_t *expected)
+{
+    struct tm last = { 0 };
+    last.tm_year = year;
+    last.tm_mon = month + 1;
+    last.tm_mday = 0;
+    timegm(&last);
+
+    struct tm target = *tm;
+    target.tm_year = year;
+    target.tm_mon = month;
+    target.tm_mday = (tm->tm_mday > last.tm_mday) ? last.tm_mday : tm->tm_mday;
+    *expected = timegm(&target);
+
+    return (*expected >= 0) && (*expected <= (time_t)RTC_MAX_EPOCH_TIME);
+}
+
+static void sweepCompare(const char *what, uint32_t epochTime, int32_t step, error_t error,
+                         const rtcTime_t *t, bool inRange, time_t expected)
+{
+    if (!inRange)
+    {
+        if (error != ERROR_RTC_OUTOFEPOCHRANGE)
+        {
+            sweepFail(what, epochTime, step);
+        }
+        return;
+    }
+
+    struct tm tm;
+    gmtime_r(&expected, &tm);
+    if ((error != ERROR_NONE) || (t->years != tm.tm_year) || (t->months != tm.tm_mon + 1) ||
+        (t->days != tm.tm_mday) || (t->hours != tm.tm_hour) || (t->minutes != tm.tm_min) ||
+        (t->seconds != tm.tm_sec) || (t->weekdays != (tm.tm_wday + 6) % 7))
+    {
+        sweepFail(what, epochTime, step);
+    }
+}
+
+static void sweepDay(uint32_t day)
+{
+    uint32_t epochTime = sweepEpoch(day);
+    if (epochTime > RTC_MAX_EPOCH_TIME)
+    {
+        epochTime = RTC_MAX_EPOCH_TIME;
+    }
+    time_t now = epochTime;
+    struct tm tm;
+    rtcTime_t t;
+    rtcWeekdays_t weekday;
+    uint8_t week;
+    char text[4];
+
+    gmtime_r(&now, &tm);
+    sweepCompare("conversion", epochTime, 0, rtcCreateTimeFromEpoch(epochTime, &t), &t, true, now);
+
+    if ((rtcToEpochTime(&t) != epochTime) || (rtcGetEpochDate(t.years, t.months, t.days) != day))
+    {
+        sweepFail("inverse", epochTime, 0);
+    }
+
+    rtcGetWeekday(t.years, t.months, t.days, &weekday);
+    if (weekday != t.weekdays)
+    {
+        sweepFail("weekday", epochTime, 0);
+    }
+
+    struct tm last = tm;
+    last.tm_mon++;
+    last.tm_mday = 0;
+    timegm(&last);
+    if (rtcGetDaysInMonth(t.years, t.months) != last.tm_mday)
+    {
+        sweepFail("days in month", epochTime, 0);
+    }
+
+    /* %W starts week 1 with the first Monday, rtcGetWeekNumber starts
+       week 1 with 1 January and week 2 with the first Monday after it */
+    rtcGetWeekNumber(&t, &week);
+    strftime(text, sizeof(text), "%W", &tm);
+    uint32_t expectedWeek = atoi(text);
+    struct tm january = tm;
+    january.tm_mon = 0;
+    january.tm_mday = 1;
+    timegm(&january);
+    if (january.tm_wday != 1)
+    {
+        expectedWeek++;
+    }
+    if (week != expectedWeek)
+    {
+        sweepFail("week number", epochTime, 0);
+    }
+
+    for (uint32_t i = 0; i < sizeof(sweepMonths) / sizeof(sweepMonths[0]); i++)
+    {
+        int32_t months = tm.tm_year * 12 + tm.tm_mon + sweepMonths[i];
+        time_t expected;
+        bool inRange = sweepReference(months / 12, months % 12, &tm, &expected);
+        rtcTime_t moved = t;
+        sweepCompare("rtcAddMonths", epochTime, sweepMonths[i], rtcAddMonths(&moved, sweepMonths[i]), &moved,
+                     inRange, expected);
+    }
+
+    for (uint32_t i = 0; i < sizeof(sweepYears) / sizeof(sweepYears[0]); i++)
+    {
+        time_t expected;
+        bool inRange = sweepReference(tm.tm_year + sweepYears[i], tm.tm_mon, &tm, &expected);
+        rtcTime_t moved = t;
+        sweepCompare("rtcAddYears", epochTime, sweepYears[i], rtcAddYears(&moved, sweepYears[i]), &moved,
+                     inRange, expected);
+    }
+}
+
+/* Past the range everything that would reach the day is refused */
+static void sweepOutOfRange(uint32_t day)
+{
+    uint32_t epochTime = sweepEpoch(day);
+    time_t now = epochTime;
+    struct tm tm;
+    rtcTime_t t;
+
+    gmtime_r(&now, &tm);
+    if (rtcCreateTimeFromEpoch(epochTime, &t) != ERROR_RTC_OUTOFEPOCHRANGE)
+    {
+        sweepFail("conversion", epochTime, 0);
+    }
+    if (rtcCreateTime(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, 0, &t) !=
+        ERROR_RTC_OUTOFEPOCHRANGE)
+    {
+        sweepFail("rtcCreateTime", epochTime, 0);
+    }
+}
+
+/* Every minute both ways, returns the mismatches */
+static uint32_t sweepMinutes()
+{
+    uint32_t errors = sweepErrors;
+
+    for (uint32_t epochTime = 0; epochTime <= RTC_MAX_EPOCH_TIME; epochTime += 60)
+    {
+        time_t now = epochTime;
+        rtcTime_t t;
+
+        sweepCompare("minute", epochTime, 0, rtcCreateTimeFromEpoch(epochTime, &t), &t, true, now);
+        if (rtcToEpochTime(&t) != epochTime)
+        {
+            sweepFail("minute inverse", epochTime, 0);
+        }
+    }
+
+    printf("1970-2038: %lu minutes, %lu mismatches\n", (unsigned long)(RTC_MAX_EPOCH_TIME / 60 + 1),
+           (unsigned long)(sweepErrors - errors));
+    return sweepErrors - errors;
+}
+
+static void sweepTime()
+{
+    const uint32_t rounds = 100;
+    volatile uint32_t sink = 0;
+    double calls = (double)rounds * (SWEEP_RANGE_DAYS - 1);
+    rtcTime_t t;
+    uint8_t week;
+    clock_t start;
+    double create, inverse, weekNumber, months, years;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t day = 0; day < SWEEP_RANGE_DAYS - 1; day++)
+        {
+            rtcCreateTimeFromEpoch(sweepEpoch(day), &t);
+            sink += t.days;
+        }
+    }
+    create = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t day = 0; day < SWEEP_RANGE_DAYS - 1; day++)
+        {
+            t.years = 70 + day % 68;
+            t.months = 1 + day % 12;
+            t.days = 1 + day % 28;
+            sink += rtcToEpochTime(&t);
+        }
+    }
+    inverse = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t day = 0; day < SWEEP_RANGE_DAYS - 1; day++)
+        {
+            t.years = 70 + day % 68;
+            t.months = 1 + day % 12;
+            t.days = 1 + day % 28;
+            rtcGetWeekNumber(&t, &week);
+            sink += week;
+        }
+    }
+    weekNumber = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        rtcCreateTimeFromEpoch(0, &t);
+        for (uint32_t day = 0; day < SWEEP_RANGE_DAYS - 1; day++)
+        {
+            rtcAddMonths(&t, (day & 1) ? 1 : -1);
+            sink += t.days;
+        }
+    }
+    months = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        rtcCreateTimeFromEpoch(0, &t);
+        for (uint32_t day = 0; day < SWEEP_RANGE_DAYS - 1; day++)
+        {
+            rtcAddYears(&t, (day & 1) ? 1 : -1);
+            sink += t.days;
+        }
+    }
+    years = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("rtcCreateTimeFromEpoch %.2f ns, rtcToEpochTime %.2f ns, rtcGetWeekNumber %.2f ns, "
+           "rtcAddMonths %.2f ns, rtcAddYears %.2f ns\n", create * 1e9 / calls, inverse * 1e9 / calls,
+           weekNumber * 1e9 / calls, months * 1e9 / calls, years * 1e9 / calls);
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    bool minutes = false;
+
+    if (argc == 2 && strcmp(argv[1], "-m") == 0)
+    {
+        minutes = true;
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [-m]\n", argv[0]);
+        return 2;
+    }
+
+    for (uint32_t day = 0; day < SWEEP_RANGE_DAYS; day++)
+    {
+        sweepDay(day);
+    }
+    uint32_t inRange = sweepErrors;
+
+    for (uint32_t day = SWEEP_RANGE_DAYS; day < SWEEP_DAYS; day++)
+    {
+        sweepOutOfRange(day);
+    }
+
+    printf("1970-2038: %lu days, %lu mismatches\n", (unsigned long)SWEEP_RANGE_DAYS, (unsigned long)inRange);
+    printf("2038-2106: %lu days, %lu not refused\n", (unsigned long)(SWEEP_DAYS - SWEEP_RANGE_DAYS),
+           (unsigned long)(sweepErrors - inRange));
+
+    if (minutes)
+    {
+        sweepMinutes();
+    }
+
+    sweepTime();
+    return (sweepErrors == 0) ? 0 : 1;
+}
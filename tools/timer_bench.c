@@ -0,0 +1,476 @@
+/**************************************************************************/
+/*!
+    @file     timer_bench.c
+
+    @brief    Runs the software timers of timer.c on the host against a
+              model of TIM2, checks when they expire and measures the cost
+              of starting and expiring them.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -D_DEFAULT_SOURCE -Itools/host -Iinclude -include tools/host/platform_config.h \
+            tools/timer_bench.c src/timer.c -o timer_bench
+
+    The model counts ticks at TIMER_FREQUENCY_HZ. TIM2 holds the low 16
+    bits, its update flag is set at every overflow and the compare flag
+    when the counter reaches CCR1. An enabled flag runs TIM2_IRQHandler
+    unless the interrupts are masked, EVENT_TIMER makes the tool call
+    timer_poll as the main loop would, on the same tick.
+
+    One-shot timers with equal and different deadlines and a periodic one
+    must expire in deadline order, equal deadlines in start order, each on
+    its due tick. The same is checked again across the wrap of timer_now
+    at 2^32 ticks. The timing starts N timers with random delays of up to
+    1000 ticks and expires them, -n sets the largest N.
+
+    The timer interrupts are counted over a minute idle and over a minute
+    with a 100 ms periodic and a 10 s one-shot timer, which must expire on
+    their due ticks. A poll held off for five and a half periods must run
+    a periodic timer once, count four overruns and keep its phase.
+    timer_uptime is read with the interrupts masked for up to half an
+    overflow period and must match the ticks.
+*/
+/**************************************************************************/
+
+#include "timer.h"
+#include "event.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_TIMERS        (8)
+#define BENCH_LOG           (32)
+
+typedef struct
+{
+    uint8_t timer;
+    timer_ticks_t at;
+} benchExpiry_t;
+
+TIM_TypeDef hostTIM2;
+DWT_Type hostDWT;
+CoreDebug_Type hostCoreDebug;
+uint32_t SystemCoreClock = 72000000;
+
+void TIM2_IRQHandler(void);
+
+static uint64_t modelTicks;
+static bool modelMasked;
+static bool modelInIsr;
+static uint32_t modelEvents;
+static bool modelPollHeld;
+
+static timer_soft_t benchTimers[BENCH_TIMERS];
+static benchExpiry_t benchLog[BENCH_LOG];
+static uint32_t benchLogged;
+static uint32_t benchFired;
+static timer_ticks_t benchLateMax;
+
+static void modelInterrupt(void);
+static void modelRun(uint64_t ticks);
+static void benchLogExpiry(timer_soft_t *timer);
+static void benchCount(timer_soft_t *timer);
+static uint32_t benchCheckOrder(const char *what);
+static void benchLate(timer_soft_t *timer);
+static uint32_t benchLoad(const char *what, bool timers);
+static uint32_t benchOverrun(void);
+static uint32_t benchHoldOff(void);
+static double benchNs(void);
+static void benchTime(uint32_t largest);
+
+
+/* Runs the handler while an enabled flag is set */
+static void modelInterrupt()
+{
+    if (modelMasked || modelInIsr)
+    {
+        return;
+    }
+
+    modelInIsr = true;
+    while (hostTIM2.SR & hostTIM2.DIER)
+    {
+        TIM2_IRQHandler();
+    }
+    modelInIsr = false;
+}
+
+/* Counts on by ticks, stopping at every overflow and compare match, and
+   calls timer_poll for EVENT_TIMER unless the main loop is held busy */
+static void modelRun(uint64_t ticks)
+{
+    uint64_t end = modelTicks + ticks;
+
+    while (modelTicks < end)
+    {
+        uint64_t step = 0x10000u - (modelTicks & 0xFFFFu);
+        uint64_t toCompare = (uint16_t)(hostTIM2.CCR1 - (uint16_t)modelTicks);
+        if (toCompare == 0)
+        {
+            toCompare = 0x10000u;
+        }
+        if (toCompare < step)
+        {
+            step = toCompare;
+        }
+        if (step > end - modelTicks)
+        {
+            step = end - modelTicks;
+        }
+
+        modelTicks += step;
+        hostTIM2.CNT = (uint16_t)modelTicks;
+        if (hostTIM2.CNT == 0)
+        {
+            hostTIM2.SR |= TIM_SR_UIF;
+        }
+        if (hostTIM2.CNT == hostTIM2.CCR1)
+        {
+            hostTIM2.SR |= TIM_SR_CC1IF;
+        }
+        modelInterrupt();
+
+        if ((modelEvents & EVENT_TIMER) && !modelPollHeld)
+        {
+            modelEvents &= ~EVENT_TIMER;
+            timer_poll();
+        }
+    }
+}
+
+void __disable_irq(void)
+{
+    modelMasked = true;
+}
+
+void __enable_irq(void)
+{
+    modelMasked = false;
+    modelInterrupt();
+}
+
+void eventPost(uint32_t events)
+{
+    modelEvents |= events;
+}
+
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct)
+{
+    (void)NVIC_InitStruct;
+}
+
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState)
+{
+    (void)RCC_APB1Periph;
+    (void)NewState;
+}
+
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState)
+{
+    (void)RCC_APB2Periph;
+    (void)NewState;
+}
+
+void RCC_GetClocksFreq(RCC_ClocksTypeDef *RCC_Clocks)
+{
+    RCC_Clocks->SYSCLK_Frequency = SystemCoreClock;
+    RCC_Clocks->HCLK_Frequency = SystemCoreClock;
+    RCC_Clocks->PCLK1_Frequency = SystemCoreClock / 2;
+    RCC_Clocks->PCLK2_Frequency = SystemCoreClock;
+    RCC_Clocks->ADCCLK_Frequency = SystemCoreClock / 6;
+}
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_InitStruct)
+{
+    (void)GPIOx;
+    (void)GPIO_InitStruct;
+}
+
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct)
+{
+    memset(TIM_TimeBaseInitStruct, 0, sizeof(*TIM_TimeBaseInitStruct));
+    TIM_TimeBaseInitStruct->TIM_Period = 0xFFFF;
+}
+
+/* Loads the prescaler by an update event, which sets the flag */
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct)
+{
+    (void)TIM_TimeBaseInitStruct;
+    TIMx->CNT = 0;
+    TIMx->SR |= TIM_SR_UIF;
+}
+
+void TIM_ICStructInit(TIM_ICInitTypeDef *TIM_ICInitStruct)
+{
+    memset(TIM_ICInitStruct, 0, sizeof(*TIM_ICInitStruct));
+}
+
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct)
+{
+    (void)TIMx;
+    (void)TIM_ICInitStruct;
+}
+
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState)
+{
+    TIMx->CR1 = (NewState == ENABLE);
+}
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState)
+{
+    if (NewState == ENABLE)
+    {
+        TIMx->DIER |= TIM_IT;
+    }
+    else
+    {
+        TIMx->DIER &= ~TIM_IT;
+    }
+}
+
+ITStatus TIM_GetITStatus(TIM_TypeDef *TIMx, uint16_t TIM_IT)
+{
+    return ((TIMx->SR & TIM_IT) && (TIMx->DIER & TIM_IT)) ? SET : RESET;
+}
+
+void TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t TIM_IT)
+{
+    TIMx->SR &= ~TIM_IT;
+}
+
+void TIM_SetCompare1(TIM_TypeDef *TIMx, uint16_t Compare1)
+{
+    TIMx->CCR1 = Compare1;
+}
+
+uint16_t TIM_GetCapture2(TIM_TypeDef *TIMx)
+{
+    TIMx->SR &= ~TIM_SR_CC2IF;
+    return TIMx->CCR2;
+}
+
+static void benchLogExpiry(timer_soft_t *timer)
+{
+    if (benchLogged < BENCH_LOG)
+    {
+        benchLog[benchLogged].timer = timer - benchTimers;
+        benchLog[benchLogged].at = timer_now();
+    }
+    benchLogged++;
+}
+
+static void benchCount(timer_soft_t *timer)
+{
+    (void)timer;
+    benchFired++;
+}
+
+/* Starts five timers at the current tick and runs 100 ticks. Timer 4 is
+   periodic, 0 to 3 are one-shot, 1 and 3 due on the same tick. */
+static uint32_t benchCheckOrder(const char *what)
+{
+    static const benchExpiry_t expected[] =
+    {
+        { 1, 10 }, { 3, 10 }, { 4, 20 }, { 2, 30 }, { 4, 45 }, { 0, 50 }, { 4, 70 }, { 4, 95 }
+    };
+    const uint32_t count = sizeof(expected) / sizeof(expected[0]);
+    timer_ticks_t start = timer_now();
+    uint32_t errors = 0;
+
+    benchLogged = 0;
+    timer_start(&benchTimers[0], 50, 0, benchLogExpiry);
+    timer_start(&benchTimers[1], 10, 0, benchLogExpiry);
+    timer_start(&benchTimers[2], 30, 0, benchLogExpiry);
+    timer_start(&benchTimers[3], 10, 0, benchLogExpiry);
+    timer_start(&benchTimers[4], 20, 25, benchLogExpiry);
+    modelRun(100);
+    timer_stop(&benchTimers[4]);
+
+    errors += (benchLogged != count);
+    for (uint32_t i = 0; i < count && i < benchLogged; i++)
+    {
+        errors += (benchLog[i].timer != expected[i].timer);
+        errors += (benchLog[i].at != start + expected[i].at);
+    }
+
+    printf("%s: start at tick %lu, %lu expiries:", what, (unsigned long)start, (unsigned long)benchLogged);
+    for (uint32_t i = 0; i < benchLogged && i < BENCH_LOG; i++)
+    {
+        printf(" %u@+%lu", benchLog[i].timer, (unsigned long)(benchLog[i].at - start));
+    }
+    printf(" %s\n", (errors == 0) ? "ok" : "wrong");
+    return errors;
+}
+
+/* Ticks after the deadline, the periodic deadline is already the next */
+static void benchLate(timer_soft_t *timer)
+{
+    timer_ticks_t late = timer_now() - (timer->deadline - timer->period);
+
+    benchFired++;
+    if (late > benchLateMax)
+    {
+        benchLateMax = late;
+    }
+}
+
+/* A minute of timer interrupts, idle or with two timers running */
+static uint32_t benchLoad(const char *what, bool timers)
+{
+    const uint32_t seconds = 60;
+    uint32_t isrs = timer_isr_count();
+
+    benchFired = 0;
+    benchLateMax = 0;
+    if (timers)
+    {
+        timer_start(&benchTimers[0], TIMER_FREQUENCY_HZ / 10, TIMER_FREQUENCY_HZ / 10, benchLate);
+        timer_start(&benchTimers[1], 10 * TIMER_FREQUENCY_HZ, 0, benchLate);
+    }
+    modelRun((uint64_t)seconds * TIMER_FREQUENCY_HZ);
+    timer_stop(&benchTimers[0]);
+
+    isrs = timer_isr_count() - isrs;
+    printf("%s: %.2f timer interrupts/s, %lu expiries, at most %lu ticks late\n", what, (double)isrs / seconds,
+           (unsigned long)benchFired, (unsigned long)benchLateMax);
+    return (benchLateMax != 0) || (timers && benchFired != seconds * 10 + 1);
+}
+
+/* A periodic timer polled 550 ticks late with a period of 100 */
+static uint32_t benchOverrun()
+{
+    timer_ticks_t start = timer_now();
+    uint32_t errors = 0;
+
+    benchLogged = 0;
+    timer_start(&benchTimers[0], 100, 100, benchLogExpiry);
+    modelPollHeld = true;
+    modelRun(550);
+    modelPollHeld = false;
+
+    /* The main loop is free again and takes the event at once */
+    modelEvents &= ~EVENT_TIMER;
+    timer_poll();
+    modelRun(100);
+    timer_stop(&benchTimers[0]);
+
+    /* Once on the late poll, then on the next tick of the phase */
+    errors += (benchLogged != 2) || (benchLog[0].at != start + 550) || (benchLog[1].at != start + 600);
+    errors += (benchTimers[0].overruns != 4);
+
+    printf("poll 550 ticks late, period 100: %lu expiries, %lu overruns, next at +%lu %s\n",
+           (unsigned long)benchLogged, (unsigned long)benchTimers[0].overruns,
+           (unsigned long)(benchLog[1].at - start), (errors == 0) ? "ok" : "wrong");
+    return errors;
+}
+
+/* Overflows held off by masked interrupts, the uptime must count them */
+static uint32_t benchHoldOff()
+{
+    uint32_t errors = 0;
+    timer_uptime_t last = timer_uptime();
+
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        __disable_irq();
+        modelRun(1 + rand() % 0x8000);
+        timer_uptime_t masked = timer_uptime();
+        __enable_irq();
+        timer_uptime_t now = timer_uptime();
+
+        errors += (masked != modelTicks) || (now != modelTicks) || (masked < last);
+        last = now;
+    }
+
+    printf("uptime with the overflow held off: %lu wrong\n", (unsigned long)errors);
+    return errors;
+}
+
+static double benchNs()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/* Per timer, with the clock read subtracted */
+static void benchTime(uint32_t largest)
+{
+    double overhead = benchNs();
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        benchNs();
+    }
+    overhead = (benchNs() - overhead) / 1001;
+
+    srand(1);
+    for (uint32_t n = 4; n <= largest; n *= 4)
+    {
+        timer_soft_t *timers = calloc(n, sizeof(timer_soft_t));
+        uint32_t rounds = 200000 / n + 1;
+        uint64_t expired = 0;
+        double start = 0;
+        double expire = 0;
+
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            double t = benchNs();
+            for (uint32_t i = 0; i < n; i++)
+            {
+                timer_start(&timers[i], 1 + rand() % 1000, 0, benchCount);
+            }
+            start += benchNs() - t - overhead;
+
+            /* The poll of the last expiry is timed as well, with the
+               interrupt that posted it */
+            for (uint32_t k = 0; k < 1001; k++)
+            {
+                uint32_t fired = benchFired;
+                t = benchNs();
+                modelRun(1);
+                if (benchFired != fired)
+                {
+                    expire += benchNs() - t - overhead;
+                    expired += benchFired - fired;
+                }
+            }
+        }
+
+        printf("%4lu timers: start %.1f ns, expire %.1f ns per timer\n", (unsigned long)n,
+               start / ((double)rounds * n), expire / expired);
+        free(timers);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t largest = 256;
+    uint32_t errors = 0;
+
+    if (argc == 3 && strcmp(argv[1], "-n") == 0)
+    {
+        largest = atoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [-n timers]\n", argv[0]);
+        return 2;
+    }
+
+    timer_init();
+    errors += benchCheckOrder("order");
+
+    /* Up to 20 ticks before timer_now wraps, no timer is active */
+    modelRun(0x100000000ull - 20 - modelTicks);
+    errors += benchCheckOrder("across the wrap");
+
+    errors += benchLoad("idle", false);
+    errors += benchLoad("100 ms and 10 s timers", true);
+    errors += benchOverrun();
+    errors += benchHoldOff();
+
+    benchTime(largest);
+    return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Decodes the binary output of the 'trace dump' command into a timeline.
+
+Capture the dump from the CLI port, e.g. with the USB CDC port:
+
+    stty -F /dev/ttyACM0 raw -echo
+    cat /dev/ttyACM0 > trace.bin &
+    printf 'trace dump\\r' > /dev/ttyACM0
+
+and run 'trace_decode.py trace.bin'. Text before the dump is skipped.
+With --dcf only the DCF receiver edges are written, as an edge file for
+tools/dcf_replay.c. A dump holds CFG_TRACE_RECORDS records of all trace
+points, raise it in platform_config.h for longer recordings.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"TRC1"
+HEADER = struct.Struct("<4sHHIIII")
+RECORD = struct.Struct("<IBBH")
+
+# Same order as traceId_t in include/trace.h
+NAMES = [
+    "none",
+    "isrRTC",
+    "isrUSART1",
+    "isrUSART2",
+    "isrUSB",
+    "isrTimer",
+    "dcfEdge",
+    "protocolPacket",
+    "nixieDisplay",
+    "flipdotSet",
+    "configWrite",
+    "dcfSync",
+    "gpsSync",
+]
+
+
+def describe(name, arg8, arg16):
+    if name == "isrRTC":
+        return "counter=...%06x" % ((arg8 << 16) | arg16)
+    if name in ("isrUSART1", "isrUSART2"):
+        return "char=%r" % chr(arg8)
+    if name == "isrTimer":
+        return " ".join(f for bit, f in ((1, "overflow"), (2, "compare"), (4, "capture")) if arg8 & bit)
+    if name == "dcfEdge":
+        return "level=%d" % arg8
+    if name == "protocolPacket":
+        status = {0: "bad checksum", 1: "handled", 2: "unknown"}.get(arg8, str(arg8))
+        return "msg=0x%04x %s" % (arg16, status)
+    if name == "nixieDisplay":
+        return "tubes=%d digits=%x%x%x%x" % (arg8, arg16 >> 12, (arg16 >> 8) & 0xF, (arg16 >> 4) & 0xF, arg16 & 0xF)
+    if name == "flipdotSet":
+        return "columns=%d flipped=%d" % (arg8, arg16)
+    if name in ("dcfSync", "gpsSync"):
+        return "correction=%d ms %s" % (arg16, "set" if arg8 else "below minimum")
+    if name == "configWrite":
+        return "address=0x%04x variables=%d" % (arg16, arg8)
+    return "arg8=%d arg16=%d" % (arg8, arg16)
+
+
+def fletcher(data):
+    a = b = 0
+    for c in data:
+        a = (a + c) & 0xFF
+        b = (b + a) & 0xFF
+    return a, b
+
+
+def decode(data, dcf):
+    start = data.find(MAGIC)
+    if start < 0:
+        sys.exit("no trace dump found")
+
+    magic, size, count, written, dropped, clock, now = HEADER.unpack_from(data, start)
+    if size != RECORD.size:
+        sys.exit("unexpected record size %d" % size)
+
+    end = start + HEADER.size + count * size
+    if len(data) < end + 2:
+        sys.exit("dump truncated, %d of %d bytes" % (len(data) - start, end + 2 - start))
+    if fletcher(data[start:end]) != (data[end], data[end + 1]):
+        sys.exit("checksum mismatch")
+
+    if dcf:
+        print("# %d records of %d written, core clock %d Hz" % (count, written, clock))
+    else:
+        print("%d records of %d written, %d dropped during dumps, core clock %d Hz" % (count, written, dropped, clock))
+
+    # The cycle counter wraps every 2^32 cycles (59.6 s at 72 MHz), the RTC
+    # record every second keeps consecutive records closer than that
+    records = [RECORD.unpack_from(data, start + HEADER.size + i * size) for i in range(count)]
+    t = 0
+    last = records[0][0] if records else 0
+    for cycles, ident, arg8, arg16 in records:
+        delta = (cycles - last) & 0xFFFFFFFF
+        t += delta
+        last = cycles
+        name = NAMES[ident] if ident < len(NAMES) else "id%d" % ident
+        if dcf:
+            # From 1 s, the decoder takes time 0 for no edge yet
+            if name == "dcfEdge":
+                print("%d %d" % (t * 1000000 // clock + 1000000, arg8))
+            continue
+        print("%12.6f s %+12.6f  %-15s %s" % (t / clock, delta / clock, name, describe(name, arg8, arg16)))
+
+    if records and not dcf:
+        print("dump %.6f s after the last record" % (((now - last) & 0xFFFFFFFF) / clock))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("file", nargs="?", help="captured dump, stdin if omitted")
+    parser.add_argument("--dcf", action="store_true", help="write the DCF edges for dcf_replay")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    decode(data, args.dcf)
+
+
+if __name__ == "__main__":
+    main()
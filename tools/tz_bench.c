@@ -0,0 +1,326 @@
+/**************************************************************************/
+/*!
+    @file     tz_bench.c
+
+    @brief    Checks the epoch based time zone conversion of tz.c on the
+              host against the C library and measures it.
+
+    Build from the repository root, with -DCFG_TZ_TABLE for the
+    transition table:
+
+        cc -O2 -std=c99 -Itools/host -Iinclude tools/tz_bench.c src/rtc/tz.c src/rtc/rtc_functions.c -o tz_bench
+
+    The zones get the rules of Berlin, London, Sydney and a fixed +14:00.
+    The same rules as POSIX TZ strings go to localtime, which does not
+    share any code with tz.c. Every 599 seconds of the epoch range, with
+    -m every minute, is compared both ways and classified as DST or not,
+    and each transition found is narrowed down to the second and checked
+    on both sides of it. The ends of the range check
+    that the offsets saturate instead of wrapping, a zone past
+    CFG_TZ_ZONES must leave the epoch as it is.
+
+    The timing converts 10^7 epochs, one second apart and at random over
+    the range, with the epoch API and through rtcTime_t. -n sets the
+    count. A rule change is timed up to the first conversion after it,
+    which includes building the table.
+*/
+/**************************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include "rtc/tz.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_STEP          (599)
+#define BENCH_STEP_MINUTES  (60)
+
+typedef struct
+{
+    const char *name;
+    const char *posix;
+    int16_t stdOffset;
+    uint8_t stdHour;
+    uint8_t stdWeek;
+    uint8_t stdMonth;
+    int16_t dstOffset;
+    uint8_t dstHour;
+    uint8_t dstWeek;
+    uint8_t dstMonth;
+} benchZone_t;
+
+static const benchZone_t benchZones[CFG_TZ_ZONES] =
+{
+    { "Berlin", "CET-1CEST,M3.5.0,M10.5.0/3",      60, 3, TZ_WEEK_LAST,   RTC_MONTHS_OCTOBER, 120, 2, TZ_WEEK_LAST,  RTC_MONTHS_MARCH   },
+    { "London", "GMT0BST,M3.5.0/1,M10.5.0",         0, 2, TZ_WEEK_LAST,   RTC_MONTHS_OCTOBER,  60, 1, TZ_WEEK_LAST,  RTC_MONTHS_MARCH   },
+    { "Sydney", "AEST-10AEDT,M10.1.0,M4.1.0/3",   600, 3, TZ_WEEK_FIRST,  RTC_MONTHS_APRIL,   660, 2, TZ_WEEK_FIRST, RTC_MONTHS_OCTOBER },
+    { "+14:00", "LINT-14",                        840, 0, TZ_WEEK_LAST,   0,                  840, 0, TZ_WEEK_LAST,  0                  }
+};
+
+static uint16_t benchEEPROM[0x100];
+
+static void benchSetZones(void);
+static int32_t benchLibOffset(uint32_t utc);
+static uint32_t benchCompare(uint8_t zone, uint32_t utc);
+static uint32_t benchCheckZone(uint8_t zone, uint32_t step);
+static uint32_t benchCheckEnds(void);
+static uint32_t benchRandom(void);
+static void benchTime(uint32_t count);
+static void benchTimeChange(void);
+
+
+void FLASH_Unlock(void)
+{
+}
+
+void FLASH_Lock(void)
+{
+}
+
+uint16_t EE_WriteVariable(uint16_t VirtAddress, uint16_t Data)
+{
+    benchEEPROM[VirtAddress & 0xFF] = Data;
+    return 0;
+}
+
+uint16_t EE_ReadVariable(uint16_t VirtAddress, uint16_t *Data)
+{
+    *Data = benchEEPROM[VirtAddress & 0xFF];
+    return 0;
+}
+
+static void benchSetZones()
+{
+    tzRule_t std;
+    tzRule_t dst;
+
+    tzInit();
+    for (uint8_t i = 0; i < CFG_TZ_ZONES; i++)
+    {
+        const benchZone_t *b = &benchZones[i];
+        tzCreateRule(b->stdOffset, b->stdHour, RTC_WEEKDAYS_SUNDAY, b->stdWeek, b->stdMonth, &std);
+        tzCreateRule(b->dstOffset, b->dstHour, RTC_WEEKDAYS_SUNDAY, b->dstWeek, b->dstMonth, &dst);
+        tzZoneSetSTD(i, &std);
+        tzZoneSetDST(i, &dst);
+    }
+}
+
+/* Offset of the zone set in TZ, seconds */
+static int32_t benchLibOffset(uint32_t utc)
+{
+    time_t t = utc;
+    struct tm tm;
+
+    localtime_r(&t, &tm);
+    return tm.tm_gmtoff;
+}
+
+/* Mismatches of one epoch, printed for the first few */
+static uint32_t benchCompare(uint8_t zone, uint32_t utc)
+{
+    static uint32_t printed;
+    int32_t offset = benchLibOffset(utc);
+    bool isDst = (offset != benchZones[zone].stdOffset * 60);
+    uint32_t local = tzZoneEpochUTCToLocal(zone, utc);
+    uint32_t errors = 0;
+
+    errors += (local != utc + offset);
+    errors += (tzZoneEpochUTCIsDST(zone, utc) != isDst);
+
+    /* Both times of the hour repeated at the end of DST map to one UTC */
+    uint32_t back = tzZoneEpochLocalToUTC(zone, local);
+    errors += (tzZoneEpochUTCToLocal(zone, back) != local);
+
+    if (errors > 0 && printed++ < 10)
+    {
+        printf("  %s %lu: local %lu, expected %lu, back %lu\n", benchZones[zone].name, (unsigned long)utc,
+               (unsigned long)local, (unsigned long)(utc + offset), (unsigned long)back);
+    }
+    return (errors > 0);
+}
+
+static uint32_t benchCheckZone(uint8_t zone, uint32_t step)
+{
+    uint32_t mismatches = 0;
+    uint32_t transitions = 0;
+    uint32_t checked = 0;
+    uint32_t last = 0;
+
+    setenv("TZ", benchZones[zone].posix, 1);
+    tzset();
+
+    int32_t lastOffset = benchLibOffset(0);
+    for (uint32_t utc = 0; utc <= RTC_MAX_EPOCH_TIME - 14 * 3600; utc += step)
+    {
+        int32_t offset = benchLibOffset(utc);
+        if (offset != lastOffset)
+        {
+            /* First second with the new offset */
+            uint32_t lo = last;
+            uint32_t hi = utc;
+            while (hi - lo > 1)
+            {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (benchLibOffset(mid) == offset)
+                {
+                    hi = mid;
+                }
+                else
+                {
+                    lo = mid;
+                }
+            }
+            mismatches += benchCompare(zone, hi - 1);
+            mismatches += benchCompare(zone, hi);
+            transitions++;
+            lastOffset = offset;
+        }
+        mismatches += benchCompare(zone, utc);
+        checked++;
+        last = utc;
+    }
+
+    printf("%s: %lu epochs %lu s apart, %lu transitions, %lu mismatches\n", benchZones[zone].name,
+           (unsigned long)checked, (unsigned long)step, (unsigned long)transitions, (unsigned long)mismatches);
+    return mismatches;
+}
+
+/* The +14:00 zone at the end of the range and back at its start, and
+   zones that do not exist */
+static uint32_t benchCheckEnds()
+{
+    uint32_t errors = 0;
+
+    errors += (tzZoneEpochUTCToLocal(3, RTC_MAX_EPOCH_TIME) != RTC_MAX_EPOCH_TIME);
+    errors += (tzZoneEpochUTCToLocal(3, RTC_MAX_EPOCH_TIME - 14 * 3600) != RTC_MAX_EPOCH_TIME);
+    errors += (tzZoneEpochLocalToUTC(3, 0) != 0);
+    errors += (tzZoneEpochLocalToUTC(3, 14 * 3600) != 0);
+    printf("range ends: %s\n", (errors == 0) ? "saturated" : "wrapped");
+
+    uint32_t invalid = 0;
+    invalid += (tzZoneEpochUTCToLocal(CFG_TZ_ZONES, 1400000000u) != 1400000000u);
+    invalid += (tzZoneEpochLocalToUTC(255, 1400000000u) != 1400000000u);
+    invalid += tzZoneEpochUTCIsDST(CFG_TZ_ZONES, 1400000000u);
+    invalid += tzZoneEpochLocalIsDST(255, 1400000000u);
+    printf("invalid zone: %s\n", (invalid == 0) ? "ignored" : "converted");
+    return errors + invalid;
+}
+
+/* xorshift, the same sequence on every host */
+static uint32_t benchRandom()
+{
+    static uint32_t x = 2463534242u;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static void benchTime(uint32_t count)
+{
+    volatile uint32_t sink = 0;
+    uint32_t *epochs = malloc(count * sizeof(uint32_t));
+    rtcTime_t utc;
+    rtcTime_t local;
+    clock_t start;
+    double sequential, random, decoded;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        epochs[i] = benchRandom() % (RTC_MAX_EPOCH_TIME + 1);
+    }
+
+    start = clock();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sink += tzEpochUTCToLocal(1400000000u + i);
+    }
+    sequential = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sink += tzEpochUTCToLocal(epochs[i]);
+    }
+    random = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        rtcCreateTimeFromEpoch(1400000000u + i, &utc);
+        tzUTCToLocal(&utc, &local);
+        sink += local.seconds;
+    }
+    decoded = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("tzEpochUTCToLocal: %.2f ns sequential, %.2f ns random, rtcTime_t decode and tzUTCToLocal %.2f ns\n",
+           sequential * 1e9 / count, random * 1e9 / count, decoded * 1e9 / count);
+    free(epochs);
+    (void)sink;
+}
+
+/* Both rules of zone 0 set again, then converted */
+static void benchTimeChange()
+{
+    volatile uint32_t sink = 0;
+    const uint32_t changes = 10000;
+    tzRule_t std;
+    tzRule_t dst;
+
+    tzZoneGetSTD(0, &std);
+    tzZoneGetDST(0, &dst);
+
+    clock_t start = clock();
+    for (uint32_t i = 0; i < changes; i++)
+    {
+        tzZoneSetSTD(0, &std);
+        tzZoneSetDST(0, &dst);
+        sink += tzEpochUTCToLocal(1400000000u + i);
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("rule change and first conversion: %.2f us\n", seconds * 1e6 / changes);
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 10000000;
+    uint32_t step = BENCH_STEP;
+    uint32_t mismatches = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            count = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            step = BENCH_STEP_MINUTES;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-m] [-n count]\n", argv[0]);
+            return 2;
+        }
+    }
+
+#ifdef CFG_TZ_TABLE
+    printf("with the transition table\n");
+#endif
+    benchSetZones();
+    for (uint8_t i = 0; i < CFG_TZ_ZONES; i++)
+    {
+        mismatches += benchCheckZone(i, step);
+    }
+    mismatches += benchCheckEnds();
+
+    benchTime(count);
+    benchTimeChange();
+    return (mismatches == 0) ? 0 : 1;
+}
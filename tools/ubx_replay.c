@@ -0,0 +1,356 @@
+/**************************************************************************/
+/*!
+    @file     ubx_replay.c
+
+    @brief    Replays a stream of protocol frames through the UBX framer
+              on the host, split, corrupted, truncated and mixed with
+              garbage, with the 100 ms drop of protocolGetPacket, and
+              reports the frames taken, lost and wrongly taken.
+
+    Build from the repository root:
+
+        cc -O2 -std=c99 -Itools/host -Iinclude tools/ubx_replay.c src/protocol/ubx.c -o ubx_replay
+
+    The framer is set up as protocolGetPacket does, for every message up
+    to PROTOCOL_PAYLOAD_SIZE. Each byte has an arrival time in ms. A
+    frame being received is dropped when a byte comes more than 100 ms
+    after its second sync byte, as protocolGetPacket checks before
+    reading.
+
+    Frames come split into chunks up to 90 ms apart, whole, with one byte
+    changed, cut short, too long for the payload buffer, or as random
+    bytes with sync characters in them. A clean frame must be taken with
+    its id, length and payload when the frame before it was clean or more
+    than 100 ms have passed since, and a frame split by a longer pause
+    must be dropped. No frame starting in an intact frame may be taken
+    that was not sent like that. A frame starting in a damaged one passes
+    the 16 bit checksum by chance now and then, less than one in 1000
+    damaged frames may do so. The same stream without the drop shows what
+    it recovers. -n sets the frames, -s the seed.
+*/
+/**************************************************************************/
+
+#include "protocol/protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPLAY_TIMEOUT_MS   (100)
+
+typedef enum
+{
+    REPLAY_CLEAN = 0,
+    REPLAY_SPLIT,
+    REPLAY_PAUSED,              /**< Split by a pause past the timeout */
+    REPLAY_CORRUPT,
+    REPLAY_TRUNCATED,
+    REPLAY_TOO_LONG,
+    REPLAY_GARBAGE,
+    REPLAY_KINDS
+} replayKind_t;
+
+static const char *replayKindNames[REPLAY_KINDS] =
+{
+    "clean", "split", "paused", "corrupt", "truncated", "too long", "garbage"
+};
+
+typedef struct
+{
+    uint8_t kind;
+    uint16_t msgId;
+    uint16_t length;
+    uint32_t start;             /**< First byte in the stream */
+    uint32_t end;               /**< Past the last byte */
+    uint32_t gapMs;             /**< Since the last byte of the frame before */
+    bool taken;
+} replayFrame_t;
+
+typedef struct
+{
+    uint32_t taken[REPLAY_KINDS];
+    uint32_t checksum;
+    uint32_t chance;            /**< Started in a damaged frame, checksum correct by chance */
+    uint32_t wrong;             /**< Started in an intact frame, taken but not sent like that */
+    uint32_t lost;              /**< Clean frames after a clean one or the timeout */
+    uint32_t lostAfterDamage;   /**< Clean frames swallowed by a damaged one before */
+} replayResult_t;
+
+static uint8_t *replayBytes;
+static uint32_t *replayTimes;
+static uint32_t replayLength;
+static replayFrame_t *replayFrames;
+static uint32_t replayFrameCount;
+static uint8_t replayPayload[PROTOCOL_PAYLOAD_SIZE];
+
+static uint32_t replayRandom(void);
+static uint32_t replayMs(void);
+static void replayAppend(uint8_t c, uint32_t ms);
+static void replayGenerate(uint32_t count);
+static uint32_t replayFind(uint32_t index);
+static void replayRun(bool timeout, replayResult_t *result);
+static void replayPrint(const char *what, const replayResult_t *result);
+
+
+/* xorshift, the same sequence on every host */
+static uint32_t replaySeed = 2463534242u;
+
+static uint32_t replayRandom()
+{
+    replaySeed ^= replaySeed << 13;
+    replaySeed ^= replaySeed >> 17;
+    replaySeed ^= replaySeed << 5;
+    return replaySeed;
+}
+
+static uint32_t replayMs()
+{
+    return replayLength ? replayTimes[replayLength - 1] : 0;
+}
+
+static void replayAppend(uint8_t c, uint32_t ms)
+{
+    replayBytes[replayLength] = c;
+    replayTimes[replayLength] = ms;
+    replayLength++;
+}
+
+static void replayGenerate(uint32_t count)
+{
+    static uint8_t frame[4096 + UBX_OVERHEAD];
+    static uint8_t payload[4096];
+
+    replayBytes = malloc((size_t)count * sizeof(frame));
+    replayTimes = malloc((size_t)count * sizeof(frame) * sizeof(uint32_t));
+    replayFrames = calloc(count, sizeof(replayFrame_t));
+    replayLength = 0;
+
+    for (uint32_t n = 0; n < count; n++)
+    {
+        replayFrame_t *f = &replayFrames[n];
+        uint32_t r = replayRandom() % 100;
+
+        /* Mostly clean and split frames, as the host sends them */
+        f->kind = (r < 40) ? REPLAY_CLEAN : (r < 70) ? REPLAY_SPLIT : (r < 75) ? REPLAY_PAUSED :
+                  (r < 85) ? REPLAY_CORRUPT : (r < 92) ? REPLAY_TRUNCATED : (r < 95) ? REPLAY_TOO_LONG :
+                  REPLAY_GARBAGE;
+        f->msgId = (uint16_t)replayRandom();
+        if (f->kind == REPLAY_TOO_LONG)
+        {
+            f->length = PROTOCOL_PAYLOAD_SIZE + 1 + replayRandom() % (sizeof(payload) - PROTOCOL_PAYLOAD_SIZE);
+        }
+        else
+        {
+            f->length = (replayRandom() % 4) ? replayRandom() % 64 : replayRandom() % (PROTOCOL_PAYLOAD_SIZE + 1);
+        }
+        for (uint16_t i = 0; i < f->length; i++)
+        {
+            payload[i] = (uint8_t)replayRandom();
+        }
+        uint16_t size = ubxFrame(frame, f->msgId, payload, f->length);
+
+        if (f->kind == REPLAY_GARBAGE)
+        {
+            size = 1 + replayRandom() % 64;
+            for (uint16_t i = 0; i < size; i++)
+            {
+                r = replayRandom() % 8;
+                frame[i] = (r == 0) ? UBX_SYNC_0 : (r == 1) ? UBX_SYNC_1 : (uint8_t)replayRandom();
+            }
+        }
+        else if (f->kind == REPLAY_CORRUPT)
+        {
+            frame[replayRandom() % size] ^= 1 + replayRandom() % 255;
+        }
+        else if (f->kind == REPLAY_TRUNCATED)
+        {
+            size = 1 + replayRandom() % (size - 1);
+        }
+
+        /* Up to 300 ms after the frame before, the chunks of a frame
+           within 90 ms of its first byte */
+        f->gapMs = replayRandom() % 300;
+        uint32_t ms = replayMs() + f->gapMs;
+        uint32_t first = ms;
+        uint32_t pause = (f->kind == REPLAY_PAUSED) ? 2 + replayRandom() % (size - 2) : 0;
+
+        f->start = replayLength;
+        for (uint16_t i = 0; i < size; i++)
+        {
+            if (i == pause && pause > 0)
+            {
+                ms += REPLAY_TIMEOUT_MS + 1 + replayRandom() % 200;
+            }
+            else if (i > 0 && f->kind != REPLAY_CLEAN && replayRandom() % 16 == 0 && ms < first + 89)
+            {
+                ms += 1 + replayRandom() % (first + 90 - ms);
+            }
+            replayAppend(frame[i], ms);
+        }
+        f->end = replayLength;
+    }
+    replayFrameCount = count;
+}
+
+/* Frame a byte belongs to */
+static uint32_t replayFind(uint32_t index)
+{
+    uint32_t lo = 0;
+    uint32_t hi = replayFrameCount;
+
+    while (hi - lo > 1)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (replayFrames[mid].start <= index)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void replayRun(bool timeout, replayResult_t *result)
+{
+    ubxFramer_t framer;
+    uint32_t t = 0;
+    uint32_t sync = 0;
+
+    memset(result, 0, sizeof(*result));
+    for (uint32_t n = 0; n < replayFrameCount; n++)
+    {
+        replayFrames[n].taken = false;
+    }
+
+    ubxFramerInit(&framer, replayPayload, PROTOCOL_PAYLOAD_SIZE, NULL, 0);
+    for (uint32_t i = 0; i < replayLength; i++)
+    {
+        if (timeout && !ubxFramerIdle(&framer) && replayTimes[i] - t > REPLAY_TIMEOUT_MS)
+        {
+            ubxFramerReset(&framer);
+        }
+        if (ubxFramerIdle(&framer))
+        {
+            t = replayTimes[i];
+            sync = i;
+        }
+
+        ubxRx_t rx = ubxFramerRx(&framer, replayBytes[i]);
+        if (rx == UBX_RX_CHECKSUM)
+        {
+            result->checksum++;
+        }
+        else if (rx == UBX_RX_FRAME)
+        {
+            replayFrame_t *f = &replayFrames[replayFind(i)];
+            uint8_t frame[PROTOCOL_PAYLOAD_SIZE + UBX_OVERHEAD];
+            bool sent = (i + 1 == f->end) && (f->kind <= REPLAY_PAUSED) &&
+                        (framer.msgId == f->msgId) && (framer.length == f->length) &&
+                        (ubxFrame(frame, framer.msgId, replayPayload, framer.length) == f->end - f->start) &&
+                        (memcmp(frame, &replayBytes[f->start], f->end - f->start) == 0);
+            if (sent)
+            {
+                f->taken = true;
+                result->taken[f->kind]++;
+            }
+            else if (replayFrames[replayFind(sync)].kind >= REPLAY_PAUSED)
+            {
+                result->chance++;
+            }
+            else
+            {
+                result->wrong++;
+            }
+        }
+    }
+
+    /* A clean frame is owed after a clean one, or after the timeout once
+       the frame before has stopped */
+    for (uint32_t n = 0; n < replayFrameCount; n++)
+    {
+        replayFrame_t *f = &replayFrames[n];
+        if ((f->kind != REPLAY_CLEAN && f->kind != REPLAY_SPLIT) || f->taken)
+        {
+            continue;
+        }
+        bool owed = (n == 0) || replayFrames[n - 1].taken || (timeout && f->gapMs > REPLAY_TIMEOUT_MS);
+        if (owed)
+        {
+            result->lost++;
+        }
+        else
+        {
+            result->lostAfterDamage++;
+        }
+    }
+}
+
+static void replayPrint(const char *what, const replayResult_t *result)
+{
+    uint32_t sent[REPLAY_KINDS] = { 0 };
+
+    for (uint32_t n = 0; n < replayFrameCount; n++)
+    {
+        sent[replayFrames[n].kind]++;
+    }
+
+    printf("%s:", what);
+    for (uint8_t k = 0; k < REPLAY_KINDS; k++)
+    {
+        printf(" %s %lu/%lu%s", replayKindNames[k], (unsigned long)result->taken[k], (unsigned long)sent[k],
+               (k + 1 < REPLAY_KINDS) ? "," : "\n");
+    }
+    printf("  checksum wrong %lu, damaged but checksum correct %lu, wrongly taken %lu, clean lost %lu, "
+           "clean lost after a damaged frame %lu\n", (unsigned long)result->checksum, (unsigned long)result->chance,
+           (unsigned long)result->wrong, (unsigned long)result->lost, (unsigned long)result->lostAfterDamage);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 100000;
+    replayResult_t withTimeout;
+    replayResult_t without;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            count = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            replaySeed = strtoul(argv[++i], NULL, 0) | 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n frames] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    replayGenerate(count);
+
+    clock_t start = clock();
+    replayRun(true, &withTimeout);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    replayRun(false, &without);
+
+    printf("%lu frames, %lu bytes, %.2f ns per byte\n", (unsigned long)count, (unsigned long)replayLength,
+           seconds * 1e9 / replayLength);
+    replayPrint("with the 100 ms drop", &withTimeout);
+    replayPrint("without", &without);
+
+    uint32_t damaged = 0;
+    for (uint32_t n = 0; n < replayFrameCount; n++)
+    {
+        damaged += (replayFrames[n].kind >= REPLAY_CORRUPT);
+    }
+
+    bool ok = (withTimeout.wrong == 0) && (withTimeout.lost == 0) && (withTimeout.taken[REPLAY_PAUSED] == 0) &&
+              (withTimeout.chance * 1000 < damaged);
+    return ok ? 0 : 1;
+}